@@ -153,6 +153,7 @@ LDAP_BEGIN_DECL
 #define LDAP_OPT_X_TLS_CERT 0x6017
 #define LDAP_OPT_X_TLS_KEY 0x6018
 #define LDAP_OPT_X_TLS_PEERKEY_HASH 0x6019
+#define LDAP_OPT_X_TLS_KTLS 0x601a /* OpenSSL only */
 
 #define LDAP_OPT_X_TLS_NEVER 0
 #define LDAP_OPT_X_TLS_HARD 1
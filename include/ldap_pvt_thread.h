@@ -226,13 +226,19 @@ typedef enum {
   LDAP_PVT_THREAD_POOL_PARAM_ACTIVE_MAX,
   LDAP_PVT_THREAD_POOL_PARAM_PENDING_MAX,
   LDAP_PVT_THREAD_POOL_PARAM_BACKLOAD_MAX,
-  LDAP_PVT_THREAD_POOL_PARAM_STATE
+  LDAP_PVT_THREAD_POOL_PARAM_STATE,
+  LDAP_PVT_THREAD_POOL_PARAM_QUEUES,
+  LDAP_PVT_THREAD_POOL_PARAM_STOLEN
 } ldap_pvt_thread_pool_param_t;
 #endif /* !LDAP_PVT_THREAD_H_DONE */
 
 LDAP_F(int)
 ldap_pvt_thread_pool_query(ldap_pvt_thread_pool_t *pool, ldap_pvt_thread_pool_param_t param, void *value);
 
+LDAP_F(int)
+ldap_pvt_thread_pool_queue_query(ldap_pvt_thread_pool_t *pool, int qno, ldap_pvt_thread_pool_param_t param,
+                                 void *value);
+
 LDAP_F(int)
 ldap_pvt_thread_pool_pausing(ldap_pvt_thread_pool_t *pool);
 
@@ -29,6 +29,51 @@
 #define realloc(x, y) ber_memrealloc_x(x, y, ctx)
 #define free(x) ber_memfree_x(x, ctx)
 
+/* The ASCII spans of the strings are handled eight bytes at a time,
+ * in a 64-bit word: all the bytes are ASCII while no high bit is set,
+ * and then adding to them never carries into the next byte. */
+#define UC_WORD_ONES 0x0101010101010101ull
+#define UC_WORD_HIGH 0x8080808080808080ull
+
+/* fold A-Z of eight ASCII bytes to lower case */
+static __inline uint64_t uc_word_tolower(uint64_t w) {
+  uint64_t upper = ((w + UC_WORD_ONES * (0x80 - 'A')) ^ (w + UC_WORD_ONES * (0x80 - 'Z' - 1))) & UC_WORD_HIGH;
+  return w | (upper >> 2);
+}
+
+/* the length of the leading ASCII span of s */
+static ber_len_t uc_ascii_span(const char *s, ber_len_t len) {
+  ber_len_t i;
+  uint64_t w;
+
+  for (i = 0; i + 8 <= len; i += 8) {
+    memcpy(&w, s + i, 8);
+    if (w & UC_WORD_HIGH)
+      break;
+  }
+  while (i < len && LDAP_UTF8_ISASCII(s + i))
+    i++;
+  return i;
+}
+
+/* copy the ASCII span s to out, optionally case folded */
+static void uc_ascii_copy(char *out, const char *s, ber_len_t len, unsigned casefold) {
+  ber_len_t i;
+  uint64_t w;
+
+  if (!casefold) {
+    memcpy(out, s, len);
+    return;
+  }
+  for (i = 0; i + 8 <= len; i += 8) {
+    memcpy(&w, s + i, 8);
+    w = uc_word_tolower(w);
+    memcpy(out + i, &w, 8);
+  }
+  for (; i < len; i++)
+    out[i] = TOLOWER(s[i]);
+}
+
 int ucstrncmp(const ldap_unicode_t *u1, const ldap_unicode_t *u2, ber_len_t n) {
   for (; 0 < n; ++u1, ++u2, --n) {
     if (*u1 != *u2) {
@@ -118,55 +163,31 @@ struct berval *UTF8bvnormalize(struct berval *bv, struct berval *newbv, unsigned
    */
 
   /* finish off everything up to character before first non-ascii */
-  if (LDAP_UTF8_ISASCII(s)) {
-    if (casefold) {
-      outsize = len + 7;
-      out = (char *)ber_memalloc_x(outsize, ctx);
-      if (out == NULL) {
-      fail:
-        if (didnewbv)
-          ber_memfree_x(newbv, ctx);
-        return NULL;
-      }
-      outpos = 0;
-
-      for (i = 1; (i < len) && LDAP_UTF8_ISASCII(s + i); i++) {
-        out[outpos++] = TOLOWER(s[i - 1]);
-      }
-      if (i == len) {
-        out[outpos++] = TOLOWER(s[len - 1]);
-        out[outpos] = '\0';
-        newbv->bv_val = out;
-        newbv->bv_len = outpos;
-        return newbv;
-      }
-    } else {
-      for (i = 1; (i < len) && LDAP_UTF8_ISASCII(s + i); i++) {
-        /* empty */
-      }
+  i = uc_ascii_span(s, len);
+  if (i == len && !casefold) {
+    return ber_str2bv_x(s, len, 1, newbv, ctx);
+  }
 
-      if (i == len) {
-        return ber_str2bv_x(s, len, 1, newbv, ctx);
-      }
+  outsize = len + 7;
+  out = (char *)ber_memalloc_x(outsize, ctx);
+  if (out == NULL) {
+  fail:
+    if (didnewbv)
+      ber_memfree_x(newbv, ctx);
+    return NULL;
+  }
 
-      outsize = len + 7;
-      out = (char *)ber_memalloc_x(outsize, ctx);
-      if (out == NULL) {
-        goto fail;
-      }
-      outpos = i - 1;
-      memcpy(out, s, outpos);
-    }
-  } else {
-    outsize = len + 7;
-    out = (char *)ber_memalloc_x(outsize, ctx);
-    if (out == NULL) {
-      goto fail;
-    }
-    outpos = 0;
-    i = 0;
+  if (i == len) {
+    uc_ascii_copy(out, s, len, casefold);
+    out[len] = '\0';
+    newbv->bv_val = out;
+    newbv->bv_len = len;
+    return newbv;
   }
 
+  outpos = i ? i - 1 : 0;
+  uc_ascii_copy(out, s, outpos, casefold);
+
   p = ucs = ber_memalloc_x(len * sizeof(*ucs), ctx);
   if (ucs == NULL) {
     ber_memfree_x(out, ctx);
@@ -261,13 +282,15 @@ struct berval *UTF8bvnormalize(struct berval *bv, struct berval *newbv, unsigned
 
     /* s[i] is ascii */
     /* finish off everything up to char before next non-ascii */
-    for (i++; (i < len) && LDAP_UTF8_ISASCII(s + i); i++) {
-      out[outpos++] = casefold ? TOLOWER(s[i - 1]) : s[i - 1];
-    }
-    if (i == len) {
-      out[outpos++] = casefold ? TOLOWER(s[len - 1]) : s[len - 1];
+    clen = uc_ascii_span(s + i, len - i);
+    if (i + clen == len) {
+      uc_ascii_copy(out + outpos, s + i, clen, casefold);
+      outpos += clen;
       break;
     }
+    uc_ascii_copy(out + outpos, s + i, clen - 1, casefold);
+    outpos += clen - 1;
+    i += clen;
 
     /* convert character before next non-ascii to ucs-4 */
     *ucs = casefold ? TOLOWER(s[i - 1]) : s[i - 1];
@@ -311,6 +334,24 @@ int UTF8bvnormcmp(struct berval *bv1, struct berval *bv2, unsigned flags, void *
   s2 = bv2->bv_val;
   done = s1 + len;
 
+  /* skip the common ASCII prefix a word at a time */
+  while (done - s1 >= 8) {
+    uint64_t w1, w2;
+
+    memcpy(&w1, s1, 8);
+    memcpy(&w2, s2, 8);
+    if ((w1 | w2) & UC_WORD_HIGH)
+      break;
+    if (casefold) {
+      w1 = uc_word_tolower(w1);
+      w2 = uc_word_tolower(w2);
+    }
+    if (w1 != w2)
+      break;
+    s1 += 8;
+    s2 += 8;
+  }
+
   while ((s1 < done) && LDAP_UTF8_ISASCII(s1) && LDAP_UTF8_ISASCII(s2)) {
     if (casefold) {
       char c1 = TOLOWER(*s1);
@@ -427,7 +427,7 @@ static ber_tag_t ber_get_stringbvl(BerElement *ber, bgbvr *b) {
   return tag;
 
 failed:
-  if (b->choice != BvOff) { /* BvOff does not have LBER_BV_ALLOC set */
+  if (b->option & LBER_BV_ALLOC) { /* nothing to free in-place */
     while (--n >= 0) {
       switch (b->choice) {
       case ChArray:
@@ -777,6 +777,14 @@ ber_tag_t ber_scanf(BerElement *ber, const char *fmt, ...) {
       break;
     }
 
+    case 'w': /* bvarray, parsed in-place */
+    {
+      bgbvr cookie = {BvArray, 0, sizeof(struct berval)};
+      rc = ber_get_stringbvl(ber, &cookie);
+      *(va_arg(ap, struct berval **)) = cookie.result;
+      break;
+    }
+
     case 'x': /* skip the next element - whatever it is */
       rc = ber_skip_element(ber, &data);
       break;
@@ -787,6 +795,7 @@ ber_tag_t ber_scanf(BerElement *ber, const char *fmt, ...) {
       case 'v':
       case 'V':
       case 'W':
+      case 'w':
       case 'M':
         break;
       default:
@@ -906,6 +915,12 @@ ber_tag_t ber_scanf(BerElement *ber, const char *fmt, ...) {
         *bvp = NULL;
         break;
 
+      case 'w': /* BerVarray in-place */
+        bvp = va_arg(ap, struct berval **);
+        ber_memfree_x(*bvp, ber->ber_memctx);
+        *bvp = NULL;
+        break;
+
       case 'n': /* null */
       case 'x': /* skip the next element - whatever it is */
       case '{': /* begin sequence */
@@ -119,6 +119,9 @@ static const struct ol_attribute {
 #if RELDAP_TLS == RELDAP_TLS_OPENSSL && defined(HAVE_OPENSSL_CRL)
              {0, ATTR_TLS, "TLS_CRLCHECK", NULL, LDAP_OPT_X_TLS_CRLCHECK},
 #endif /* HAVE_OPENSSL_CRL */
+#if RELDAP_TLS == RELDAP_TLS_OPENSSL
+             {0, ATTR_TLS, "TLS_KTLS", NULL, LDAP_OPT_X_TLS_KTLS},
+#endif /* RELDAP_TLS_OPENSSL */
 #if RELDAP_TLS == RELDAP_TLS_GNUTLS
              {0, ATTR_TLS, "TLS_CRLFILE", NULL, LDAP_OPT_X_TLS_CRLFILE},
 #endif /* RELDAP_TLS_GNUTLS */
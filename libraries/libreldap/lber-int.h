@@ -100,6 +100,7 @@ struct berelement {
 #define ber_pvt_ber_remaining(ber) ((ber)->ber_end - (ber)->ber_ptr)
 #define ber_pvt_ber_total(ber) ((ber)->ber_end - (ber)->ber_buf)
 #define ber_pvt_ber_write(ber) ((ber)->ber_ptr - (ber)->ber_buf)
+#define ber_pvt_ber_unflushed(ber) ((ber)->ber_ptr - ((ber)->ber_rwptr ? (ber)->ber_rwptr : (ber)->ber_buf))
 
 struct sockbuf {
   struct lber_options sb_opts;
@@ -97,6 +97,11 @@ int ber_get_option(void *item, int option, void *outvalue) {
     *((ber_len_t *)outvalue) = ber_pvt_ber_write(ber);
     return LBER_OPT_SUCCESS;
 
+  case LBER_OPT_BER_BYTES_UNFLUSHED:
+    assert(LBER_VALID(ber));
+    *((ber_len_t *)outvalue) = ber_pvt_ber_unflushed(ber);
+    return LBER_OPT_SUCCESS;
+
   case LBER_OPT_BER_MEMCTX:
     assert(LBER_VALID(ber));
     *((void **)outvalue) = ber->ber_memctx;
@@ -106,6 +106,12 @@ int ldap_pvt_thread_pool_query(ldap_pvt_thread_pool_t *tpool, ldap_pvt_thread_po
   return (-1);
 }
 
+int ldap_pvt_thread_pool_queue_query(ldap_pvt_thread_pool_t *tpool, int qno, ldap_pvt_thread_pool_param_t param,
+                                     void *value) {
+  *(int *)value = -1;
+  return (-1);
+}
+
 int ldap_pvt_thread_pool_backload(ldap_pvt_thread_pool_t *pool) { return (0); }
 
 int ldap_pvt_thread_pool_destroy(ldap_pvt_thread_pool_t *pool, int run_pending) { return (0); }
@@ -527,6 +527,19 @@ int ldap_pvt_tls_config(LDAP *ld, int option, const char *arg) {
     }
     return -1;
 #endif /* HAVE_OPENSSL_CRL */
+#if RELDAP_TLS == RELDAP_TLS_OPENSSL
+  case LDAP_OPT_X_TLS_KTLS: /* OpenSSL only */
+    i = -1;
+    if ((strcasecmp(arg, "off") == 0) || (strcasecmp(arg, "no") == 0) || (strcasecmp(arg, "false") == 0)) {
+      i = 0;
+    } else if ((strcasecmp(arg, "on") == 0) || (strcasecmp(arg, "yes") == 0) || (strcasecmp(arg, "true") == 0)) {
+      i = 1;
+    }
+    if (i >= 0) {
+      return ldap_pvt_tls_set_option(ld, option, &i);
+    }
+    return -1;
+#endif /* RELDAP_TLS_OPENSSL */
   }
   return -1;
 }
@@ -595,6 +608,11 @@ int ldap_pvt_tls_get_option(LDAP *ld, int option, void *arg) {
     *(int *)arg = lo->ldo_tls_crlcheck;
     break;
 #endif /* HAVE_OPENSSL_CRL */
+#if RELDAP_TLS == RELDAP_TLS_OPENSSL
+  case LDAP_OPT_X_TLS_KTLS: /* OpenSSL only */
+    *(int *)arg = lo->ldo_tls_ktls;
+    break;
+#endif /* RELDAP_TLS_OPENSSL */
   case LDAP_OPT_X_TLS_CIPHER_SUITE:
     *(char **)arg = lo->ldo_tls_ciphersuite ? LDAP_STRDUP(lo->ldo_tls_ciphersuite) : NULL;
     break;
@@ -815,6 +833,13 @@ int ldap_pvt_tls_set_option(LDAP *ld, int option, void *arg) {
     }
     return -1;
 #endif /* HAVE_OPENSSL_CRL */
+#if RELDAP_TLS == RELDAP_TLS_OPENSSL
+  case LDAP_OPT_X_TLS_KTLS: /* OpenSSL only */
+    if (!arg)
+      return -1;
+    lo->ldo_tls_ktls = *(int *)arg != 0;
+    return 0;
+#endif /* RELDAP_TLS_OPENSSL */
   case LDAP_OPT_X_TLS_CIPHER_SUITE:
     if (lo->ldo_tls_ciphersuite)
       LDAP_FREE(lo->ldo_tls_ciphersuite);
@@ -177,6 +177,10 @@ static int tlso_ctx_init(struct ldapoptions *lo, struct ldaptls *lt, int is_serv
     SSL_CTX_set_session_id_context(ctx, (const unsigned char *)"ReOpenLDAP", sizeof("ReOpenLDAP") - 1);
   }
 
+  /* slapd keeps appending to its output queue while a write of it is
+   * pending, so the buffer may be reallocated before the write is retried */
+  SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
 #ifdef SSL_OP_NO_TLSv1
 #ifdef SSL_OP_NO_TLSv1_1
 #ifdef SSL_OP_NO_TLSv1_2
@@ -346,6 +350,10 @@ static int tlso_ctx_init(struct ldapoptions *lo, struct ldaptls *lt, int is_serv
 #if OPENSSL_VERSION_NUMBER < 0x10100000 || defined(LIBRESSL_VERSION_NUMBER)
   SSL_CTX_set_tmp_rsa_callback(ctx, tlso_tmp_rsa_cb);
 #endif
+#ifdef SSL_OP_ENABLE_KTLS
+  if (lo->ldo_tls_ktls)
+    SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+#endif /* SSL_OP_ENABLE_KTLS */
 #if defined(HAVE_OPENSSL_CRL)
   if (lo->ldo_tls_crlcheck) {
     X509_STORE *x509_s = SSL_CTX_get_cert_store(ctx);
@@ -782,6 +790,7 @@ done:
 struct tls_data {
   tlso_session *session;
   Sockbuf_IO_Desc *sbiod;
+  int ktls; /* the session is bound to the socket for kernel TLS */
 };
 
 #if OPENSSL_VERSION_NUMBER < 0x10100000 || defined(LIBRESSL_VERSION_NUMBER)
@@ -934,8 +943,33 @@ static void tlso_destroy(void) {
   }
 }
 
+/*
+ * Kernel TLS.  Once the handshake is done, OpenSSL hands the record
+ * layer over to the kernel if SSL_OP_ENABLE_KTLS is set and the kernel
+ * supports the cipher, but only through a socket BIO.  So when the
+ * option is set and the TLS layer sits right on a TCP socket, debug
+ * layers aside, the session is bound to the socket itself rather than
+ * to the sockbuf glue; the records are still encrypted by OpenSSL if
+ * the kernel turns the offload down.
+ */
+static ber_socket_t tlso_sb_ktls_fd(Sockbuf_IO_Desc *sbiod, tlso_session *s) {
+#ifdef SSL_OP_ENABLE_KTLS
+  Sockbuf_IO_Desc *next;
+
+  if (!(SSL_get_options(s) & SSL_OP_ENABLE_KTLS))
+    return AC_SOCKET_INVALID;
+
+  for (next = sbiod->sbiod_next; next != NULL && next->sbiod_io == &ber_sockbuf_io_debug; next = next->sbiod_next)
+    ;
+  if (next != NULL && next->sbiod_io == &ber_sockbuf_io_tcp)
+    return sbiod->sbiod_sb->sb_fd;
+#endif /* SSL_OP_ENABLE_KTLS */
+  return AC_SOCKET_INVALID;
+}
+
 static int tlso_sb_setup(Sockbuf_IO_Desc *sbiod, void *arg) {
   struct tls_data *p;
+  ber_socket_t fd;
   BIO *bio;
 
   assert(sbiod != NULL);
@@ -947,6 +981,19 @@ static int tlso_sb_setup(Sockbuf_IO_Desc *sbiod, void *arg) {
 
   p->session = arg;
   p->sbiod = sbiod;
+  p->ktls = 0;
+
+  fd = tlso_sb_ktls_fd(sbiod, p->session);
+  if (fd != AC_SOCKET_INVALID) {
+    bio = BIO_new_socket(fd, BIO_NOCLOSE);
+    if (bio != NULL) {
+      SSL_set_bio(p->session, bio, bio);
+      p->ktls = 1;
+      sbiod->sbiod_pvt = p;
+      return 0;
+    }
+  }
+
 #if OPENSSL_VERSION_NUMBER < 0x10100000L || defined(LIBRESSL_VERSION_NUMBER)
   bio = BIO_new(&tlso_bio_method);
 #else
@@ -1003,6 +1050,10 @@ static int tlso_sb_close(Sockbuf_IO_Desc *sbiod) {
   assert(sbiod->sbiod_pvt != NULL);
   p = (struct tls_data *)sbiod->sbiod_pvt;
   p->sbiod = NULL;
+  /* as through the sockbuf glue, which is cut off now,
+   * no close_notify is sent */
+  if (p->ktls)
+    SSL_set_quiet_shutdown(p->session, 1);
   SSL_shutdown(p->session);
   return 0;
 }
@@ -1073,6 +1124,16 @@ static ber_slen_t tlso_sb_write(Sockbuf_IO_Desc *sbiod, void *buf, ber_len_t len
     return -1;
   }
 
+#ifdef SSL_OP_ENABLE_KTLS
+  /* The kernel frames and encrypts what is written to the socket, so
+   * the data goes down as is, in one piece rather than record by record
+   * through OpenSSL.  Unless OpenSSL has something to send first, such
+   * as the rest of a record or a key update. */
+  if (p->ktls && !sbiod->sbiod_sb->sb_trans_needs_write && SSL_is_init_finished(p->session) &&
+      SSL_get_key_update_type(p->session) == SSL_KEY_UPDATE_NONE && BIO_get_ktls_send(SSL_get_wbio(p->session)))
+    return LBER_SBIOD_WRITE_NEXT(sbiod, buf, len);
+#endif /* SSL_OP_ENABLE_KTLS */
+
   ret = SSL_write(p->session, (char *)buf, len);
   err = SSL_get_error(p->session, ret);
   if (err == SSL_ERROR_WANT_WRITE) {
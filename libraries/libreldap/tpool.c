@@ -125,6 +125,11 @@ struct ldap_int_thread_poolq_s {
   int ltq_active_count;  /* Active, not paused/idle tasks */
   int ltq_open_count;    /* Number of threads */
   int ltq_starting;      /* Currently starting threads */
+
+  /* Backlog metrics, reported by ldap_pvt_thread_pool_queue_query() */
+  int ltq_pending_max;  /* High-water mark of ltq_pending_count */
+  int ltq_backload_max; /* High-water mark of pending + active */
+  unsigned ltq_stolen;  /* Tasks taken over by threads of other queues */
 };
 
 struct ldap_int_thread_pool_s {
@@ -339,7 +344,7 @@ int ldap_pvt_thread_pool_submit2(ldap_pvt_thread_pool_t *tpool, ldap_pvt_thread_
   struct ldap_int_thread_poolq_s *pq;
   ldap_int_thread_task_t *task;
   ldap_pvt_thread_t thr;
-  int i, j;
+  int i, j, kick = -1;
 
   if (tpool == NULL)
     return (-1);
@@ -399,6 +404,10 @@ int ldap_pvt_thread_pool_submit2(ldap_pvt_thread_pool_t *tpool, ldap_pvt_thread_
 
   pq->ltq_pending_count++;
   LDAP_STAILQ_INSERT_TAIL(&pq->ltq_pending_list, task, ltt_next.q);
+  if (pq->ltq_pending_max < pq->ltq_pending_count)
+    pq->ltq_pending_max = pq->ltq_pending_count;
+  if (pq->ltq_backload_max < pq->ltq_pending_count + pq->ltq_active_count)
+    pq->ltq_backload_max = pq->ltq_pending_count + pq->ltq_active_count;
 
   if (pool->ltp_pause)
     goto done;
@@ -443,8 +452,21 @@ int ldap_pvt_thread_pool_submit2(ldap_pvt_thread_pool_t *tpool, ldap_pvt_thread_
   }
   ldap_pvt_thread_cond_signal(&pq->ltq_cond);
 
+  /* Every thread of this queue is busy and no more may be opened,
+   * so wake up a neighbour queue: an idle thread there will steal
+   * the task instead of leaving it to wait behind the busy ones. */
+  if (pool->ltp_numqs > 1 && pq->ltq_open_count >= pq->ltq_max_count &&
+      pq->ltq_active_count >= pq->ltq_open_count)
+    kick = (i + 1) % pool->ltp_numqs;
+
 done:
   ldap_pvt_thread_mutex_unlock(&pq->ltq_mutex);
+  if (kick >= 0) {
+    pq = pool->ltp_wqs[kick];
+    ldap_pvt_thread_mutex_lock(&pq->ltq_mutex);
+    ldap_pvt_thread_cond_signal(&pq->ltq_cond);
+    ldap_pvt_thread_mutex_unlock(&pq->ltq_mutex);
+  }
   return (0);
 
 failed:
@@ -694,9 +716,23 @@ int ldap_pvt_thread_pool_query(ldap_pvt_thread_pool_t *tpool, ldap_pvt_thread_po
     break;
 
   case LDAP_PVT_THREAD_POOL_PARAM_PENDING_MAX:
-    break;
-
   case LDAP_PVT_THREAD_POOL_PARAM_BACKLOAD_MAX:
+  case LDAP_PVT_THREAD_POOL_PARAM_STOLEN: {
+    /* The high-water marks are those of the most backlogged queue */
+    int i, qcount;
+    count = 0;
+    for (i = 0; i < pool->ltp_numqs; i++) {
+      if (ldap_pvt_thread_pool_queue_query(tpool, i, param, &qcount) != 0)
+        continue;
+      if (param == LDAP_PVT_THREAD_POOL_PARAM_STOLEN)
+        count = (count + qcount) & INT_MAX;
+      else if (count < qcount)
+        count = qcount;
+    }
+  } break;
+
+  case LDAP_PVT_THREAD_POOL_PARAM_QUEUES:
+    count = pool->ltp_numqs;
     break;
 
   case LDAP_PVT_THREAD_POOL_PARAM_STATE:
@@ -727,6 +763,65 @@ int ldap_pvt_thread_pool_query(ldap_pvt_thread_pool_t *tpool, ldap_pvt_thread_po
   return (count == -1 ? -1 : 0);
 }
 
+/* Inspect a single work queue of the pool */
+int ldap_pvt_thread_pool_queue_query(ldap_pvt_thread_pool_t *tpool, int qno, ldap_pvt_thread_pool_param_t param,
+                                     void *value) {
+  struct ldap_int_thread_pool_s *pool;
+  struct ldap_int_thread_poolq_s *pq;
+  int count = -1;
+
+  if (tpool == NULL || value == NULL)
+    return -1;
+
+  pool = *tpool;
+  if (pool == NULL || qno < 0 || qno >= pool->ltp_numqs)
+    return -1;
+
+  pq = pool->ltp_wqs[qno];
+  ldap_pvt_thread_mutex_lock(&pq->ltq_mutex);
+  switch (param) {
+  case LDAP_PVT_THREAD_POOL_PARAM_MAX:
+    count = pq->ltq_max_count;
+    break;
+  case LDAP_PVT_THREAD_POOL_PARAM_MAX_PENDING:
+    count = pq->ltq_max_pending;
+    if (count < 0)
+      count = -count;
+    break;
+  case LDAP_PVT_THREAD_POOL_PARAM_OPEN:
+    count = pq->ltq_open_count;
+    break;
+  case LDAP_PVT_THREAD_POOL_PARAM_STARTING:
+    count = pq->ltq_starting;
+    break;
+  case LDAP_PVT_THREAD_POOL_PARAM_ACTIVE:
+    count = pq->ltq_active_count;
+    break;
+  case LDAP_PVT_THREAD_POOL_PARAM_PENDING:
+    count = pq->ltq_pending_count;
+    break;
+  case LDAP_PVT_THREAD_POOL_PARAM_BACKLOAD:
+    count = pq->ltq_pending_count + pq->ltq_active_count;
+    break;
+  case LDAP_PVT_THREAD_POOL_PARAM_PENDING_MAX:
+    count = pq->ltq_pending_max;
+    break;
+  case LDAP_PVT_THREAD_POOL_PARAM_BACKLOAD_MAX:
+    count = pq->ltq_backload_max;
+    break;
+  case LDAP_PVT_THREAD_POOL_PARAM_STOLEN:
+    count = pq->ltq_stolen & INT_MAX;
+    break;
+  default:;
+  }
+  ldap_pvt_thread_mutex_unlock(&pq->ltq_mutex);
+
+  if (count < 0)
+    return -1;
+  *((int *)value) = count;
+  return 0;
+}
+
 /*
  * true if pool is pausing; does not lock any mutex to check.
  * 0 if not pause, 1 if pause, -1 if error or no pool.
@@ -885,6 +980,44 @@ int ldap_pvt_thread_pool_free(ldap_pvt_thread_pool_t *tpool) {
   return (0);
 }
 
+/* Take over the oldest pending task of the most backlogged other queue.
+ * Called with pq->ltq_mutex held; the victim is only try-locked, so two
+ * queues stealing from each other can't deadlock.  Nothing is stolen
+ * while a pause is in effect: pool_pause() swaps every ltq_work_list for
+ * empty_pending_list under the queue mutex, so a queue it has already
+ * visited neither gives nor takes tasks, and a thread stealing into a
+ * queue it has not visited yet is counted there as active.
+ */
+static ldap_int_thread_task_t *ldap_int_poolq_steal(struct ldap_int_thread_poolq_s *pq) {
+  struct ldap_int_thread_pool_s *pool = pq->ltq_pool;
+  struct ldap_int_thread_poolq_s *victim = NULL;
+  ldap_int_thread_task_t *task = NULL;
+  int i, most = 0;
+
+  if (pool->ltp_numqs < 2 || pq->ltq_work_list == &empty_pending_list)
+    return NULL;
+
+  /* Unlocked peek, rechecked below under the victim's mutex */
+  for (i = 0; i < pool->ltp_numqs; i++) {
+    struct ldap_int_thread_poolq_s *wq = pool->ltp_wqs[i];
+    if (wq != pq && wq->ltq_pending_count > most) {
+      most = wq->ltq_pending_count;
+      victim = wq;
+    }
+  }
+
+  if (victim && ldap_pvt_thread_mutex_trylock(&victim->ltq_mutex) == 0) {
+    task = LDAP_STAILQ_FIRST(victim->ltq_work_list);
+    if (task) {
+      LDAP_STAILQ_REMOVE_HEAD(victim->ltq_work_list, ltt_next.q);
+      victim->ltq_pending_count--;
+      victim->ltq_stolen++;
+    }
+    ldap_pvt_thread_mutex_unlock(&victim->ltq_mutex);
+  }
+  return task;
+}
+
 /* Thread loop.  Accept and handle submitted tasks. */
 static void *ldap_int_thread_pool_wrapper(void *xpool) {
   struct ldap_int_thread_poolq_s *pq = xpool;
@@ -893,7 +1026,7 @@ static void *ldap_int_thread_pool_wrapper(void *xpool) {
   ldap_int_tpool_plist_t *work_list;
   ldap_int_thread_userctx_t ctx, *kctx;
   unsigned i, keyslot, hash;
-  int pool_lock = 0, freeme = 0;
+  int pool_lock = 0, freeme = 0, stolen;
 
   assert(pool != NULL);
 
@@ -933,6 +1066,9 @@ static void *ldap_int_thread_pool_wrapper(void *xpool) {
   for (;;) {
     work_list = pq->ltq_work_list; /* help the compiler a bit */
     task = LDAP_STAILQ_FIRST(work_list);
+    stolen = 0;
+    if (task == NULL && (task = ldap_int_poolq_steal(pq)) != NULL)
+      stolen = 1;
     if (task == NULL) { /* paused or no pending tasks */
       if (--(pq->ltq_active_count) < 1) {
         if (pool->ltp_pause) {
@@ -978,6 +1114,8 @@ static void *ldap_int_thread_pool_wrapper(void *xpool) {
 
         work_list = pq->ltq_work_list;
         task = LDAP_STAILQ_FIRST(work_list);
+        if (task == NULL && !pool_lock && (task = ldap_int_poolq_steal(pq)) != NULL)
+          stolen = 1;
       } while (task == NULL);
 
       if (pool_lock) {
@@ -988,8 +1126,10 @@ static void *ldap_int_thread_pool_wrapper(void *xpool) {
       pq->ltq_active_count++;
     }
 
-    LDAP_STAILQ_REMOVE_HEAD(work_list, ltt_next.q);
-    pq->ltq_pending_count--;
+    if (!stolen) {
+      LDAP_STAILQ_REMOVE_HEAD(work_list, ltt_next.q);
+      pq->ltq_pending_count--;
+    }
     ldap_pvt_thread_mutex_unlock(&pq->ltq_mutex);
 
     task->ltt_start_routine(&ctx, task->ltt_arg);
@@ -1291,6 +1431,12 @@ int ldap_pvt_thread_pool_setkey(void *xctx, void *key, void *data, ldap_pvt_thre
 
 /* Free all elements with this key, no matter which thread they're in.
  * May only be called while the pool is paused.
+ *
+ * The context of the main thread is purged as well.  It is shared by
+ * every thread outside of the pool, so a key may only be used there
+ * while the main thread is alone to use it: as the backends are started
+ * before the pool runs any task, and shut down after the pool is closed.
+ * A caller, which runs in a paused pool, can't meet either of them.
  */
 void ldap_pvt_thread_pool_purgekey(void *key) {
   int i, j;
@@ -1299,8 +1445,10 @@ void ldap_pvt_thread_pool_purgekey(void *key) {
   assert(key != NULL);
 
   ldap_pvt_thread_mutex_lock(&ldap_pvt_thread_pool_mutex);
-  for (i = 0; i < LDAP_MAXTHR; i++) {
-    ctx = thread_keys[i].ctx;
+  /* the main thread is not in thread_keys[], but uses keys too,
+   * e.g. for the readers of the overlays started along with back-mdb */
+  for (i = -1; i < LDAP_MAXTHR; i++) {
+    ctx = (i < 0) ? &ldap_int_main_thrctx : thread_keys[i].ctx;
     if (ctx && ctx != DELETED_THREAD_CTX) {
       for (j = 0; j < MAXKEYS && ctx->ltu_key[j].ltk_key; j++) {
         if (ctx->ltu_key[j].ltk_key == key) {
@@ -30,6 +30,15 @@
 
 #define ACL_BUF_SIZE 1024 /* use most appropriate size */
 
+#define ACL_CURSOR_WORDS 16 /* of candidate bits, i.e. up to 1024 ACLs per list */
+
+/* Where slap_acl_get() is in an indexed list of ACLs */
+typedef struct AclCursor {
+  AclIndex *ac_index; /* NULL while walking the list */
+  int ac_ix;          /* of the ACL returned last */
+  uint64_t ac_cand[ACL_CURSOR_WORDS];
+} AclCursor;
+
 static const struct berval acl_bv_ip_eq = BER_BVC("IP=");
 #ifdef LDAP_PF_INET6
 static const struct berval acl_bv_ipv6_eq = BER_BVC("IP=[");
@@ -40,7 +49,7 @@ static const struct berval acl_bv_path_eq = BER_BVC("PATH=");
 
 static AccessControl *slap_acl_get(AccessControl *ac, int *count, Operation *op, Entry *e, AttributeDescription *desc,
                                    struct berval *val, AclRegexMatches *matches, slap_mask_t *mask,
-                                   AccessControlState *state);
+                                   AccessControlState *state, AclCursor *cur);
 
 static slap_control_t slap_acl_mask(AccessControl *ac, AccessControl *prev, slap_mask_t *mask, Operation *op, Entry *e,
                                     AttributeDescription *desc, struct berval *val, AclRegexMatches *matches, int count,
@@ -49,6 +58,8 @@ static slap_control_t slap_acl_mask(AccessControl *ac, AccessControl *prev, slap
 static int regex_matches(struct berval *pat, char *str, struct berval *dn_matches, struct berval *val_matches,
                          AclRegexMatches *matches);
 
+static int acl_dn_may_apply(AccessControl *a, struct berval *ndn);
+
 typedef struct AclSetCookie {
   SetCookie asc_cookie;
 #define asc_op asc_cookie.set_op
@@ -58,6 +69,275 @@ typedef struct AclSetCookie {
 SLAP_SET_GATHER acl_set_gather;
 SLAP_SET_GATHER acl_set_gather2;
 
+/*
+ * A bounded cache of the decisions of slap_access_allowed() across
+ * operations, keyed by the database, the authorization identity, the
+ * target entry DN, the attribute, the access and the initial mask.
+ * Only the decisions taken by ACLs that look at nothing else are
+ * cached: no "to" filter, no dnattr, set, realdn, connection or ssf
+ * clause and no dynacl, nor a group whose entry is the target itself.
+ * Anything else they depend on (group entries, the ACLs themselves) is
+ * covered by a generation which is bumped by each write operation and
+ * by each change of the ACLs; an operation only caches the decisions
+ * it took if no write completed since it started, so that it can't
+ * store what it read from an older snapshot of the database.
+ * The cache is sharded and admits a decision the second time it is
+ * taken, as the one of dn.c.
+ */
+#define ACL_CACHE_SHARDS 16
+#define ACL_CACHE_BUCKETS 1024 /* per shard */
+#define ACL_CACHE_SEEN 1024    /* per shard */
+
+unsigned acl_cache_max = 8192; /* decisions in all, 0 disables the cache */
+unsigned acl_cache_gen;
+
+typedef struct acl_cache_entry {
+  LDAP_LIST_ENTRY(acl_cache_entry) ace_chain;
+  LDAP_TAILQ_ENTRY(acl_cache_entry) ace_lru;
+  uint32_t ace_hash;
+  unsigned ace_gen;
+  BackendDB *ace_bd;
+  AttributeDescription *ace_desc;
+  slap_access_t ace_access;
+  slap_mask_t ace_initmask;
+  slap_mask_t ace_mask;
+  int ace_ret;
+  struct berval ace_opndn;
+  struct berval ace_endn;
+} acl_cache_entry;
+
+typedef struct acl_cache_shard {
+  ldap_pvt_thread_mutex_t acs_mutex;
+  unsigned acs_count;
+  LDAP_TAILQ_HEAD(acl_cache_lru, acl_cache_entry) acs_lru;
+  LDAP_LIST_HEAD(acl_cache_chain, acl_cache_entry) acs_chain[ACL_CACHE_BUCKETS];
+  uint32_t acs_seen[ACL_CACHE_SEEN];
+} __cache_aligned acl_cache_shard;
+
+static acl_cache_shard *acl_cache;
+static void *acl_cache_alloc;
+
+typedef struct acl_cache_probe {
+  acl_cache_shard *acp_shard;
+  uint32_t acp_hash;
+  int acp_admit;
+} acl_cache_probe;
+
+void acl_cache_init(void) {
+  int i, j;
+
+  acl_cache_alloc = ch_calloc(1, ACL_CACHE_SHARDS * sizeof(acl_cache_shard) + CACHELINE_SIZE - 1);
+  acl_cache = (acl_cache_shard *)(((size_t)acl_cache_alloc + CACHELINE_SIZE - 1) & ~(size_t)(CACHELINE_SIZE - 1));
+  for (i = 0; i < ACL_CACHE_SHARDS; i++) {
+    ldap_pvt_thread_mutex_init(&acl_cache[i].acs_mutex);
+    LDAP_TAILQ_INIT(&acl_cache[i].acs_lru);
+    for (j = 0; j < ACL_CACHE_BUCKETS; j++)
+      LDAP_LIST_INIT(&acl_cache[i].acs_chain[j]);
+  }
+}
+
+/* acs_mutex locked */
+static void acl_cache_evict(acl_cache_shard *acs, acl_cache_entry *ace) {
+  LDAP_LIST_REMOVE(ace, ace_chain);
+  LDAP_TAILQ_REMOVE(&acs->acs_lru, ace, ace_lru);
+  acs->acs_count--;
+  ch_free(ace);
+}
+
+/* The decisions cached so far are stale, they are dropped lazily */
+void acl_cache_invalidate(void) { __atomic_add_fetch(&acl_cache_gen, 1, __ATOMIC_RELEASE); }
+
+void acl_cache_destroy(void) {
+  acl_cache_entry *ace;
+  int i;
+
+  if (!acl_cache)
+    return;
+
+  for (i = 0; i < ACL_CACHE_SHARDS; i++) {
+    while ((ace = LDAP_TAILQ_FIRST(&acl_cache[i].acs_lru)) != NULL)
+      acl_cache_evict(&acl_cache[i], ace);
+    ldap_pvt_thread_mutex_destroy(&acl_cache[i].acs_mutex);
+  }
+  ch_free(acl_cache_alloc);
+  acl_cache = NULL;
+}
+
+static uint32_t acl_cache_hash(uint32_t h, const void *p, size_t len) {
+  const unsigned char *c = p;
+
+  while (len--)
+    h = (h ^ *c++) * 16777619u;
+  return h;
+}
+
+/* Look the decision up.  On a miss the probe tells whether to
+ * acl_cache_put() it once it is taken. */
+static int acl_cache_get(Operation *op, Entry *e, AttributeDescription *desc, slap_access_t access,
+                         slap_mask_t initmask, int *ret, slap_mask_t *mask, acl_cache_probe *acp) {
+  acl_cache_shard *acs;
+  acl_cache_entry *ace, *next;
+  uint32_t h = 2166136261u; /* FNV-1a */
+  unsigned gen;
+  uint32_t *seen;
+
+  acp->acp_admit = 0;
+  if (!acl_cache || !acl_cache_max)
+    return 0;
+
+  h = acl_cache_hash(h, &op->o_bd, sizeof(op->o_bd));
+  h = acl_cache_hash(h, &desc, sizeof(desc));
+  h = acl_cache_hash(h, &access, sizeof(access));
+  h = acl_cache_hash(h, op->o_ndn.bv_val, op->o_ndn.bv_len);
+  h = acl_cache_hash(h, "", 1);
+  h = acl_cache_hash(h, e->e_nname.bv_val, e->e_nname.bv_len);
+  acp->acp_hash = h;
+  acp->acp_shard = acs = &acl_cache[h % ACL_CACHE_SHARDS];
+  gen = __atomic_load_n(&acl_cache_gen, __ATOMIC_ACQUIRE);
+
+  ldap_pvt_thread_mutex_lock(&acs->acs_mutex);
+  for (ace = LDAP_LIST_FIRST(&acs->acs_chain[(h / ACL_CACHE_SHARDS) % ACL_CACHE_BUCKETS]); ace != NULL; ace = next) {
+    next = LDAP_LIST_NEXT(ace, ace_chain);
+    if (ace->ace_gen != gen) {
+      acl_cache_evict(acs, ace);
+      continue;
+    }
+    if (ace->ace_hash == h && ace->ace_bd == op->o_bd && ace->ace_desc == desc && ace->ace_access == access &&
+        ace->ace_initmask == initmask && bvmatch(&ace->ace_opndn, &op->o_ndn) && bvmatch(&ace->ace_endn, &e->e_nname)) {
+      LDAP_TAILQ_REMOVE(&acs->acs_lru, ace, ace_lru);
+      LDAP_TAILQ_INSERT_TAIL(&acs->acs_lru, ace, ace_lru);
+      *ret = ace->ace_ret;
+      ACL_PRIV_ASSIGN(*mask, ace->ace_mask);
+      ldap_pvt_thread_mutex_unlock(&acs->acs_mutex);
+      return 1;
+    }
+  }
+  seen = &acs->acs_seen[(h / ACL_CACHE_SHARDS) % ACL_CACHE_SEEN];
+  if (*seen == h)
+    acp->acp_admit = 1;
+  else
+    *seen = h;
+  ldap_pvt_thread_mutex_unlock(&acs->acs_mutex);
+  return 0;
+}
+
+static void acl_cache_put(Operation *op, Entry *e, AttributeDescription *desc, slap_access_t access,
+                          slap_mask_t initmask, int ret, slap_mask_t mask, acl_cache_probe *acp) {
+  acl_cache_shard *acs = acp->acp_shard;
+  acl_cache_entry *ace;
+  char *p;
+
+  ace = ch_malloc(sizeof(acl_cache_entry) + op->o_ndn.bv_len + e->e_nname.bv_len + 2);
+  ace->ace_hash = acp->acp_hash;
+  ace->ace_gen = op->o_acl_gen;
+  ace->ace_bd = op->o_bd;
+  ace->ace_desc = desc;
+  ace->ace_access = access;
+  ace->ace_initmask = initmask;
+  ace->ace_mask = mask;
+  ace->ace_ret = ret;
+  p = (char *)(ace + 1);
+  ace->ace_opndn.bv_val = p;
+  ace->ace_opndn.bv_len = op->o_ndn.bv_len;
+  memcpy(p, op->o_ndn.bv_val, op->o_ndn.bv_len);
+  p += op->o_ndn.bv_len;
+  *p++ = '\0';
+  ace->ace_endn.bv_val = p;
+  ace->ace_endn.bv_len = e->e_nname.bv_len;
+  memcpy(p, e->e_nname.bv_val, e->e_nname.bv_len);
+  p[e->e_nname.bv_len] = '\0';
+
+  ldap_pvt_thread_mutex_lock(&acs->acs_mutex);
+  if (ace->ace_gen != __atomic_load_n(&acl_cache_gen, __ATOMIC_ACQUIRE)) {
+    ldap_pvt_thread_mutex_unlock(&acs->acs_mutex);
+    ch_free(ace);
+    return;
+  }
+  /* another thread may have got it first, the older copy ages out */
+  LDAP_LIST_INSERT_HEAD(&acs->acs_chain[(acp->acp_hash / ACL_CACHE_SHARDS) % ACL_CACHE_BUCKETS], ace, ace_chain);
+  LDAP_TAILQ_INSERT_TAIL(&acs->acs_lru, ace, ace_lru);
+  acs->acs_count++;
+  while (acs->acs_count > (acl_cache_max + ACL_CACHE_SHARDS - 1) / ACL_CACHE_SHARDS)
+    acl_cache_evict(acs, LDAP_TAILQ_FIRST(&acs->acs_lru));
+  ldap_pvt_thread_mutex_unlock(&acs->acs_mutex);
+}
+
+/* whether the clause looks at the connection rather than the identity */
+static int acl_access_on_conn(Access *b) {
+  if (!BER_BVISEMPTY(&b->a_realdn_pat) || b->a_realdn_at != NULL || !BER_BVISEMPTY(&b->a_peername_pat) ||
+      !BER_BVISEMPTY(&b->a_sockname_pat) || !BER_BVISEMPTY(&b->a_domain_pat) || !BER_BVISEMPTY(&b->a_sockurl_pat) ||
+      b->a_authz.sai_ssf || b->a_authz.sai_transport_ssf || b->a_authz.sai_tls_ssf || b->a_authz.sai_sasl_ssf)
+    return 1;
+#ifdef SLAP_DYNACL
+  if (b->a_dynacl != NULL)
+    return 1;
+#endif /* SLAP_DYNACL */
+  return 0;
+}
+
+/* whether the decision taken by the ACLs up to last (all of them if
+ * NULL) on the whole attribute desc only depends on the DN of e and
+ * the identity of op */
+static int acl_cache_decidable(Operation *op, Entry *e, AttributeDescription *desc, AccessControl *last) {
+  AccessControl *a = op->o_bd->be_acl ? op->o_bd->be_acl : frontendDB->be_acl;
+  int fe_done = a == frontendDB->be_acl;
+  Access *b;
+
+  for (;;) {
+    for (; a != NULL; a = a->acl_next) {
+      /* the ones which can't apply are never looked further into */
+      if (a->acl_attrval.bv_val || (a->acl_attrs && !ad_inlist(desc, a->acl_attrs)) ||
+          !acl_dn_may_apply(a, &e->e_nname))
+        goto next;
+      if (a->acl_filter != NULL)
+        return 0;
+      for (b = a->acl_access; b != NULL; b = b->a_next) {
+        if (b->a_dn_at != NULL || !BER_BVISEMPTY(&b->a_set_pat) || acl_access_on_conn(b))
+          return 0;
+        /* the group is read from e when it is e */
+        if (!BER_BVISEMPTY(&b->a_group_pat) &&
+            (b->a_group_style == ACL_STYLE_EXPAND || dn_match(&b->a_group_pat, &e->e_nname)))
+          return 0;
+      }
+    next:
+      if (a == last)
+        return 1;
+    }
+    if (fe_done)
+      return 1;
+    fe_done = 1;
+    a = frontendDB->be_acl;
+  }
+}
+
+/* whether the read access of op to all of e, values included, only
+ * depends on the content of e, the identity of op and the entries
+ * covered by acl_cache_gen, but not on the connection of op */
+int acl_entry_decidable(Operation *op, Entry *e) {
+  AccessControl *a;
+  Access *b;
+  int fe_done;
+
+  if (op->o_acl_priv != ACL_NONE || op->o_is_auth_check || op->o_bd == NULL)
+    return 0;
+
+  a = op->o_bd->be_acl ? op->o_bd->be_acl : frontendDB->be_acl;
+  fe_done = a == frontendDB->be_acl;
+  for (;;) {
+    for (; a != NULL; a = a->acl_next) {
+      if (!acl_dn_may_apply(a, &e->e_nname))
+        continue;
+      for (b = a->acl_access; b != NULL; b = b->a_next)
+        if (acl_access_on_conn(b))
+          return 0;
+    }
+    if (fe_done)
+      return 1;
+    fe_done = 1;
+    a = frontendDB->be_acl;
+  }
+}
+
 /*
  * access_allowed - check whether op->o_ndn is allowed the requested access
  * to entry e, attribute attr, value val.  if val is null, access to
@@ -113,6 +393,9 @@ int slap_access_allowed(Operation *op, Entry *e, AttributeDescription *desc, str
   AclRegexMatches matches;
   AccessControlState acl_state = ACL_STATE_INIT;
   static AccessControlState state_init = ACL_STATE_INIT;
+  acl_cache_probe acp;
+  slap_mask_t initmask;
+  AclCursor cursor;
 
   assert(op != NULL);
   assert(e != NULL);
@@ -172,6 +455,8 @@ int slap_access_allowed(Operation *op, Entry *e, AttributeDescription *desc, str
 
   ret = 0;
   control = ACL_BREAK;
+  acp.acp_admit = 0;
+  cursor.ac_index = NULL;
 
   if (state == NULL)
     state = &acl_state;
@@ -187,12 +472,20 @@ int slap_access_allowed(Operation *op, Entry *e, AttributeDescription *desc, str
     a = NULL;
     count = 0;
     ACL_PRIV_ASSIGN(mask, *maskp);
+
+    /* a whole attribute, as decided for the same identity before */
+    ACL_PRIV_ASSIGN(initmask, *maskp);
+    if (val == NULL && acl_cache_get(op, e, desc, access, initmask, &ret, &mask, &acp)) {
+      Debug(LDAP_DEBUG_ACL, "=> slap_access_allowed: %s access %s by %s (cached)\n", access2str(access),
+            ret ? "granted" : "denied", accessmask2str(mask, accessmaskbuf, 1));
+      goto done;
+    }
   }
 
   MATCHES_MEMSET(&matches);
   prev = a;
 
-  while ((a = slap_acl_get(a, &count, op, e, desc, val, &matches, &mask, state)) != NULL) {
+  while ((a = slap_acl_get(a, &count, op, e, desc, val, &matches, &mask, state, &cursor)) != NULL) {
     int i;
     int dnmaxcount = MATCHES_DNMAXCOUNT(&matches);
     int valmaxcount = MATCHES_VALMAXCOUNT(&matches);
@@ -244,7 +537,7 @@ int slap_access_allowed(Operation *op, Entry *e, AttributeDescription *desc, str
   } else if (control == ACL_BREAK) {
     Debug(LDAP_DEBUG_ACL, "=> slap_access_allowed: no more rules\n");
 
-    goto done;
+    goto cache;
   }
 
   ret = ACL_GRANT(mask, access);
@@ -252,6 +545,10 @@ int slap_access_allowed(Operation *op, Entry *e, AttributeDescription *desc, str
   Debug(LDAP_DEBUG_ACL, "=> slap_access_allowed: %s access %s by %s\n", access2str(access), ret ? "granted" : "denied",
         accessmask2str(mask, accessmaskbuf, 1));
 
+cache:
+  if (acp.acp_admit && !state->as_vd_acl_present && acl_cache_decidable(op, e, desc, a))
+    acl_cache_put(op, e, desc, access, initmask, ret, mask, &acp);
+
 done:
   ACL_PRIV_ASSIGN(*maskp, mask);
   return ret;
@@ -390,6 +687,291 @@ done:
   return ret;
 }
 
+/*
+ * A list of ACLs is indexed by acl_index_build(), so that slap_acl_get()
+ * jumps from one candidate to the next instead of matching each "to"
+ * clause in turn.  The candidates for an entry and an attribute are,
+ * by DN, the base, one, subtree and children ACLs whose DN is a suffix
+ * of the entry DN, as found by hashing each suffix, the regex ones
+ * ending with a literal that ends the entry DN, and all the others;
+ * and, by attribute, the ACLs naming the type of the attribute or one
+ * of its supertypes, as found by hashing each of them, and those with
+ * no attribute list or one with wildcards or object classes.  This only
+ * narrows the list: the candidates are still checked in order, as
+ * before, so that the semantics of the ACLs are kept.
+ *
+ * The index hangs on the head of the list and is rebuilt whenever the
+ * list changes, which only happens while the server is paused.
+ */
+#define ACL_INDEX_MIN 4
+#define ACL_INDEX_MAX (64 * ACL_CURSOR_WORDS)
+
+typedef struct AclIndexDN {
+  struct AclIndexDN *aid_next;
+  uint32_t aid_hash;
+  int aid_ix;
+} AclIndexDN;
+
+typedef struct AclIndexAttr {
+  struct AclIndexAttr *aia_next;
+  AttributeType *aia_type;
+  int aia_ix;
+} AclIndexAttr;
+
+typedef struct AclIndexTail {
+  struct berval ait_tail;
+  int ait_ix;
+} AclIndexTail;
+
+struct AclIndex {
+  int ai_n;
+  int ai_words;
+  uint64_t *ai_anydn;   /* the ACLs not found by DN */
+  uint64_t *ai_anyattr; /* the ACLs not found by attribute */
+  AccessControl **ai_acl;
+  unsigned ai_mask; /* of both hashes */
+  AclIndexDN **ai_dn;
+  AclIndexAttr **ai_attr;
+  int ai_ntail;
+  AclIndexTail *ai_tail;
+};
+
+#define ACL_INDEX_SET(bits, ix) ((bits)[(ix) / 64] |= 1ull << ((ix) % 64))
+
+/* hashed from the end, so that the suffixes of a DN are hashed in turn */
+#define ACL_INDEX_HASH(h, c) (((h) ^ (unsigned char)(c)) * 16777619u)
+
+static uint32_t acl_index_hash_type(AttributeType *at) {
+  uintptr_t p = (uintptr_t)at;
+
+  return (uint32_t)((p >> 4) ^ (p >> 20)) * 2654435761u;
+}
+
+/* The literal a regex of the DN requires the DN to end with, if any */
+static void acl_regex_tail(struct berval *pat, struct berval *tail) {
+  ber_len_t i;
+
+  BER_BVZERO(tail);
+  /* an alternative might not end with it */
+  if (pat->bv_len < 2 || pat->bv_val[pat->bv_len - 1] != '$' || memchr(pat->bv_val, '|', pat->bv_len))
+    return;
+
+  for (i = pat->bv_len - 1; i > 0 && !strchr("\\^$.[]()*+?{}", pat->bv_val[i - 1]); i--)
+    ;
+  tail->bv_val = pat->bv_val + i;
+  tail->bv_len = pat->bv_len - 1 - i;
+}
+
+void acl_index_free(AclIndex *ai) { ch_free(ai); }
+
+void acl_index_build(AccessControl *head) {
+  AclIndex *ai;
+  AccessControl *a;
+  AttributeName *an;
+  AclIndexDN *aid;
+  AclIndexAttr *aia;
+  struct berval tail;
+  int n = 0, nattr = 0, ntail = 0, words, i;
+  unsigned size;
+  char *p;
+
+  for (a = head; a != NULL; a = a->acl_next) {
+    if (a->acl_index) {
+      acl_index_free(a->acl_index);
+      a->acl_index = NULL;
+    }
+    n++;
+    for (an = a->acl_attrs; an && an->an_name.bv_val; an++)
+      nattr++;
+    if (a->acl_dn_style == ACL_STYLE_REGEX) {
+      acl_regex_tail(&a->acl_dn_pat, &tail);
+      if (!BER_BVISEMPTY(&tail))
+        ntail++;
+    }
+  }
+  if (n < ACL_INDEX_MIN || n > ACL_INDEX_MAX)
+    return;
+
+  words = (n + 63) / 64;
+  for (size = 16; size < 2 * (unsigned)n; size <<= 1)
+    ;
+  p = ch_calloc(1, sizeof(AclIndex) + 2 * words * sizeof(uint64_t) + n * sizeof(AccessControl *) +
+                       size * (sizeof(AclIndexDN *) + sizeof(AclIndexAttr *)) + n * sizeof(AclIndexDN) +
+                       nattr * sizeof(AclIndexAttr) + ntail * sizeof(AclIndexTail));
+  ai = (AclIndex *)p;
+  p += sizeof(AclIndex);
+  ai->ai_n = n;
+  ai->ai_words = words;
+  ai->ai_anydn = (uint64_t *)p;
+  p += words * sizeof(uint64_t);
+  ai->ai_anyattr = (uint64_t *)p;
+  p += words * sizeof(uint64_t);
+  ai->ai_acl = (AccessControl **)p;
+  p += n * sizeof(AccessControl *);
+  ai->ai_mask = size - 1;
+  ai->ai_dn = (AclIndexDN **)p;
+  p += size * sizeof(AclIndexDN *);
+  ai->ai_attr = (AclIndexAttr **)p;
+  p += size * sizeof(AclIndexAttr *);
+  aid = (AclIndexDN *)p;
+  p += n * sizeof(AclIndexDN);
+  aia = (AclIndexAttr *)p;
+  p += nattr * sizeof(AclIndexAttr);
+  ai->ai_tail = (AclIndexTail *)p;
+
+  for (i = 0, a = head; a != NULL; i++, a = a->acl_next) {
+    ai->ai_acl[i] = a;
+
+    switch (a->acl_dn_style) {
+    case ACL_STYLE_BASE:
+    case ACL_STYLE_ONE:
+    case ACL_STYLE_SUBTREE:
+    case ACL_STYLE_CHILDREN:
+      if (!BER_BVISEMPTY(&a->acl_dn_pat)) {
+        uint32_t h = 2166136261u; /* FNV-1a */
+        ber_len_t j;
+
+        for (j = a->acl_dn_pat.bv_len; j > 0; j--)
+          h = ACL_INDEX_HASH(h, a->acl_dn_pat.bv_val[j - 1]);
+        aid->aid_hash = h;
+        aid->aid_ix = i;
+        aid->aid_next = ai->ai_dn[h & ai->ai_mask];
+        ai->ai_dn[h & ai->ai_mask] = aid++;
+        break;
+      }
+      ACL_INDEX_SET(ai->ai_anydn, i);
+      break;
+    case ACL_STYLE_REGEX:
+      acl_regex_tail(&a->acl_dn_pat, &tail);
+      if (!BER_BVISEMPTY(&tail)) {
+        ai->ai_tail[ai->ai_ntail].ait_tail = tail;
+        ai->ai_tail[ai->ai_ntail++].ait_ix = i;
+        break;
+      }
+      /* fallthru */
+    default:
+      ACL_INDEX_SET(ai->ai_anydn, i);
+      break;
+    }
+
+    for (an = a->acl_attrs; an && an->an_name.bv_val; an++) {
+      if (an->an_desc == NULL)
+        break;
+    }
+    if (a->acl_attrs == NULL || an->an_name.bv_val) {
+      ACL_INDEX_SET(ai->ai_anyattr, i);
+      continue;
+    }
+    for (an = a->acl_attrs; an->an_name.bv_val; an++) {
+      uint32_t h = acl_index_hash_type(an->an_desc->ad_type);
+
+      aia->aia_type = an->an_desc->ad_type;
+      aia->aia_ix = i;
+      aia->aia_next = ai->ai_attr[h & ai->ai_mask];
+      ai->ai_attr[h & ai->ai_mask] = aia++;
+    }
+  }
+
+  head->acl_index = ai;
+}
+
+/* Bring the cursor on the candidate from ix on, accounting the
+ * ACLs skipped as slap_acl_get() would have while walking them */
+static AccessControl *acl_cursor_skip(AclCursor *cur, int ix, AccessControl **prev, int *count,
+                                      AccessControlState *state) {
+  AclIndex *ai = cur->ac_index;
+  int j = ai->ai_n, w;
+
+  for (w = ix / 64; w < ai->ai_words; w++) {
+    uint64_t bits = cur->ac_cand[w];
+
+    if (w == ix / 64)
+      bits &= ~0ull << (ix % 64);
+    if (bits) {
+      j = w * 64 + __builtin_ctzll(bits);
+      break;
+    }
+  }
+
+  if (j > ix) {
+    *count += j - ix;
+    if (state->as_fe_done)
+      state->as_fe_done += j - ix - (ix == 0 && ai->ai_acl[0] == frontendDB->be_acl);
+  }
+  if (j > 0)
+    *prev = ai->ai_acl[j - 1];
+  cur->ac_ix = j;
+  return j < ai->ai_n ? ai->ai_acl[j] : NULL;
+}
+
+/* Start walking the list of ACLs at head for the entry and attribute */
+static AccessControl *acl_cursor_first(AclCursor *cur, AccessControl *head, Entry *e, AttributeDescription *desc,
+                                       AccessControl **prev, int *count, AccessControlState *state) {
+  AclIndex *ai = head->acl_index;
+  uint64_t bydn[ACL_CURSOR_WORDS], byattr[ACL_CURSOR_WORDS];
+  const char *ndn = e->e_nname.bv_val;
+  ber_len_t len = e->e_nname.bv_len, i;
+  AclIndexDN *aid;
+  AclIndexAttr *aia;
+  AttributeType *at;
+  uint32_t h;
+  int w;
+
+  cur->ac_index = ai;
+  if (ai == NULL)
+    return head;
+
+  memcpy(bydn, ai->ai_anydn, ai->ai_words * sizeof(uint64_t));
+  memcpy(byattr, ai->ai_anyattr, ai->ai_words * sizeof(uint64_t));
+
+  /* each suffix of the DN, the DN itself first */
+  for (h = 2166136261u, i = len; i > 0;) {
+    h = ACL_INDEX_HASH(h, ndn[--i]);
+    if (i > 0 && !DN_SEPARATOR(ndn[i - 1]))
+      continue;
+    for (aid = ai->ai_dn[h & ai->ai_mask]; aid != NULL; aid = aid->aid_next) {
+      AccessControl *a = ai->ai_acl[aid->aid_ix];
+
+      if (aid->aid_hash != h || a->acl_dn_pat.bv_len != len - i || memcmp(a->acl_dn_pat.bv_val, ndn + i, len - i))
+        continue;
+      if (a->acl_dn_style == ACL_STYLE_SUBTREE || (a->acl_dn_style == ACL_STYLE_BASE) == (i == 0))
+        ACL_INDEX_SET(bydn, aid->aid_ix);
+    }
+  }
+  for (w = 0; w < ai->ai_ntail; w++) {
+    struct berval *tail = &ai->ai_tail[w].ait_tail;
+
+    /* the regexes are compiled with REG_ICASE */
+    if (len >= tail->bv_len && !strncasecmp(ndn + len - tail->bv_len, tail->bv_val, tail->bv_len))
+      ACL_INDEX_SET(bydn, ai->ai_tail[w].ait_ix);
+  }
+
+  for (at = desc->ad_type; at != NULL; at = at->sat_sup) {
+    h = acl_index_hash_type(at);
+    for (aia = ai->ai_attr[h & ai->ai_mask]; aia != NULL; aia = aia->aia_next) {
+      if (aia->aia_type == at)
+        ACL_INDEX_SET(byattr, aia->aia_ix);
+    }
+  }
+
+  for (w = 0; w < ai->ai_words; w++)
+    cur->ac_cand[w] = bydn[w] & byattr[w];
+
+  return acl_cursor_skip(cur, 0, prev, count, state);
+}
+
+/* The next ACL to check after a */
+static AccessControl *acl_cursor_next(AclCursor *cur, AccessControl *a, AccessControl **prev, int *count,
+                                      AccessControlState *state) {
+  if (cur->ac_index && cur->ac_ix < cur->ac_index->ai_n && cur->ac_index->ai_acl[cur->ac_ix] == a)
+    return acl_cursor_skip(cur, cur->ac_ix + 1, prev, count, state);
+
+  /* not from the cursor, e.g. restarting at a value dependent ACL */
+  cur->ac_index = NULL;
+  *prev = a;
+  return a->acl_next;
+}
+
 /*
  * slap_acl_get - return the acl applicable to entry e, attribute
  * attr.  the acl returned is suitable for use in subsequent calls to
@@ -398,7 +980,7 @@ done:
 
 static AccessControl *slap_acl_get(AccessControl *a, int *count, Operation *op, Entry *e, AttributeDescription *desc,
                                    struct berval *val, AclRegexMatches *matches, slap_mask_t *mask,
-                                   AccessControlState *state) {
+                                   AccessControlState *state, AclCursor *cur) {
   const char *attr;
   ber_len_t dnlen;
   AccessControl *prev;
@@ -423,15 +1005,15 @@ static AccessControl *slap_acl_get(AccessControl *a, int *count, Operation *op,
     assert(a != NULL);
     if (a == frontendDB->be_acl)
       state->as_fe_done = 1;
+    a = acl_cursor_first(cur, a, e, desc, &prev, count, state);
   } else {
-    prev = a;
-    a = a->acl_next;
+    a = acl_cursor_next(cur, a, &prev, count, state);
   }
 
   dnlen = e->e_nname.bv_len;
 
 retry:
-  for (; a != NULL; prev = a, a = a->acl_next) {
+  for (; a != NULL; a = acl_cursor_next(cur, a, &prev, count, state)) {
     (*count)++;
 
     if (a != frontendDB->be_acl && state->as_fe_done)
@@ -581,7 +1163,7 @@ retry:
 
   if (!state->as_fe_done) {
     state->as_fe_done = 1;
-    a = frontendDB->be_acl;
+    a = acl_cursor_first(cur, frontendDB->be_acl, e, desc, &prev, count, state);
     goto retry;
   }
 
@@ -883,7 +1465,7 @@ static int acl_mask_dnattr(Operation *op, Entry *e, struct berval *val, AccessCo
   bv = *opndn;
 
   /* see if asker is listed in dnattr */
-  for (at = attrs_find(e->e_attrs, bdn->a_at); at != NULL; at = attrs_find(at->a_next, bdn->a_at)) {
+  for (at = entry_attrs_find(e, bdn->a_at); at != NULL; at = attrs_find(at->a_next, bdn->a_at)) {
     if (attr_valfind(at, SLAP_MR_ATTRIBUTE_VALUE_NORMALIZED_MATCH | SLAP_MR_ASSERTED_VALUE_NORMALIZED_MATCH, &bv, NULL,
                      op->o_tmpmemctx) == 0) {
       /* found it */
@@ -1781,6 +2363,103 @@ done:
   return (ret);
 }
 
+static int acl_at_overlaps(AttributeDescription *ad, AttributeDescription *desc) {
+  return ad != NULL && (is_at_subtype(ad->ad_type, desc->ad_type) || is_at_subtype(desc->ad_type, ad->ad_type));
+}
+
+static int acl_filter_reads_attr(Filter *f, AttributeDescription *desc) {
+  for (; f != NULL; f = f->f_next) {
+    switch (f->f_choice) {
+    case LDAP_FILTER_AND:
+    case LDAP_FILTER_OR:
+    case LDAP_FILTER_NOT:
+      if (acl_filter_reads_attr(f->f_list, desc))
+        return 1;
+      break;
+    case LDAP_FILTER_PRESENT:
+      if (acl_at_overlaps(f->f_desc, desc))
+        return 1;
+      break;
+    case LDAP_FILTER_EQUALITY:
+    case LDAP_FILTER_GE:
+    case LDAP_FILTER_LE:
+    case LDAP_FILTER_APPROX:
+      if (acl_at_overlaps(f->f_av_desc, desc))
+        return 1;
+      break;
+    case LDAP_FILTER_SUBSTRINGS:
+      if (acl_at_overlaps(f->f_sub_desc, desc))
+        return 1;
+      break;
+    case LDAP_FILTER_EXT:
+      /* no description means any attribute */
+      if (f->f_mr_desc == NULL || acl_at_overlaps(f->f_mr_desc, desc))
+        return 1;
+      break;
+    default:
+      break;
+    }
+  }
+  return 0;
+}
+
+/* whether the "to" DN part of a may select the entry ndn */
+static int acl_dn_may_apply(AccessControl *a, struct berval *ndn) {
+  struct berval pdn;
+
+  switch (a->acl_dn_style) {
+  case ACL_STYLE_REGEX:
+    return BER_BVISEMPTY(&a->acl_dn_pat) || regexec(&a->acl_dn_re, ndn->bv_val, 0, NULL, 0) == 0;
+  case ACL_STYLE_BASE:
+    return dn_match(&a->acl_dn_pat, ndn);
+  case ACL_STYLE_ONE:
+    dnParent(ndn, &pdn);
+    return !BER_BVISEMPTY(ndn) && dn_match(&a->acl_dn_pat, &pdn);
+  case ACL_STYLE_SUBTREE:
+    return dnIsSuffix(ndn, &a->acl_dn_pat);
+  case ACL_STYLE_CHILDREN:
+    return !dn_match(&a->acl_dn_pat, ndn) && dnIsSuffix(ndn, &a->acl_dn_pat);
+  default:
+    return 1;
+  }
+}
+
+/*
+ * acl_reads_attr - tells whether evaluating the access controls of be
+ * (including the frontend ones) may look at the values of attribute desc
+ * in the target entry ndn, e.g. by dnattr, group, set or a "to" filter.
+ * Backends use it to decide whether an entry with desc only partially
+ * loaded may be passed to access_allowed().
+ */
+int acl_reads_attr(BackendDB *be, struct berval *ndn, AttributeDescription *desc) {
+  AccessControl *a = be ? be->be_acl : NULL;
+  Access *b;
+  int pass;
+
+  for (pass = 0; pass < 2; pass++, a = frontendDB->be_acl) {
+    for (; a != NULL; a = a->acl_next) {
+      if (!acl_dn_may_apply(a, ndn))
+        continue;
+      if (acl_filter_reads_attr(a->acl_filter, desc))
+        return 1;
+      for (b = a->acl_access; b != NULL; b = b->a_next) {
+        if (acl_at_overlaps(b->a_dn_at, desc) || acl_at_overlaps(b->a_realdn_at, desc) ||
+            !BER_BVISEMPTY(&b->a_set_pat))
+          return 1;
+        /* a group is only read from the target if it is the target */
+        if (!BER_BVISEMPTY(&b->a_group_pat) && acl_at_overlaps(b->a_group_at, desc) &&
+            (b->a_group_style == ACL_STYLE_EXPAND || dn_match(&b->a_group_pat, ndn)))
+          return 1;
+#ifdef SLAP_DYNACL
+        if (b->a_dynacl != NULL)
+          return 1;
+#endif /* SLAP_DYNACL */
+      }
+    }
+  }
+  return 0;
+}
+
 int acl_get_part(struct berval *list, int ix, char sep, struct berval *bv) {
   int len;
   char *p;
@@ -1846,7 +2525,7 @@ static int acl_set_cb_gather(Operation *op, SlapReply *rs) {
       } else {
         Attribute *a;
 
-        a = attr_find(rs->sr_entry->e_attrs, desc);
+        a = entry_attr_find(rs->sr_entry, desc);
         if (a != NULL) {
           bvalsp = a->a_nvals;
         }
@@ -2103,9 +2782,17 @@ int acl_match_set(struct berval *subj, Operation *op, Entry *e, struct berval *d
   }
 
   if (!BER_BVISNULL(&set)) {
-    cookie.asc_op = op;
-    cookie.asc_e = e;
-    rc = (slap_set_filter(acl_set_gather, (SetCookie *)&cookie, &set, &op->o_ndn, &e->e_nname, NULL) > 0);
+    /* the same for any target unless it refers to it */
+    struct berval endn = *(struct berval *)&slap_empty_bv;
+
+    if (memmem(set.bv_val, set.bv_len, "this", STRLENOF("this")))
+      endn = e->e_nname;
+    if (!group_cache_get(op, NULL, &set, NULL, NULL, &op->o_ndn, &endn, &rc)) {
+      cookie.asc_op = op;
+      cookie.asc_e = e;
+      rc = (slap_set_filter(acl_set_gather, (SetCookie *)&cookie, &set, &op->o_ndn, &e->e_nname, NULL) > 0);
+      group_cache_put(op, NULL, &set, NULL, NULL, &op->o_ndn, &endn, rc);
+    }
     if (set.bv_val != subj->bv_val) {
       slap_sl_free(set.bv_val, op->o_tmpmemctx);
     }
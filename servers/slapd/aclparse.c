@@ -2115,6 +2115,7 @@ static void access_append(Access **l, Access *a) {
 }
 
 void acl_append(AccessControl **l, AccessControl *a, int pos) {
+  AccessControl **head = l;
   int i;
 
   for (i = 0; i != pos && *l != NULL; l = &(*l)->acl_next, i++) {
@@ -2123,6 +2124,8 @@ void acl_append(AccessControl **l, AccessControl *a, int pos) {
   if (*l && a)
     a->acl_next = *l;
   *l = a;
+  acl_index_build(*head);
+  acl_cache_invalidate();
 }
 
 static void access_free(Access *a) {
@@ -2173,6 +2176,10 @@ void acl_free(AccessControl *a) {
   Access *n;
   AttributeName *an;
 
+  acl_cache_invalidate();
+
+  if (a->acl_index)
+    acl_index_free(a->acl_index);
   if (a->acl_filter) {
     filter_free(a->acl_filter);
   }
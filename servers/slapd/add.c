@@ -68,7 +68,8 @@ int do_add(Operation *op, SlapReply *rs) {
 
     tmp.sml_nvalues = NULL;
 
-    rtag = ber_scanf(ber, "{m{W}}", &tmp.sml_type, &tmp.sml_values);
+    /* the values are left in the PDU, which outlives the operation */
+    rtag = ber_scanf(ber, "{m{w}}", &tmp.sml_type, &tmp.sml_values);
 
     if (rtag == LBER_ERROR) {
       Debug(LDAP_DEBUG_ANY, "%s do_add: decoding error\n", op->o_log_prefix);
@@ -85,7 +86,7 @@ int do_add(Operation *op, SlapReply *rs) {
 
     mod = (Modifications *)ch_malloc(sizeof(Modifications));
     mod->sml_op = LDAP_MOD_ADD;
-    mod->sml_flags = 0;
+    mod->sml_flags = SLAP_MOD_INPLACE;
     mod->sml_next = NULL;
     mod->sml_desc = NULL;
     mod->sml_type = tmp.sml_type;
@@ -161,7 +162,10 @@ int do_add(Operation *op, SlapReply *rs) {
   LDAP_SLIST_INSERT_HEAD(&op->o_extra, &oex->oe, oe_next);
 
   op->o_bd = frontendDB;
+  slap_op_stamp(op, SLAP_STAMP_BACKEND);
   rc = slap_biglock_call_be(op_add, op, rs);
+  if (rc != SLAPD_ASYNCOP)
+    slap_op_stamp(op, SLAP_STAMP_BACKEND_DONE);
 
   if (rc == SLAPD_ASYNCOP) {
     /* skip cleanup */
@@ -357,6 +361,10 @@ int slap_mods2entry(Modifications *mods, Entry **e, int initial, int dup, const
 
     assert(mods->sml_desc != NULL);
 
+    /* the entry may outlive the request */
+    if (!dup)
+      slap_mod_own(&mods->sml_mod);
+
     attr = attr_find((*e)->e_attrs, mods->sml_desc);
 
     if (attr != NULL) {
@@ -222,6 +222,7 @@ void at_delete(AttributeType *at) {
   LDAP_STAILQ_REMOVE(&attr_list, at, AttributeType, sat_next);
 
   at_delete_names(at);
+  dn_cache_flush();
 }
 
 static void at_clean(AttributeType *a) {
@@ -516,6 +517,9 @@ static int at_insert(AttributeType **rat, AttributeType *prev, const char **err)
     LDAP_STAILQ_INSERT_TAIL(&attr_list, sat, sat_next);
   }
 
+  /* the DNs may be normalized differently now */
+  dn_cache_flush();
+
   return 0;
 }
 
@@ -584,6 +584,149 @@ Attribute *attr_find(Attribute *a, AttributeDescription *desc) {
   return (NULL);
 }
 
+/*
+ * Lookup index of the attributes of wide entries.
+ *
+ * A backend whose entries keep their attributes unchanged while they
+ * are in use may reserve room for an index with attr_index_init().
+ * The index is built on the second lookup through entry_attr_find()
+ * or entry_attrs_find(), and maps each attribute type to the first
+ * attribute of that type in e_attrs, so that a lookup starts there
+ * instead of at the head, and an absent type costs a single probe.
+ *
+ * It only serves the entry it was reserved for, not its copies, and
+ * as long as the head and the tail of e_attrs stay the same; otherwise
+ * the lookups just fall back to the scan of the list.
+ */
+
+#define ATTR_INDEX_MIN 16 /* attributes below which a scan is cheaper */
+#define ATTR_INDEX_MAX 0xffff
+
+struct AttrIndex {
+  Entry *ai_entry;   /* the entry served, NULL when unusable */
+  Attribute *ai_last; /* the last attribute, NULL until built */
+  unsigned ai_nattrs; /* room in ai_attrs */
+  unsigned ai_mask;   /* slots - 1 */
+  unsigned ai_lookups;
+  Attribute **ai_attrs;
+  unsigned short *ai_slots; /* 1 + index in ai_attrs, 0 when free */
+};
+
+static unsigned attr_index_slots(int nattrs) {
+  unsigned slots = ATTR_INDEX_MIN;
+
+  while (slots < 2u * nattrs)
+    slots <<= 1;
+  return slots;
+}
+
+/* the room to reserve for an entry of nattrs, 0 when not worth it */
+size_t attr_index_size(int nattrs) {
+  if (nattrs < ATTR_INDEX_MIN || nattrs > ATTR_INDEX_MAX)
+    return 0;
+  return sizeof(AttrIndex) + nattrs * sizeof(Attribute *) + attr_index_slots(nattrs) * sizeof(unsigned short);
+}
+
+/* set up the index in mem, of attr_index_size(nattrs) bytes */
+void attr_index_init(Entry *e, void *mem, int nattrs) {
+  AttrIndex *ai = mem;
+
+  ai->ai_entry = e;
+  ai->ai_last = NULL;
+  ai->ai_nattrs = nattrs;
+  ai->ai_mask = attr_index_slots(nattrs) - 1;
+  ai->ai_lookups = 0;
+  ai->ai_attrs = (Attribute **)(ai + 1);
+  ai->ai_slots = (unsigned short *)(ai->ai_attrs + nattrs);
+  e->e_aindex = ai;
+}
+
+static __inline unsigned attr_index_hash(AttrIndex *ai, AttributeType *at) {
+  return (unsigned)(((uintptr_t)at * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & ai->ai_mask;
+}
+
+static int attr_index_build(AttrIndex *ai, Entry *e) {
+  Attribute *a;
+  unsigned n, i;
+
+  memset(ai->ai_slots, 0, (ai->ai_mask + 1) * sizeof(unsigned short));
+  for (n = 0, a = e->e_attrs; a != NULL; a = a->a_next, n++) {
+    AttributeType *at = a->a_desc->ad_type;
+
+    if (n == ai->ai_nattrs) {
+      /* grown behind our back */
+      ai->ai_entry = NULL;
+      return 0;
+    }
+    ai->ai_attrs[n] = a;
+    for (i = attr_index_hash(ai, at); ai->ai_slots[i]; i = (i + 1) & ai->ai_mask)
+      if (ai->ai_attrs[ai->ai_slots[i] - 1]->a_desc->ad_type == at)
+        break;
+    if (!ai->ai_slots[i])
+      ai->ai_slots[i] = n + 1;
+  }
+  if (!n)
+    return 0;
+
+  ai->ai_last = ai->ai_attrs[n - 1];
+  return 1;
+}
+
+static int attr_index_ready(Entry *e) {
+  AttrIndex *ai = e->e_aindex;
+
+  if (!ai || ai->ai_entry != e)
+    return 0;
+  if (ai->ai_last)
+    return ai->ai_attrs[0] == e->e_attrs && ai->ai_last->a_next == NULL;
+  /* a single lookup is cheaper with a scan */
+  if (!ai->ai_lookups++)
+    return 0;
+  return attr_index_build(ai, e);
+}
+
+/* the first attribute of the type */
+static Attribute *attr_index_find(AttrIndex *ai, AttributeType *at) {
+  unsigned i;
+
+  for (i = attr_index_hash(ai, at); ai->ai_slots[i]; i = (i + 1) & ai->ai_mask) {
+    Attribute *a = ai->ai_attrs[ai->ai_slots[i] - 1];
+
+    if (a->a_desc->ad_type == at)
+      return a;
+  }
+  return NULL;
+}
+
+/*
+ * entry_attrs_find - attrs_find(e->e_attrs, desc) using the index
+ */
+
+Attribute *entry_attrs_find(Entry *e, AttributeDescription *desc) {
+  Attribute *a;
+
+  /* the attributes of a subtype would have to be looked up too */
+  if (desc->ad_type->sat_subtypes || !attr_index_ready(e))
+    return attrs_find(e->e_attrs, desc);
+
+  a = attr_index_find(e->e_aindex, desc->ad_type);
+  return a ? attrs_find(a, desc) : NULL;
+}
+
+/*
+ * entry_attr_find - attr_find(e->e_attrs, desc) using the index
+ */
+
+Attribute *entry_attr_find(Entry *e, AttributeDescription *desc) {
+  Attribute *a;
+
+  if (!attr_index_ready(e))
+    return attr_find(e->e_attrs, desc);
+
+  a = attr_index_find(e->e_aindex, desc->ad_type);
+  return a ? attr_find(a, desc) : NULL;
+}
+
 /*
  * attr_delete - delete the attribute type in list pointed to by attrs
  * return	0	deleted ok
@@ -85,6 +85,7 @@ static Modifications *asyncmeta_copy_modlist(Operation *op, Modifications *modli
         ber_bvarray_dup_x(&mod->sml_nvalues, ml->sml_nvalues, op->o_tmpmemctx);
       }
     }
+    mod->sml_flags &= ~SLAP_MOD_INPLACE;
     mod->sml_next = NULL;
     if (new_mods == NULL) {
       new_mods = mod;
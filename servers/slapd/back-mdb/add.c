@@ -337,6 +337,8 @@ int mdb_add(Operation *op, SlapReply *rs) {
     mc = NULL;
   }
 
+  mdb_compact_note(mdb, op->ora_e->e_id);
+
   if (moi == &opinfo) {
     LDAP_SLIST_REMOVE(&op->o_extra, &opinfo.moi_oe, OpExtra, oe_next);
     opinfo.moi_oe.oe_key = NULL;
@@ -68,6 +68,9 @@ typedef struct mdb_monitor_t {
 /* From ldap_rq.h */
 struct re_s;
 
+/* From warmup.c */
+struct mdb_warmup;
+
 struct mdb_info {
   MDBX_env *mi_dbenv;
 
@@ -103,6 +106,28 @@ struct mdb_info {
 
   mdb_monitor_t mi_monitor;
 
+  /* online compaction, see compact.c */
+  struct re_s *mi_compact_task;
+  uint32_t mi_compact_period;
+  unsigned mi_compact_percent;
+  volatile int mi_compact_active;
+  ldap_pvt_thread_mutex_t mi_compact_mutex;
+  ID *mi_compact_dirty; /* IDs written since the compaction snapshot */
+  unsigned mi_compact_ndirty;
+  unsigned mi_compact_maxdirty;
+
+  /* startup warmup, see warmup.c */
+  BerVarray mi_warmup_names;
+  uint32_t mi_warmup_rate; /* kbyte/s, 0 is unlimited */
+  struct mdb_warmup *mi_warmup;
+  ldap_pvt_thread_mutex_t mi_warmup_mutex; /* guards mi_warmup against the monitor */
+
+  /* entryUUID -> ID, see uuid2id.c */
+  MDBX_dbi mi_uuid2id;
+  volatile int mi_uuid2id_ready;
+  ID mi_uuid2id_next;
+  struct re_s *mi_uuid2id_task;
+
 #ifdef MDB_MONITOR_IDX
   ldap_pvt_thread_mutex_t mi_idx_mutex;
   Avlnode *mi_idx;
@@ -114,6 +139,7 @@ struct mdb_info {
 #define MDB_DEL_INDEX 0x08
 #define MDB_RE_OPEN 0x10
 #define MDB_NEED_UPGRADE 0x20
+#define MDB_ID2VAL_UNSORTED 0x40
 
   ldap_pvt_thread_mutex_t mi_ads_mutex;
   int mi_numads;
@@ -151,6 +177,14 @@ typedef struct mdb_op_info {
 #define MOI_FREEIT 0x02
 #define MOI_KEEPER 0x04
 
+/* While present in op->o_extra, mdb_entry_decode() loads only the asserted
+ * value of a multival attribute mai_desc, see compare.c */
+typedef struct mdb_ava_info {
+  OpExtra mai_oe;
+  AttributeDescription *mai_desc;
+  struct berval *mai_nval;
+} mdb_ava_info;
+
 LDAP_END_DECL
 
 /* for the cache of attribute information (which are indexed, etc.) */
@@ -0,0 +1,882 @@
+/* $ReOpenLDAP$ */
+/* Copyright 2011-2018 ReOpenLDAP AUTHORS: please see AUTHORS file.
+ * All rights reserved.
+ *
+ * This file is part of ReOpenLDAP.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the OpenLDAP
+ * Public License.
+ *
+ * A copy of this license is available in the file LICENSE in the
+ * top-level directory of the distribution or, alternatively, at
+ * <http://www.OpenLDAP.org/license.html>.
+ */
+
+/* Online compaction.
+ *
+ * Entry IDs are never reused, so after heavy churn the ID space becomes
+ * sparse and range IDLs in the indices lose precision. The compactor
+ * copies the live database into a fresh environment next to it, walking
+ * dn2id from the root so that every entry gets a dense new ID with parents
+ * always numbered before their children. Writes that happen meanwhile are
+ * recorded by mdb_compact_note() and replayed into the copy. The last
+ * replay runs with the server paused, then the copy replaces the live
+ * data file and the database is reopened.
+ */
+
+#include "reldap.h"
+
+#include <stdio.h>
+#include <ac/string.h>
+#include <ac/errno.h>
+#include <ac/unistd.h>
+
+#include "back-mdb.h"
+#include "ldap_rq.h"
+
+#include "slapconfig.h"
+
+/* Entries written per transaction into the new environment */
+#define MDB_COMPACT_BATCH 1024
+
+/* Catch-up passes done online before pausing the server for the last one */
+#define MDB_COMPACT_ROUNDS 8
+
+#define MDB_COMPACT_SUFFIX ".compact"
+#define MDB_COMPACT_BACKUP ".orig"
+
+typedef struct compact_info {
+  BackendDB *ci_be; /* the live database */
+  struct mdb_info *ci_mdb;
+  BackendDB ci_nbe; /* shadow of ci_be, writing into ci_env */
+  struct mdb_info *ci_nmdb;
+  MDBX_env *ci_env;
+  MDBX_txn *ci_txn;       /* current write txn in ci_env */
+  MDBX_cursor *ci_dn2id;  /* dn2id cursor of ci_txn */
+  MDBX_dbi ci_o2n;        /* old ID -> new ID */
+  ID ci_lastid;           /* last ID given out in ci_env */
+  unsigned ci_pending;    /* entries written in ci_txn */
+  char *ci_path;
+} compact_info;
+
+typedef struct compact_level {
+  MDBX_cursor *cl_mc; /* walks the children of an entry in the live dn2id */
+  ID cl_nid;          /* the ID of that entry in the new environment */
+} compact_level;
+
+typedef struct compact_item {
+  ID ci_oid;
+  ID ci_nid;
+  ID ci_nsubs;
+  int ci_depth;
+} compact_item;
+
+void mdb_compact_note(struct mdb_info *mdb, ID id) {
+  /* Cheap unlocked test first. The flag is raised before the compactor
+   * waits out the current writer, so any txn that starts later sees it. */
+  if (!slap_tsan__read_int(&mdb->mi_compact_active))
+    return;
+
+  ldap_pvt_thread_mutex_lock(&mdb->mi_compact_mutex);
+  if (mdb->mi_compact_active) {
+    if (mdb->mi_compact_ndirty == mdb->mi_compact_maxdirty) {
+      mdb->mi_compact_maxdirty = mdb->mi_compact_maxdirty ? mdb->mi_compact_maxdirty * 2 : 64;
+      mdb->mi_compact_dirty = ch_realloc(mdb->mi_compact_dirty, mdb->mi_compact_maxdirty * sizeof(ID));
+    }
+    mdb->mi_compact_dirty[mdb->mi_compact_ndirty++] = id;
+  }
+  ldap_pvt_thread_mutex_unlock(&mdb->mi_compact_mutex);
+}
+
+/* Borrow the thread's reader txn of the live database */
+static int compact_rtxn_get(Operation *op, struct mdb_info *mdb, mdb_op_info *opinfo, MDBX_txn **txn) {
+  mdb_op_info *moi = opinfo;
+  int rc;
+
+  memset(opinfo, 0, sizeof(*opinfo));
+  rc = mdb_opinfo_get(op, mdb, 1, &moi);
+  if (rc == 0) {
+    assert(moi == opinfo);
+    *txn = moi->moi_txn;
+  }
+  return rc;
+}
+
+static void compact_rtxn_done(Operation *op, mdb_op_info *opinfo) {
+  if (opinfo->moi_txn) {
+    int __maybe_unused rc2 = mdbx_txn_reset(opinfo->moi_txn);
+    assert(rc2 == MDBX_SUCCESS);
+    opinfo->moi_txn = NULL;
+  }
+  if (opinfo->moi_oe.oe_key) {
+    LDAP_SLIST_REMOVE(&op->o_extra, &opinfo->moi_oe, OpExtra, oe_next);
+    opinfo->moi_oe.oe_key = NULL;
+  }
+}
+
+static int compact_cmp_id(const void *a, const void *b) {
+  ID x = *(const ID *)a, y = *(const ID *)b;
+  return mdbx_cmp2int(x, y);
+}
+
+static int compact_cmp_deepest(const void *a, const void *b) {
+  const compact_item *x = a, *y = b;
+  return mdbx_cmp2int(y->ci_depth, x->ci_depth);
+}
+
+static int compact_cmp_shallowest(const void *a, const void *b) {
+  const compact_item *x = a, *y = b;
+  return mdbx_cmp2int(x->ci_depth, y->ci_depth);
+}
+
+static int compact_depth(struct berval *ndn) {
+  struct berval bv = *ndn, pdn;
+  int depth = 0;
+
+  while (!BER_BVISEMPTY(&bv)) {
+    dnParent(&bv, &pdn);
+    bv = pdn;
+    depth++;
+  }
+  return depth;
+}
+
+/* The compactor must never stall a server pause (cn=config changes,
+ * shutdown), so it gives up and retries at the next interval instead. */
+static int compact_interrupted(compact_info *ci) {
+  return slapd_shutdown || slap_biglock_pool_pausing(ci->ci_be) > 0;
+}
+
+/* Wait out the live writer. Writers note their IDs before committing,
+ * so once this returns every noted change is visible to a new reader. */
+static int compact_barrier(struct mdb_info *mdb) {
+  MDBX_txn *txn;
+  int rc;
+
+  rc = mdbx_txn_begin(mdb->mi_dbenv, NULL, 0, &txn);
+  if (rc == MDBX_SUCCESS)
+    mdbx_txn_abort(txn);
+  return rc;
+}
+
+static int compact_txn_begin(compact_info *ci) {
+  int rc;
+
+  rc = mdbx_txn_begin(ci->ci_env, NULL, 0, &ci->ci_txn);
+  if (rc == MDBX_SUCCESS) {
+    rc = mdbx_cursor_open(ci->ci_txn, ci->ci_nmdb->mi_dn2id, &ci->ci_dn2id);
+    if (rc) {
+      mdbx_txn_abort(ci->ci_txn);
+      ci->ci_txn = NULL;
+    }
+  }
+  ci->ci_pending = 0;
+  return rc;
+}
+
+static int compact_txn_commit(compact_info *ci) {
+  int rc;
+
+  mdbx_cursor_close(ci->ci_dn2id);
+  ci->ci_dn2id = NULL;
+  rc = mdbx_txn_commit(ci->ci_txn);
+  ci->ci_txn = NULL;
+  return rc;
+}
+
+/* Make the AD table of the new environment match the live one
+ * as of rtxn, keeping the same numbering. */
+static int compact_ads_sync(compact_info *ci, MDBX_txn *rtxn) {
+  MDBX_cursor *mc;
+  MDBX_val key, data;
+  int i, rc;
+
+  rc = mdbx_cursor_open(rtxn, ci->ci_mdb->mi_ad2id, &mc);
+  if (rc)
+    return rc;
+
+  i = ci->ci_nmdb->mi_numads + 1;
+  key.iov_len = sizeof(int);
+  key.iov_base = &i;
+  rc = mdbx_cursor_get(mc, &key, &data, MDBX_SET_RANGE);
+  while (rc == MDBX_SUCCESS) {
+    rc = mdbx_put(ci->ci_txn, ci->ci_nmdb->mi_ad2id, &key, &data, 0);
+    if (rc)
+      break;
+    rc = mdbx_cursor_get(mc, &key, &data, MDBX_NEXT);
+  }
+  mdbx_cursor_close(mc);
+
+  if (rc == MDBX_NOTFOUND)
+    rc = mdb_ad_read(ci->ci_nmdb, ci->ci_txn);
+  return rc;
+}
+
+/* Copy live entry oid into the new environment under parent pid.
+ * A zero *nidp allocates the next new ID. */
+static int compact_put(compact_info *ci, Operation *op, MDBX_txn *rtxn, MDBX_cursor *id2e, MDBX_cursor **idcp, ID oid,
+                       ID pid, ID nsubs, int upsub, ID *nidp) {
+  Entry *e;
+  ID nid = *nidp;
+  MDBX_val key, data;
+  int rc;
+
+  op->o_bd = ci->ci_be;
+  rc = mdb_id2entry(op, id2e, oid, &e);
+  if (rc)
+    return rc;
+  rc = mdb_id2name(op, rtxn, idcp, oid, &e->e_name, &e->e_nname);
+  if (rc) {
+    mdb_entry_return(op, e);
+    return rc;
+  }
+
+  op->o_bd = &ci->ci_nbe;
+  if (!nid)
+    nid = ++ci->ci_lastid;
+  ci->ci_nmdb->_mi_nextid = ci->ci_lastid;
+  e->e_id = nid;
+
+  rc = mdb_dn2id_add(op, ci->ci_dn2id, ci->ci_dn2id, pid, nsubs, upsub, e);
+  if (rc == 0)
+    rc = mdb_id2entry_add(op, ci->ci_txn, NULL, e);
+  if (rc == 0)
+    rc = mdb_index_entry_add(op, ci->ci_txn, e);
+  if (rc == 0 && !*nidp) {
+    key.iov_len = data.iov_len = sizeof(ID);
+    key.iov_base = &oid;
+    data.iov_base = &nid;
+    rc = mdbx_put(ci->ci_txn, ci->ci_o2n, &key, &data, 0);
+  }
+
+  op->o_bd = ci->ci_be;
+  e->e_id = oid;
+  mdb_entry_return(op, e);
+
+  if (rc == 0) {
+    *nidp = nid;
+    ci->ci_pending++;
+  } else {
+    Debug(LDAP_DEBUG_ANY, LDAP_XSTRING(compact_put) ": entry %lu -> %lu failed: %s (%d)\n", (unsigned long)oid,
+          (unsigned long)nid, mdbx_strerror(rc), rc);
+  }
+  return rc;
+}
+
+/* Copy the snapshot the live database had when compaction started */
+static int compact_copy(compact_info *ci, Operation *op) {
+  mdb_op_info opinfo;
+  MDBX_txn *rtxn = NULL;
+  MDBX_cursor *id2e = NULL, *idc = NULL;
+  compact_level *stack = NULL;
+  MDBX_val key, data;
+  int depth = 0, maxdepth = 0, i, rc;
+  ID oid, nid, nsubs;
+
+  rc = compact_rtxn_get(op, ci->ci_mdb, &opinfo, &rtxn);
+  if (rc)
+    return rc;
+
+  rc = compact_ads_sync(ci, rtxn);
+  if (rc)
+    goto done;
+  rc = mdbx_cursor_open(rtxn, ci->ci_mdb->mi_id2entry, &id2e);
+  if (rc)
+    goto done;
+
+  /* Depth-first from the dummy root node, so each parent
+   * is copied (and numbered) before its children. */
+  oid = nid = 0;
+  for (;;) {
+    if (depth == maxdepth) {
+      maxdepth += 16;
+      stack = ch_realloc(stack, maxdepth * sizeof(compact_level));
+      memset(stack + depth, 0, 16 * sizeof(compact_level));
+    }
+    if (!stack[depth].cl_mc) {
+      rc = mdbx_cursor_open(rtxn, ci->ci_mdb->mi_dn2id, &stack[depth].cl_mc);
+      if (rc)
+        break;
+    }
+    key.iov_len = sizeof(ID);
+    key.iov_base = &oid;
+    /* positions on the entry's own node, its children follow */
+    rc = mdbx_cursor_get(stack[depth].cl_mc, &key, &data, MDBX_SET);
+    if (rc == MDBX_SUCCESS) {
+      stack[depth].cl_nid = nid;
+      depth++;
+    } else if (rc != MDBX_NOTFOUND) {
+      break;
+    }
+
+    rc = MDBX_NOTFOUND;
+    while (depth > 0) {
+      rc = mdbx_cursor_get(stack[depth - 1].cl_mc, &key, &data, MDBX_NEXT_DUP);
+      if (rc != MDBX_NOTFOUND)
+        break;
+      depth--;
+    }
+    if (rc)
+      break;
+
+    memcpy(&oid, (char *)data.iov_base + data.iov_len - 2 * sizeof(ID), sizeof(ID));
+    memcpy(&nsubs, (char *)data.iov_base + data.iov_len - sizeof(ID), sizeof(ID));
+    nid = 0;
+    rc = compact_put(ci, op, rtxn, id2e, &idc, oid, stack[depth - 1].cl_nid, nsubs, 0, &nid);
+    if (rc)
+      break;
+
+    if (ci->ci_pending >= MDB_COMPACT_BATCH) {
+      rc = compact_txn_commit(ci);
+      if (rc == MDBX_SUCCESS && compact_interrupted(ci))
+        rc = LDAP_BUSY;
+      if (rc == MDBX_SUCCESS)
+        rc = compact_txn_begin(ci);
+      if (rc)
+        break;
+    }
+  }
+  if (rc == MDBX_NOTFOUND)
+    rc = MDBX_SUCCESS;
+
+  for (i = 0; i < maxdepth; i++)
+    if (stack[i].cl_mc)
+      mdbx_cursor_close(stack[i].cl_mc);
+  ch_free(stack);
+
+done:
+  if (idc)
+    mdbx_cursor_close(idc);
+  if (id2e)
+    mdbx_cursor_close(id2e);
+  compact_rtxn_done(op, &opinfo);
+  return rc;
+}
+
+/* Drop the copy of an entry that changed since it was copied */
+static int compact_remove(compact_info *ci, Operation *op, compact_item *ci_item) {
+  MDBX_cursor *id2e;
+  struct berval dn, ndn;
+  Entry *e = NULL;
+  ID id, nsubs;
+  int rc;
+
+  op->o_bd = &ci->ci_nbe;
+  rc = mdb_id2name(op, ci->ci_txn, &ci->ci_dn2id, ci_item->ci_nid, &dn, &ndn);
+  if (rc)
+    return rc;
+  rc = mdb_dn2id(op, ci->ci_txn, ci->ci_dn2id, &ndn, &id, &nsubs, NULL, NULL);
+  if (rc == 0 && id != ci_item->ci_nid)
+    rc = MDBX_NOTFOUND;
+  if (rc == 0)
+    rc = mdb_dn2id_delete(op, ci->ci_dn2id, id, nsubs);
+  if (rc == 0)
+    rc = mdbx_cursor_open(ci->ci_txn, ci->ci_nmdb->mi_id2entry, &id2e);
+  if (rc == 0) {
+    rc = mdb_id2entry(op, id2e, id, &e);
+    mdbx_cursor_close(id2e);
+  }
+  if (rc == 0) {
+    e->e_name = dn;
+    e->e_nname = ndn;
+    BER_BVZERO(&dn);
+    BER_BVZERO(&ndn);
+    rc = mdb_index_entry_del(op, ci->ci_txn, e);
+    if (rc == 0)
+      rc = mdb_id2entry_delete(&ci->ci_nbe, ci->ci_txn, e);
+    mdb_entry_return(op, e);
+  }
+  op->o_tmpfree(dn.bv_val, op->o_tmpmemctx);
+  op->o_tmpfree(ndn.bv_val, op->o_tmpmemctx);
+  op->o_bd = ci->ci_be;
+
+  if (rc == 0)
+    ci_item->ci_nsubs = nsubs;
+  return rc;
+}
+
+/* Bring the copy up to date with writes recorded since the last pass */
+static int compact_replay(compact_info *ci, Operation *op, unsigned *count) {
+  struct mdb_info *mdb = ci->ci_mdb;
+  mdb_op_info opinfo;
+  MDBX_txn *rtxn = NULL;
+  MDBX_cursor *id2e = NULL, *idc = NULL;
+  MDBX_val key, data;
+  struct berval dn, ndn, pdn;
+  compact_item *items = NULL;
+  unsigned n, i, j;
+  ID *ids, pid;
+  int rc;
+
+  ldap_pvt_thread_mutex_lock(&mdb->mi_compact_mutex);
+  ids = mdb->mi_compact_dirty;
+  n = mdb->mi_compact_ndirty;
+  mdb->mi_compact_dirty = NULL;
+  mdb->mi_compact_ndirty = mdb->mi_compact_maxdirty = 0;
+  ldap_pvt_thread_mutex_unlock(&mdb->mi_compact_mutex);
+
+  *count = n;
+  if (!n)
+    return MDBX_SUCCESS;
+
+  qsort(ids, n, sizeof(ID), compact_cmp_id);
+  for (i = j = 1; i < n; i++)
+    if (ids[i] != ids[j - 1])
+      ids[j++] = ids[i];
+  n = j;
+
+  rc = compact_barrier(mdb);
+  if (rc == 0)
+    rc = compact_txn_begin(ci);
+  if (rc)
+    goto done;
+  rc = compact_rtxn_get(op, mdb, &opinfo, &rtxn);
+  if (rc)
+    goto done;
+  rc = compact_ads_sync(ci, rtxn);
+  if (rc)
+    goto done;
+
+  /* Remove the stale copies, children before their parents */
+  items = ch_calloc(n, sizeof(compact_item));
+  key.iov_len = sizeof(ID);
+  op->o_bd = &ci->ci_nbe;
+  for (i = 0; i < n; i++) {
+    items[i].ci_oid = ids[i];
+    key.iov_base = &ids[i];
+    rc = mdbx_get(ci->ci_txn, ci->ci_o2n, &key, &data);
+    if (rc == MDBX_NOTFOUND)
+      continue;
+    if (rc)
+      break;
+    memcpy(&items[i].ci_nid, data.iov_base, sizeof(ID));
+    rc = mdb_id2name(op, ci->ci_txn, &ci->ci_dn2id, items[i].ci_nid, &dn, &ndn);
+    if (rc)
+      break;
+    items[i].ci_depth = compact_depth(&ndn);
+    op->o_tmpfree(dn.bv_val, op->o_tmpmemctx);
+    op->o_tmpfree(ndn.bv_val, op->o_tmpmemctx);
+  }
+  op->o_bd = ci->ci_be;
+  if (rc && rc != MDBX_NOTFOUND)
+    goto done;
+
+  qsort(items, n, sizeof(compact_item), compact_cmp_deepest);
+  for (i = 0, rc = 0; i < n && rc == 0; i++)
+    if (items[i].ci_nid)
+      rc = compact_remove(ci, op, &items[i]);
+  if (rc)
+    goto done;
+
+  /* Copy the current versions, parents before their children */
+  for (i = 0; i < n; i++) {
+    rc = mdb_id2name(op, rtxn, &idc, items[i].ci_oid, &dn, &ndn);
+    if (rc == MDBX_NOTFOUND) {
+      /* deleted meanwhile */
+      items[i].ci_depth = -1;
+      if (items[i].ci_nid) {
+        key.iov_base = &items[i].ci_oid;
+        rc = mdbx_del(ci->ci_txn, ci->ci_o2n, &key, NULL);
+        if (rc)
+          break;
+      }
+      continue;
+    }
+    if (rc)
+      break;
+    items[i].ci_depth = compact_depth(&ndn);
+    op->o_tmpfree(dn.bv_val, op->o_tmpmemctx);
+    op->o_tmpfree(ndn.bv_val, op->o_tmpmemctx);
+  }
+  if (rc && rc != MDBX_NOTFOUND)
+    goto done;
+
+  rc = mdbx_cursor_open(rtxn, mdb->mi_id2entry, &id2e);
+  if (rc)
+    goto done;
+  qsort(items, n, sizeof(compact_item), compact_cmp_shallowest);
+  for (i = 0; i < n; i++) {
+    if (items[i].ci_depth < 0)
+      continue;
+
+    rc = mdb_id2name(op, rtxn, &idc, items[i].ci_oid, &dn, &ndn);
+    if (rc)
+      break;
+    pid = 0;
+    if (!be_issuffix(ci->ci_be, &ndn)) {
+      dnParent(&ndn, &pdn);
+      op->o_bd = &ci->ci_nbe;
+      rc = mdb_dn2id(op, ci->ci_txn, NULL, &pdn, &pid, NULL, NULL, NULL);
+      op->o_bd = ci->ci_be;
+    }
+    op->o_tmpfree(dn.bv_val, op->o_tmpmemctx);
+    op->o_tmpfree(ndn.bv_val, op->o_tmpmemctx);
+    if (rc)
+      break;
+
+    rc = compact_put(ci, op, rtxn, id2e, &idc, items[i].ci_oid, pid, items[i].ci_nsubs ? items[i].ci_nsubs : 1, 1,
+                     &items[i].ci_nid);
+    if (rc)
+      break;
+  }
+
+done:
+  if (idc)
+    mdbx_cursor_close(idc);
+  if (id2e)
+    mdbx_cursor_close(id2e);
+  if (rtxn)
+    compact_rtxn_done(op, &opinfo);
+  if (rc == MDBX_SUCCESS)
+    rc = compact_txn_commit(ci);
+  ch_free(items);
+  ch_free(ids);
+  return rc;
+}
+
+static int compact_open(compact_info *ci) {
+  struct mdb_info *mdb = ci->ci_mdb, *nmdb;
+  ConfigReply cr = {0};
+  int i, rc;
+
+  ci->ci_path = ch_malloc(strlen(mdb->mi_dbenv_home) + sizeof(MDBX_DATANAME MDB_COMPACT_SUFFIX MDBX_LOCK_SUFFIX));
+  sprintf(ci->ci_path, "%s" MDBX_DATANAME MDB_COMPACT_SUFFIX, mdb->mi_dbenv_home);
+
+  /* leftovers of an interrupted run */
+  unlink(ci->ci_path);
+  i = strlen(ci->ci_path);
+  strcpy(ci->ci_path + i, MDBX_LOCK_SUFFIX);
+  unlink(ci->ci_path);
+  ci->ci_path[i] = '\0';
+
+  rc = mdbx_env_create(&ci->ci_env);
+  if (rc)
+    return rc;
+  rc = mdbx_env_set_mapsize(ci->ci_env, mdb->mi_mapsize);
+  if (rc == 0)
+    rc = mdbx_env_set_maxdbs(ci->ci_env, MDB_INDICES);
+  if (rc == 0)
+    rc = mdbx_env_open(ci->ci_env, ci->ci_path,
+                       MDBX_NOSUBDIR | MDBX_SAFE_NOSYNC | (mdb->mi_dbenv_flags & MDBX_WRITEMAP),
+                       mdb->mi_dbenv_mode);
+  if (rc)
+    return rc;
+
+  /* A shadow backend, so the regular dn2id/id2entry/index code
+   * writes into the new environment. */
+  nmdb = ch_malloc(sizeof(struct mdb_info));
+  memcpy(nmdb, mdb, sizeof(struct mdb_info));
+  ci->ci_nmdb = nmdb;
+  nmdb->mi_dbenv = ci->ci_env;
+  nmdb->_mi_nextid = 0;
+  nmdb->mi_search_stack = NULL;
+  nmdb->mi_compact_active = 0;
+  nmdb->mi_compact_dirty = NULL;
+  nmdb->mi_compact_ndirty = nmdb->mi_compact_maxdirty = 0;
+  nmdb->mi_numads = 0;
+  memset(nmdb->mi_ads, 0, sizeof(nmdb->mi_ads));
+  memset(nmdb->mi_adxs, 0, sizeof(nmdb->mi_adxs));
+  ldap_pvt_thread_mutex_init(&nmdb->mi_ads_mutex);
+#ifdef MDB_MONITOR_IDX
+  ldap_pvt_thread_mutex_init(&nmdb->mi_idx_mutex);
+  nmdb->mi_idx = NULL;
+#endif /* MDB_MONITOR_IDX */
+  nmdb->mi_attrs = ch_malloc((mdb->mi_nattrs + 1) * sizeof(AttrInfo *));
+  for (i = 0; i < mdb->mi_nattrs; i++) {
+    AttrInfo *ai = ch_malloc(sizeof(AttrInfo));
+    *ai = *mdb->mi_attrs[i];
+    ai->ai_dbi = 0;
+    ai->ai_root = NULL;
+    ai->ai_flist = ai->ai_clist = NULL;
+    ai->ai_cursor = NULL;
+    nmdb->mi_attrs[i] = ai;
+  }
+  ci->ci_nbe = *ci->ci_be;
+  ci->ci_nbe.be_private = nmdb;
+
+  rc = mdbx_txn_begin(ci->ci_env, NULL, 0, &ci->ci_txn);
+  if (rc)
+    return rc;
+  for (i = 0; i < MDB_NDB && rc == 0; i++)
+    rc = mdb_main_dbi_open(ci->ci_txn, i, MDBX_CREATE, &nmdb->mi_dbis[i]);
+  if (rc == 0)
+    rc = mdb_uuid2id_open(nmdb, ci->ci_txn, MDBX_CREATE);
+  if (rc == 0)
+    rc = mdb_attr_dbs_open(&ci->ci_nbe, ci->ci_txn, &cr);
+  if (rc == 0)
+    rc = mdbx_dbi_open(ci->ci_txn, "compact.o2n", MDBX_INTEGERKEY | MDBX_CREATE, &ci->ci_o2n);
+  if (rc == 0)
+    rc = mdbx_cursor_open(ci->ci_txn, nmdb->mi_dn2id, &ci->ci_dn2id);
+  return rc;
+}
+
+static void compact_close(compact_info *ci, int discard) {
+  struct mdb_info *nmdb = ci->ci_nmdb;
+  int i;
+
+  if (ci->ci_dn2id)
+    mdbx_cursor_close(ci->ci_dn2id);
+  if (ci->ci_txn)
+    mdbx_txn_abort(ci->ci_txn);
+  if (ci->ci_env) {
+    if (!discard)
+      mdbx_env_sync_ex(ci->ci_env, 1, 0);
+    mdbx_env_close(ci->ci_env);
+  }
+  if (nmdb) {
+    for (i = 0; i < nmdb->mi_nattrs; i++)
+      ch_free(nmdb->mi_attrs[i]);
+    ch_free(nmdb->mi_attrs);
+    ldap_pvt_thread_mutex_destroy(&nmdb->mi_ads_mutex);
+#ifdef MDB_MONITOR_IDX
+    ldap_pvt_thread_mutex_destroy(&nmdb->mi_idx_mutex);
+#endif /* MDB_MONITOR_IDX */
+    ch_free(nmdb);
+  }
+  if (ci->ci_path && discard) {
+    i = strlen(ci->ci_path);
+    unlink(ci->ci_path);
+    strcpy(ci->ci_path + i, MDBX_LOCK_SUFFIX);
+    unlink(ci->ci_path);
+    ci->ci_path[i] = '\0';
+  }
+  ci->ci_dn2id = NULL;
+  ci->ci_txn = NULL;
+  ci->ci_env = NULL;
+  ci->ci_nmdb = NULL;
+}
+
+static void compact_stop_noting(struct mdb_info *mdb) {
+  ldap_pvt_thread_mutex_lock(&mdb->mi_compact_mutex);
+  mdb->mi_compact_active = 0;
+  ch_free(mdb->mi_compact_dirty);
+  mdb->mi_compact_dirty = NULL;
+  mdb->mi_compact_ndirty = mdb->mi_compact_maxdirty = 0;
+  ldap_pvt_thread_mutex_unlock(&mdb->mi_compact_mutex);
+}
+
+/* Check that the copy opens with the live layout while the live
+ * database is still open, so a broken copy is never swapped in. */
+static int compact_verify(compact_info *ci) {
+  struct mdb_info *mdb = ci->ci_mdb;
+  MDBX_env *env;
+  MDBX_txn *txn;
+  MDBX_dbi dbi;
+  int i, rc;
+
+  rc = mdbx_env_create(&env);
+  if (rc)
+    return rc;
+  rc = mdbx_env_set_mapsize(env, mdb->mi_mapsize);
+  if (rc == 0)
+    rc = mdbx_env_set_maxdbs(env, MDB_INDICES);
+  if (rc == 0)
+    rc = mdbx_env_open(env, ci->ci_path, MDBX_NOSUBDIR | MDBX_RDONLY, mdb->mi_dbenv_mode);
+  if (rc == 0)
+    rc = mdbx_txn_begin(env, NULL, MDBX_RDONLY, &txn);
+  if (rc == 0) {
+    for (i = 0; i < MDB_NDB && rc == 0; i++)
+      rc = mdb_main_dbi_open(txn, i, 0, &dbi);
+    mdbx_txn_abort(txn);
+  }
+  mdbx_env_close(env);
+  return rc;
+}
+
+/* Swap the compacted copy in place of the live data file.
+ * Runs with the server paused. The live file is kept aside until
+ * the copy is reopened, and put back if that fails. */
+static int compact_switch(compact_info *ci) {
+  BackendDB *be = ci->ci_be;
+  struct mdb_info *mdb = ci->ci_mdb;
+  ConfigReply cr = {0};
+  char *dbfile, *backup;
+  int rc;
+
+  compact_close(ci, 0);
+  compact_stop_noting(mdb);
+
+  rc = compact_verify(ci);
+  if (rc)
+    return rc;
+
+  dbfile = ch_malloc(strlen(mdb->mi_dbenv_home) + sizeof(MDBX_DATANAME));
+  sprintf(dbfile, "%s" MDBX_DATANAME, mdb->mi_dbenv_home);
+  backup = ch_malloc(strlen(dbfile) + sizeof(MDB_COMPACT_BACKUP));
+  sprintf(backup, "%s" MDB_COMPACT_BACKUP, dbfile);
+
+  ldap_pvt_thread_pool_purgekey(mdb->mi_dbenv);
+  be->bd_info->bi_db_close(be, &cr);
+
+  unlink(backup);
+  rc = link(dbfile, backup);
+  if (rc == 0) {
+    rc = rename(ci->ci_path, dbfile);
+    if (rc) {
+      rc = errno;
+      unlink(backup);
+    }
+  } else {
+    rc = errno;
+  }
+
+  if (rc == 0) {
+    compact_close(ci, 1); /* only the lock file is left */
+    /* entry IDs have changed: drop the ACL decisions, group checks
+     * and encoded entries cached so far, they share acl_cache_gen */
+    acl_cache_invalidate();
+    if (be->bd_info->bi_db_open(be, &cr) == 0) {
+      unlink(backup);
+      goto done;
+    }
+    Debug(LDAP_DEBUG_ANY,
+          LDAP_XSTRING(mdb_compact) ": database \"%s\": "
+                                    "reopen after compaction failed: %s, "
+                                    "restoring the previous data\n",
+          be->be_suffix[0].bv_val, cr.msg);
+    rename(backup, dbfile);
+    rc = LDAP_OTHER;
+  }
+
+  if (be->bd_info->bi_db_open(be, &cr))
+    Debug(LDAP_DEBUG_ANY,
+          LDAP_XSTRING(mdb_compact) ": database \"%s\": "
+                                    "reopen failed: %s\n",
+          be->be_suffix[0].bv_val, cr.msg);
+
+done:
+  ch_free(backup);
+  ch_free(dbfile);
+  return rc;
+}
+
+static int mdb_compact(Operation *op) {
+  BackendDB *be = op->o_bd;
+  struct mdb_info *mdb = be->be_private;
+  compact_info ci = {0};
+  unsigned count;
+  int i, paused, rc;
+
+  ci.ci_be = be;
+  ci.ci_mdb = mdb;
+
+  ldap_pvt_thread_mutex_lock(&mdb->mi_compact_mutex);
+  mdb->mi_compact_active = 1;
+  ldap_pvt_thread_mutex_unlock(&mdb->mi_compact_mutex);
+
+  rc = compact_barrier(mdb);
+  if (rc == 0)
+    rc = compact_open(&ci);
+  if (rc == 0)
+    rc = compact_copy(&ci, op);
+  if (rc == 0)
+    rc = compact_txn_commit(&ci);
+  for (i = 0; rc == 0 && i < MDB_COMPACT_ROUNDS; i++) {
+    if (compact_interrupted(&ci)) {
+      rc = LDAP_BUSY;
+      break;
+    }
+    rc = compact_replay(&ci, op, &count);
+    if (count < MDB_COMPACT_BATCH)
+      break;
+  }
+  if (rc)
+    goto bailout;
+
+  paused = slap_biglock_pool_pause(be);
+  if (paused != LDAP_SUCCESS) {
+    rc = LDAP_BUSY;
+    goto bailout;
+  }
+  rc = compact_replay(&ci, op, &count);
+  if (rc == 0)
+    rc = compact_txn_begin(&ci);
+  if (rc == 0)
+    rc = mdbx_drop(ci.ci_txn, ci.ci_o2n, 1);
+  if (rc == 0)
+    rc = compact_txn_commit(&ci);
+  if (rc == 0) {
+    Debug(LDAP_DEBUG_STATS,
+          LDAP_XSTRING(mdb_compact) ": database \"%s\": "
+                                    "renumbered into %lu IDs\n",
+          be->be_suffix[0].bv_val, (unsigned long)ci.ci_lastid);
+    rc = compact_switch(&ci);
+  }
+  if (rc)
+    goto bailout_paused;
+  slap_biglock_pool_resume(be);
+  return rc;
+
+bailout_paused:
+  slap_biglock_pool_resume(be);
+bailout:
+  if (rc != LDAP_BUSY)
+    Debug(LDAP_DEBUG_ANY,
+          LDAP_XSTRING(mdb_compact) ": database \"%s\": "
+                                    "compaction failed: %s (%d)\n",
+          be->be_suffix[0].bv_val, mdbx_strerror(rc), rc);
+  compact_close(&ci, 1);
+  compact_stop_noting(mdb);
+  ch_free(ci.ci_path);
+  return rc;
+}
+
+/* Count the live entries and the last ID in use */
+static int compact_usage(Operation *op, struct mdb_info *mdb, ID *lastid, ID *entries) {
+  mdb_op_info opinfo;
+  MDBX_txn *txn;
+  MDBX_cursor *mc;
+  MDBX_val key;
+  MDBX_stat ms;
+  int rc;
+
+  rc = compact_rtxn_get(op, mdb, &opinfo, &txn);
+  if (rc)
+    return rc;
+  rc = mdbx_dbi_stat(txn, mdb->mi_id2entry, &ms, sizeof(ms));
+  if (rc == 0) {
+    *entries = ms.ms_entries;
+    rc = mdbx_cursor_open(txn, mdb->mi_id2entry, &mc);
+  }
+  if (rc == 0) {
+    rc = mdbx_cursor_get(mc, &key, NULL, MDBX_LAST);
+    if (rc == 0)
+      memcpy(lastid, key.iov_base, sizeof(ID));
+    mdbx_cursor_close(mc);
+  }
+  compact_rtxn_done(op, &opinfo);
+  return rc;
+}
+
+/* periodically check the ID space and compact it once sparse enough */
+void *mdb_compact_task(void *ctx, void *arg) {
+  struct re_s *rtask = arg;
+  BackendDB *be = rtask->arg;
+  struct mdb_info *mdb = be->be_private;
+
+  Connection conn = {0};
+  OperationBuffer opbuf;
+  Operation *op;
+  ID lastid = 0, entries = 0;
+
+  connection_fake_init(&conn, &opbuf, ctx);
+  op = &opbuf.ob_op;
+  op->o_bd = be;
+
+  if (!slapd_shutdown && (mdb->mi_flags & MDB_IS_OPEN) && !mdb->mi_index_task && !mdb->mi_uuid2id_task &&
+      mdb->mi_compact_percent &&
+      compact_usage(op, mdb, &lastid, &entries) == 0 && lastid > entries &&
+      (lastid - entries) * 100 / lastid >= mdb->mi_compact_percent) {
+    Debug(LDAP_DEBUG_STATS,
+          LDAP_XSTRING(mdb_compact_task) ": database \"%s\": "
+                                         "%lu entries over %lu IDs, compacting\n",
+          be->be_suffix[0].bv_val, (unsigned long)entries, (unsigned long)lastid);
+    mdb_compact(op);
+  }
+
+  ldap_pvt_thread_mutex_lock(&slapd_rq.rq_mutex);
+  ldap_pvt_runqueue_stoptask(&slapd_rq, rtask);
+  ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+  return NULL;
+}
@@ -27,6 +27,8 @@ int mdb_compare(Operation *op, SlapReply *rs) {
 
   MDBX_txn *rtxn;
   mdb_op_info opinfo = {{{0}}}, *moi = &opinfo;
+  mdb_ava_info ava = {{{0}}};
+  AttributeDescription *ad = op->orc_ava->aa_desc;
 
   rs->sr_err = mdb_opinfo_get(op, mdb, 1, &moi);
   switch (rs->sr_err) {
@@ -39,8 +41,21 @@ int mdb_compare(Operation *op, SlapReply *rs) {
 
   rtxn = moi->moi_txn;
 
+  /* A multival attribute may have a huge number of values, so load only
+   * the asserted one unless the ACLs or the assertion control would have
+   * to look at the others. */
+  if (!(mdb->mi_flags & MDB_ID2VAL_UNSORTED) && !get_assert(op) && ad != slap_schema.si_ad_objectClass && ad != slap_schema.si_ad_ref &&
+      (be_isroot(op) || !acl_reads_attr(op->o_bd, &op->o_req_ndn, ad))) {
+    ava.mai_oe.oe_key = (void *)mdb_compare;
+    ava.mai_desc = ad;
+    ava.mai_nval = &op->orc_ava->aa_value;
+    LDAP_SLIST_INSERT_HEAD(&op->o_extra, &ava.mai_oe, oe_next);
+  }
+
   /* get entry */
   rs->sr_err = mdb_dn2entry(op, rtxn, NULL, &op->o_req_ndn, &e, NULL, 1);
+  if (ava.mai_oe.oe_key)
+    LDAP_SLIST_REMOVE(&op->o_extra, &ava.mai_oe, OpExtra, oe_next);
   switch (rs->sr_err) {
   case MDBX_NOTFOUND:
   case 0:
@@ -120,3 +135,64 @@ return_results:
 
   return rs->sr_err;
 }
+
+/* Group membership check for static groups, see be_entry_valfind().
+ * Only the asserted value of a multival attribute is read. As with
+ * mdb_entry_get(), a missing objectClass or attribute is reported as
+ * a missing entry. */
+int mdb_entry_valfind(Operation *op, struct berval *ndn, ObjectClass *oc, AttributeDescription *at,
+                      struct berval *nval) {
+  struct mdb_info *mdb = (struct mdb_info *)op->o_bd->be_private;
+  mdb_op_info opinfo = {{{0}}}, *moi = &opinfo;
+  mdb_ava_info ava = {{{0}}};
+  Entry *e = NULL;
+  Attribute *a;
+  int rc;
+
+  if (at == slap_schema.si_ad_objectClass || (mdb->mi_flags & MDB_ID2VAL_UNSORTED))
+    return LDAP_UNAVAILABLE;
+
+  rc = mdb_opinfo_get(op, mdb, 1, &moi);
+  if (rc)
+    return LDAP_UNAVAILABLE;
+
+  ava.mai_oe.oe_key = (void *)mdb_compare;
+  ava.mai_desc = at;
+  ava.mai_nval = nval;
+  LDAP_SLIST_INSERT_HEAD(&op->o_extra, &ava.mai_oe, oe_next);
+  rc = mdb_dn2entry(op, moi->moi_txn, NULL, ndn, &e, NULL, 0);
+  LDAP_SLIST_REMOVE(&op->o_extra, &ava.mai_oe, OpExtra, oe_next);
+
+  switch (rc) {
+  case 0:
+    if (oc && !is_entry_objectclass(e, oc, 0)) {
+      rc = LDAP_NO_SUCH_OBJECT;
+    } else if ((a = attr_find(e->e_attrs, at)) == NULL) {
+      rc = LDAP_NO_SUCH_OBJECT;
+    } else {
+      rc = attr_valfind(a, SLAP_MR_ATTRIBUTE_VALUE_NORMALIZED_MATCH | SLAP_MR_ASSERTED_VALUE_NORMALIZED_MATCH, nval,
+                        NULL, op->o_tmpmemctx)
+               ? LDAP_COMPARE_FALSE
+               : LDAP_COMPARE_TRUE;
+    }
+    break;
+  case MDBX_NOTFOUND:
+    rc = LDAP_NO_SUCH_OBJECT;
+    break;
+  default:
+    rc = LDAP_UNAVAILABLE;
+    break;
+  }
+
+  if (e != NULL)
+    mdb_entry_return(op, e);
+  if (moi == &opinfo || --moi->moi_ref < 1) {
+    int __maybe_unused rc2 = mdbx_txn_reset(moi->moi_txn);
+    assert(rc2 == MDBX_SUCCESS);
+    if (moi->moi_oe.oe_key)
+      LDAP_SLIST_REMOVE(&op->o_extra, &moi->moi_oe, OpExtra, oe_next);
+    if ((moi->moi_flag & (MOI_FREEIT | MOI_KEEPER)) == MOI_FREEIT)
+      op->o_tmpfree(moi, op->o_tmpmemctx);
+  }
+  return rc;
+}
@@ -42,6 +42,8 @@ enum {
   MDBX_DREAMCATCHER,
   MDBX_OOMFLAGS,
   MDB_MULTIVAL,
+  MDB_COMPACT,
+  MDB_WARMUP,
 };
 
 static ConfigTable mdbcfg[] = {
@@ -129,6 +131,18 @@ static ConfigTable mdbcfg[] = {
      "EQUALITY caseIgnoreMatch "
      "SYNTAX OMsDirectoryString SINGLE-VALUE )",
      NULL, NULL},
+    {"compact", "percent> <sec", 3, 3, 0, ARG_MAGIC | MDB_COMPACT, mdb_cf_gen,
+     "( OLcfgDbAt:12.44 NAME 'olcDbCompact' "
+     "DESC 'Online compaction threshold of unused IDs in percent and check interval in seconds' "
+     "EQUALITY caseIgnoreMatch "
+     "SYNTAX OMsDirectoryString SINGLE-VALUE )",
+     NULL, NULL},
+    {"warmup", "kbyte/s> <db", 3, 0, 0, ARG_MAGIC | MDB_WARMUP, mdb_cf_gen,
+     "( OLcfgDbAt:12.45 NAME 'olcDbWarmup' "
+     "DESC 'Startup warmup rate in kbytes per second and sub-databases to prefetch' "
+     "EQUALITY caseIgnoreMatch "
+     "SYNTAX OMsDirectoryString SINGLE-VALUE )",
+     NULL, NULL},
     {NULL, NULL, 0, 0, 0, ARG_IGNORED, NULL, NULL, NULL, NULL}};
 
 static ConfigOCs mdbocs[] = {{"( OLcfgDbOc:12.1 "
@@ -140,7 +154,7 @@ static ConfigOCs mdbocs[] = {{"( OLcfgDbOc:12.1 "
                               "olcDbNoSync $ olcDbIndex $ olcDbMaxReaders $ olcDbMaxSize $ "
                               "olcDbDreamcatcher $ olcDbOomFlags $ "
                               "olcDbMode $ olcDbSearchStack $ olcDbMaxEntrySize $ olcDbRtxnSize $ "
-                              "olcDbMultival ) )",
+                              "olcDbMultival $ olcDbCompact $ olcDbWarmup ) )",
                               Cft_Database, mdbcfg},
                              {NULL, 0, NULL}};
 
@@ -359,6 +373,41 @@ static int mdb_cf_gen(ConfigArgs *c) {
       }
       break;
 
+    case MDB_COMPACT:
+      if (mdb->mi_compact_percent) {
+        char buf[64];
+        struct berval bv;
+        bv.bv_len = snprintf(buf, sizeof(buf), "%u %u", mdb->mi_compact_percent, mdb->mi_compact_period);
+        if (bv.bv_len > 0 && bv.bv_len < sizeof(buf)) {
+          bv.bv_val = buf;
+          value_add_one(&c->rvalue_vals, &bv);
+        } else {
+          rc = 1;
+        }
+      } else {
+        rc = 1;
+      }
+      break;
+
+    case MDB_WARMUP:
+      if (mdb->mi_warmup_names) {
+        char buf[SLAP_TEXT_BUFLEN];
+        struct berval bv;
+        int i;
+        bv.bv_len = snprintf(buf, sizeof(buf), "%u", mdb->mi_warmup_rate);
+        for (i = 0; !BER_BVISNULL(&mdb->mi_warmup_names[i]) && bv.bv_len < sizeof(buf); i++)
+          bv.bv_len += snprintf(buf + bv.bv_len, sizeof(buf) - bv.bv_len, " %s", mdb->mi_warmup_names[i].bv_val);
+        if (bv.bv_len < sizeof(buf)) {
+          bv.bv_val = buf;
+          value_add_one(&c->rvalue_vals, &bv);
+        } else {
+          rc = 1;
+        }
+      } else {
+        rc = 1;
+      }
+      break;
+
     case MDB_DIRECTORY:
       if (mdb->mi_dbenv_home) {
         c->value_string = ch_strdup(mdb->mi_dbenv_home);
@@ -446,6 +495,24 @@ static int mdb_cf_gen(ConfigArgs *c) {
       }
       mdb->mi_txn_cp = 0;
       break;
+    case MDB_COMPACT:
+      if (mdb->mi_compact_task) {
+        struct re_s *re = mdb->mi_compact_task;
+        mdb->mi_compact_task = NULL;
+        ldap_pvt_thread_mutex_lock(&slapd_rq.rq_mutex);
+        if (ldap_pvt_runqueue_isrunning(&slapd_rq, re))
+          ldap_pvt_runqueue_stoptask(&slapd_rq, re);
+        ldap_pvt_runqueue_remove(&slapd_rq, re);
+        ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+      }
+      mdb->mi_compact_percent = 0;
+      mdb->mi_compact_period = 0;
+      break;
+    case MDB_WARMUP:
+      ber_bvarray_free(mdb->mi_warmup_names);
+      mdb->mi_warmup_names = NULL;
+      mdb->mi_warmup_rate = 0;
+      break;
     case MDBX_DREAMCATCHER:
       mdb->mi_renew_lag = 0;
       mdb->mi_renew_percent = 0;
@@ -723,6 +790,79 @@ static int mdb_cf_gen(ConfigArgs *c) {
     mdb->mi_renew_percent = l;
   } break;
 
+  case MDB_COMPACT: {
+    long l;
+    if (lutil_atolx(&l, c->argv[1], 0) != 0 || l < 1 || l > 99) {
+      fprintf(stderr,
+              "%s: "
+              "invalid percent \"%s\" in \"compact\".\n",
+              c->log, c->argv[1]);
+      return ARG_BAD_CONF;
+    }
+    mdb->mi_compact_percent = l;
+    if (lutil_atolx(&l, c->argv[2], 0) != 0 || l < 1) {
+      fprintf(stderr,
+              "%s: "
+              "invalid seconds \"%s\" in \"compact\".\n",
+              c->log, c->argv[2]);
+      return ARG_BAD_CONF;
+    }
+    mdb->mi_compact_period = l;
+    /* Only a running server compacts online, slaptools have slapcat/slapadd. */
+    if (slapMode & SLAP_SERVER_MODE) {
+      struct re_s *re = mdb->mi_compact_task;
+      if (re) {
+        re->interval = ldap_from_seconds(mdb->mi_compact_period);
+      } else {
+        if (c->be->be_suffix == NULL || BER_BVISNULL(&c->be->be_suffix[0])) {
+          fprintf(stderr,
+                  "%s: "
+                  "\"compact\" must occur after \"suffix\".\n",
+                  c->log);
+          return ARG_BAD_CONF;
+        }
+        ldap_pvt_thread_mutex_lock(&slapd_rq.rq_mutex);
+        mdb->mi_compact_task = ldap_pvt_runqueue_insert(&slapd_rq, mdb->mi_compact_period, mdb_compact_task, c->be,
+                                                        LDAP_XSTRING(mdb_compact_task), c->be->be_suffix[0].bv_val);
+        ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+      }
+    }
+  } break;
+
+  case MDB_WARMUP: {
+    long l;
+    int i;
+    if (lutil_atolx(&l, c->argv[1], 0) != 0 || l < 0) {
+      fprintf(stderr,
+              "%s: "
+              "invalid rate \"%s\" in \"warmup\".\n",
+              c->log, c->argv[1]);
+      return ARG_BAD_CONF;
+    }
+    for (i = 2; i < c->argc; i++) {
+      struct berval bv;
+      AttributeDescription *ad = NULL;
+      const char *text;
+      ber_str2bv(c->argv[i], 0, 0, &bv);
+      if (mdb_warmup_dbname(&bv) < 0 && slap_str2ad(c->argv[i], &ad, &text) != LDAP_SUCCESS) {
+        fprintf(stderr,
+                "%s: "
+                "unknown database \"%s\" in \"warmup\".\n",
+                c->log, c->argv[i]);
+        return ARG_BAD_CONF;
+      }
+    }
+    /* takes effect at the next open of the database */
+    ber_bvarray_free(mdb->mi_warmup_names);
+    mdb->mi_warmup_names = NULL;
+    for (i = 2; i < c->argc; i++) {
+      struct berval bv;
+      ber_str2bv(c->argv[i], 0, 0, &bv);
+      value_add_one(&mdb->mi_warmup_names, &bv);
+    }
+    mdb->mi_warmup_rate = l;
+  } break;
+
   case MDB_DIRECTORY: {
     FILE *f;
     char *ptr, *testpath;
@@ -334,6 +334,8 @@ int mdb_delete(Operation *op, SlapReply *rs) {
     p = NULL;
   }
 
+  mdb_compact_note(mdb, e->e_id);
+
   if (moi == &opinfo) {
     LDAP_SLIST_REMOVE(&op->o_extra, &opinfo.moi_oe, OpExtra, oe_next);
     opinfo.moi_oe.oe_key = NULL;
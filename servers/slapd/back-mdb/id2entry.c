@@ -51,40 +51,44 @@ int mdb_id2v_compare(const MDBX_val *usrkey, const MDBX_val *curkey) {
   return uv[sizeof(ID) / 2] - cv[sizeof(ID) / 2];
 }
 
-/* usrkey[0] is the key in DB format, as described at mdb_mval_put.
- * usrkey[1] is the value we'll actually match against.
- * usrkey[2] is the attributeDescription for this value.
- */
-int mdb_id2v_dupsort(const MDBX_val *usrkey, const MDBX_val *curkey) {
-  AttributeDescription *ad = usrkey[2].iov_base;
-  struct berval bv1, bv2;
-  int match;
+/* Extract the normalized part of a value in DB format, as described
+ * at mdb_mval_put. */
+static void mdb_id2v_nval(const MDBX_val *v, struct berval *bv) {
   unsigned short s;
   char *ptr;
 
-  ptr = curkey->iov_base + curkey->iov_len - 2;
+  ptr = (char *)v->iov_base + v->iov_len - 2;
   memcpy(&s, ptr, 2);
-  bv2.bv_val = curkey->iov_base;
-  bv2.bv_len = curkey->iov_len - 3;
+  bv->bv_val = v->iov_base;
+  bv->bv_len = v->iov_len - 3;
   if (s)
-    bv2.bv_len -= (s + 1);
-
-  bv1.bv_val = usrkey[1].iov_base;
-  bv1.bv_len = usrkey[1].iov_len;
-
-  if (ad) {
-    MatchingRule *mr = ad->ad_type->sat_equality;
-    int rc = mr->smr_match(&match,
-                           SLAP_MR_EQUALITY | SLAP_MR_VALUE_OF_ASSERTION_SYNTAX |
-                               SLAP_MR_ASSERTED_VALUE_NORMALIZED_MATCH | SLAP_MR_ATTRIBUTE_VALUE_NORMALIZED_MATCH,
-                           ad->ad_type->sat_syntax, mr, &bv1, &bv2);
-    assert(rc == LDAP_SUCCESS);
-    (void)rc;
-  } else {
-    match = ber_bvcmp(&bv1, &bv2);
-  }
+    bv->bv_len -= (s + 1);
+}
+
+/* Both values are in DB format. Only the MDBX_val itself may be looked
+ * at, since libmdbx hands aligned copies of the user's data to the
+ * comparator. Normalized values are ordered by length, then bytewise. */
+int mdb_id2v_dupsort(const MDBX_val *usrkey, const MDBX_val *curkey) {
+  struct berval bv1, bv2;
+
+  mdb_id2v_nval(usrkey, &bv1);
+  mdb_id2v_nval(curkey, &bv2);
+  return ber_bvcmp(&bv1, &bv2);
+}
+
+/* Build the search key for a normalized value, which is the DB format
+ * without an original value. The buffer is allocated in op->o_tmpmemctx. */
+static void mdb_id2v_lookup(Operation *op, struct berval *nval, MDBX_val *data) {
+  char *buf;
 
-  return match;
+  data->iov_len = nval->bv_len + 3;
+  buf = op->o_tmpalloc(data->iov_len, op->o_tmpmemctx);
+  data->iov_base = buf;
+  memcpy(buf, nval->bv_val, nval->bv_len);
+  buf += nval->bv_len;
+  *buf++ = 0;
+  *buf++ = 0;
+  *buf = 0;
 }
 
 /* Values are stored as
@@ -94,7 +98,7 @@ int mdb_id2v_dupsort(const MDBX_val *usrkey, const MDBX_val *curkey) {
  */
 int mdb_mval_put(Operation *op, MDBX_cursor *mc, ID id, Attribute *a) {
   struct mdb_info *mdb = (struct mdb_info *)op->o_bd->be_private;
-  MDBX_val key, data[3];
+  MDBX_val key, data;
   char *buf;
   char ivk[ID2VKSZ];
   unsigned i;
@@ -106,24 +110,14 @@ int mdb_mval_put(Operation *op, MDBX_cursor *mc, ID id, Attribute *a) {
   memcpy(ivk + sizeof(ID), &s, 2);
   key.iov_base = &ivk;
   key.iov_len = sizeof(ivk);
-  if ((a->a_desc->ad_type->sat_flags & SLAP_AT_ORDERED) || a->a_desc == slap_schema.si_ad_objectClass)
-    data[2].iov_base = NULL;
-  else
-    data[2].iov_base = a->a_desc;
 
   for (i = 0; i < a->a_numvals; i++) {
     len = a->a_nvals[i].bv_len + 1 + 2;
-    if (a->a_nvals != a->a_vals) {
+    if (a->a_nvals != a->a_vals)
       len += a->a_vals[i].bv_len + 1;
-      data[1].iov_base = a->a_nvals[i].bv_val;
-      data[1].iov_len = a->a_nvals[i].bv_len;
-    } else {
-      data[1].iov_base = a->a_vals[i].bv_val;
-      data[1].iov_len = a->a_vals[i].bv_len;
-    }
-    data[0].iov_len = len;
+    data.iov_len = len;
     buf = op->o_tmpalloc(len, op->o_tmpmemctx);
-    data[0].iov_base = buf;
+    data.iov_base = buf;
     memcpy(buf, a->a_nvals[i].bv_val, a->a_nvals[i].bv_len);
     buf += a->a_nvals[i].bv_len;
     *buf++ = 0;
@@ -137,8 +131,8 @@ int mdb_mval_put(Operation *op, MDBX_cursor *mc, ID id, Attribute *a) {
       *buf++ = 0;
       *buf++ = 0;
     }
-    rc = mdbx_cursor_put(mc, &key, data, 0);
-    op->o_tmpfree(data[0].iov_base, op->o_tmpmemctx);
+    rc = mdbx_cursor_put(mc, &key, &data, 0);
+    op->o_tmpfree(data.iov_base, op->o_tmpmemctx);
     if (rc)
       return rc;
   }
@@ -147,7 +141,7 @@ int mdb_mval_put(Operation *op, MDBX_cursor *mc, ID id, Attribute *a) {
 
 int mdb_mval_del(Operation *op, MDBX_cursor *mc, ID id, Attribute *a) {
   struct mdb_info *mdb = (struct mdb_info *)op->o_bd->be_private;
-  MDBX_val key, data[3];
+  MDBX_val key, data;
   char ivk[ID2VKSZ];
   unsigned i;
   int rc = MDBX_SUCCESS;
@@ -158,23 +152,15 @@ int mdb_mval_del(Operation *op, MDBX_cursor *mc, ID id, Attribute *a) {
   memcpy(ivk + sizeof(ID), &s, 2);
   key.iov_base = &ivk;
   key.iov_len = sizeof(ivk);
-  if ((a->a_desc->ad_type->sat_flags & SLAP_AT_ORDERED) || a->a_desc == slap_schema.si_ad_objectClass)
-    data[2].iov_base = NULL;
-  else
-    data[2].iov_base = a->a_desc;
 
   if (a->a_numvals) {
     for (i = 0; i < a->a_numvals; i++) {
-      data[0].iov_base = a->a_nvals[i].bv_val;
-      data[0].iov_len = a->a_nvals[i].bv_len + 1;
-      if (a->a_nvals != a->a_vals) {
-        data[1].iov_base = a->a_nvals[i].bv_val;
-        data[1].iov_len = a->a_nvals[i].bv_len;
-      } else {
-        data[1].iov_base = a->a_vals[i].bv_val;
-        data[1].iov_len = a->a_vals[i].bv_len;
-      }
-      rc = mdbx_cursor_get(mc, &key, data, MDBX_GET_BOTH_RANGE);
+      void *buf;
+
+      mdb_id2v_lookup(op, &a->a_nvals[i], &data);
+      buf = data.iov_base;
+      rc = mdbx_cursor_get(mc, &key, &data, MDBX_GET_BOTH);
+      op->o_tmpfree(buf, op->o_tmpmemctx);
       if (rc)
         return rc;
       rc = mdbx_cursor_del(mc, 0);
@@ -182,7 +168,7 @@ int mdb_mval_del(Operation *op, MDBX_cursor *mc, ID id, Attribute *a) {
         return rc;
     }
   } else {
-    rc = mdbx_cursor_get(mc, &key, data, MDBX_SET);
+    rc = mdbx_cursor_get(mc, &key, &data, MDBX_SET);
     if (rc)
       return rc;
     rc = mdbx_cursor_del(mc, MDBX_NODUPDATA);
@@ -190,9 +176,64 @@ int mdb_mval_del(Operation *op, MDBX_cursor *mc, ID id, Attribute *a) {
   return rc;
 }
 
+/* Put the values of every attribute back in the order of
+ * mdb_id2v_dupsort, for a table filled by an older version.
+ * Walking the duplicates never compares them, so each attribute's
+ * values are read in their old order, deleted and stored again. */
+int mdb_id2v_resort(MDBX_txn *txn, MDBX_dbi dbi) {
+  MDBX_cursor *mc;
+  MDBX_val key, data;
+  BerVarray vals = NULL;
+  struct berval bv;
+  char ivk[ID2VKSZ];
+  unsigned i;
+  int rc;
+
+  rc = mdbx_cursor_open(txn, dbi, &mc);
+  if (rc)
+    return rc;
+
+  rc = mdbx_cursor_get(mc, &key, &data, MDBX_FIRST);
+  while (rc == MDBX_SUCCESS) {
+    if (key.iov_len != sizeof(ivk)) {
+      rc = MDBX_CORRUPTED;
+      break;
+    }
+    memcpy(ivk, key.iov_base, sizeof(ivk));
+    do {
+      bv.bv_len = data.iov_len;
+      bv.bv_val = ch_malloc(bv.bv_len);
+      memcpy(bv.bv_val, data.iov_base, bv.bv_len);
+      ber_bvarray_add(&vals, &bv);
+      rc = mdbx_cursor_get(mc, &key, &data, MDBX_NEXT_DUP);
+    } while (rc == MDBX_SUCCESS);
+    if (rc != MDBX_NOTFOUND)
+      break;
+
+    key.iov_base = ivk;
+    key.iov_len = sizeof(ivk);
+    rc = mdbx_cursor_get(mc, &key, &data, MDBX_SET);
+    if (rc == MDBX_SUCCESS)
+      rc = mdbx_cursor_del(mc, MDBX_ALLDUPS);
+    for (i = 0; rc == MDBX_SUCCESS && vals[i].bv_val; i++) {
+      data.iov_base = vals[i].bv_val;
+      data.iov_len = vals[i].bv_len;
+      rc = mdbx_cursor_put(mc, &key, &data, 0);
+    }
+    ber_bvarray_free(vals);
+    vals = NULL;
+    if (rc == MDBX_SUCCESS)
+      rc = mdbx_cursor_get(mc, &key, &data, MDBX_NEXT_NODUP);
+  }
+  if (vals)
+    ber_bvarray_free(vals);
+  mdbx_cursor_close(mc);
+  return rc == MDBX_NOTFOUND ? MDBX_SUCCESS : rc;
+}
+
 static int mdb_mval_get(Operation *op, MDBX_cursor *mc, ID id, Attribute *a, int have_nvals) {
   struct mdb_info *mdb = (struct mdb_info *)op->o_bd->be_private;
-  MDBX_val key, data[3];
+  MDBX_val key, data;
   char *ptr;
   char ivk[ID2VKSZ];
   unsigned i;
@@ -205,34 +246,28 @@ static int mdb_mval_get(Operation *op, MDBX_cursor *mc, ID id, Attribute *a, int
   key.iov_base = &ivk;
   key.iov_len = sizeof(ivk);
 
-  /* not needed */
-  if ((a->a_desc->ad_type->sat_flags & SLAP_AT_ORDERED) || a->a_desc == slap_schema.si_ad_objectClass)
-    data[2].iov_base = NULL;
-  else
-    data[2].iov_base = a->a_desc;
-
   if (have_nvals)
     a->a_nvals = a->a_vals + a->a_numvals + 1;
   else
     a->a_nvals = a->a_vals;
   for (i = 0; i < a->a_numvals; i++) {
     if (!i)
-      rc = mdbx_cursor_get(mc, &key, data, MDBX_SET);
+      rc = mdbx_cursor_get(mc, &key, &data, MDBX_SET);
     else
-      rc = mdbx_cursor_get(mc, &key, data, MDBX_NEXT_DUP);
+      rc = mdbx_cursor_get(mc, &key, &data, MDBX_NEXT_DUP);
     if (rc)
       break;
-    ptr = (char *)data[0].iov_base + data[0].iov_len - 2;
+    ptr = (char *)data.iov_base + data.iov_len - 2;
     memcpy(&s, ptr, 2);
     if (have_nvals) {
-      a->a_nvals[i].bv_val = data[0].iov_base;
+      a->a_nvals[i].bv_val = data.iov_base;
       a->a_vals[i].bv_len = s;
       a->a_vals[i].bv_val = ptr - a->a_vals[i].bv_len - 1;
       a->a_nvals[i].bv_len = a->a_vals[i].bv_val - a->a_nvals[i].bv_val - 1;
     } else {
       assert(!s);
-      a->a_vals[i].bv_val = data[0].iov_base;
-      a->a_vals[i].bv_len = data[0].iov_len - 3;
+      a->a_vals[i].bv_val = data.iov_base;
+      a->a_vals[i].bv_len = data.iov_len - 3;
     }
   }
   a->a_numvals = i;
@@ -243,6 +278,56 @@ static int mdb_mval_get(Operation *op, MDBX_cursor *mc, ID id, Attribute *a, int
   return rc;
 }
 
+/* Like mdb_mval_get(), but seeks the single asserted normalized value
+ * instead of loading all of them. The attribute is left with that value
+ * or with none. */
+static int mdb_mval_find(Operation *op, MDBX_cursor *mc, ID id, Attribute *a, int have_nvals, struct berval *nval) {
+  struct mdb_info *mdb = (struct mdb_info *)op->o_bd->be_private;
+  MDBX_val key, data;
+  char *ptr;
+  void *buf;
+  char ivk[ID2VKSZ];
+  int rc;
+  unsigned short s;
+
+  memcpy(ivk, &id, sizeof(id));
+  s = mdb->mi_adxs[a->a_desc->ad_index];
+  memcpy(ivk + sizeof(ID), &s, 2);
+  key.iov_base = &ivk;
+  key.iov_len = sizeof(ivk);
+
+  if (have_nvals)
+    a->a_nvals = a->a_vals + a->a_numvals + 1;
+  else
+    a->a_nvals = a->a_vals;
+  a->a_numvals = 0;
+
+  mdb_id2v_lookup(op, nval, &data);
+  buf = data.iov_base;
+  rc = mdbx_cursor_get(mc, &key, &data, MDBX_GET_BOTH);
+  op->o_tmpfree(buf, op->o_tmpmemctx);
+  if (rc == MDBX_SUCCESS) {
+    ptr = (char *)data.iov_base + data.iov_len - 2;
+    memcpy(&s, ptr, 2);
+    if (have_nvals) {
+      a->a_nvals[0].bv_val = data.iov_base;
+      a->a_vals[0].bv_len = s;
+      a->a_vals[0].bv_val = ptr - a->a_vals[0].bv_len - 1;
+      a->a_nvals[0].bv_len = a->a_vals[0].bv_val - a->a_nvals[0].bv_val - 1;
+    } else {
+      assert(!s);
+      a->a_vals[0].bv_val = data.iov_base;
+      a->a_vals[0].bv_len = data.iov_len - 3;
+    }
+    a->a_numvals = 1;
+  }
+  BER_BVZERO(&a->a_vals[a->a_numvals]);
+  if (have_nvals) {
+    BER_BVZERO(&a->a_nvals[a->a_numvals]);
+  }
+  return rc;
+}
+
 #define ADD_FLAGS (MDBX_NOOVERWRITE | MDBX_APPEND)
 
 static int mdb_id2entry_put(Operation *op, MDBX_txn *txn, MDBX_cursor *mc, Entry *e, int flag) {
@@ -441,16 +526,21 @@ int mdb_id2entry_delete(BackendDB *be, MDBX_txn *tid, Entry *e) {
 }
 
 static Entry *mdb_entry_alloc(Operation *op, int nattrs, int nvals) {
-  Entry *e =
-      op->o_tmpalloc(sizeof(Entry) + nattrs * sizeof(Attribute) + nvals * sizeof(struct berval), op->o_tmpmemctx);
+  size_t len = sizeof(Entry) + nattrs * sizeof(Attribute) + nvals * sizeof(struct berval);
+  /* the attributes stay as decoded, so wide entries get an index */
+  size_t ilen = attr_index_size(nattrs);
+  Entry *e = op->o_tmpalloc(len + ilen, op->o_tmpmemctx);
   BER_BVZERO(&e->e_bv);
   e->e_private = e;
+  e->e_aindex = NULL;
   if (nattrs) {
     e->e_attrs = (Attribute *)(e + 1);
     e->e_attrs->a_vals = (struct berval *)(e->e_attrs + nattrs);
   } else {
     e->e_attrs = NULL;
   }
+  if (ilen)
+    attr_index_init(e, (char *)e + len, nattrs);
 
   return e;
 }
@@ -957,6 +1047,7 @@ int mdb_entry_decode(Operation *op, MDBX_txn *txn, MDBX_val *data, ID id, Entry
   unsigned char *ptr;
   BerVarray bptr;
   MDBX_cursor *mvc = NULL;
+  mdb_ava_info *ava = NULL;
 
   Debug(LDAP_DEBUG_TRACE, "=> mdb_entry_decode:\n");
 
@@ -1004,12 +1095,30 @@ int mdb_entry_decode(Operation *op, MDBX_txn *txn, MDBX_val *data, ID id, Entry
     a->a_vals = bptr;
     if (multi) {
       if (!mvc) {
+        OpExtra *oex;
+
+        LDAP_SLIST_FOREACH(oex, &op->o_extra, oe_next) {
+          if (oex->oe_key == (void *)mdb_compare) {
+            ava = (mdb_ava_info *)oex;
+            break;
+          }
+        }
+
         rc = mdbx_cursor_open(txn, mdb->mi_dbis[MDB_ID2VAL], &mvc);
         if (rc)
           goto leave;
       }
       i = a->a_numvals;
-      mdb_mval_get(op, mvc, id, a, have_nval);
+      if (ava && ava->mai_desc == a->a_desc) {
+        mdb_mval_find(op, mvc, id, a, have_nval, ava->mai_nval);
+      } else {
+        MatchingRule *mr = a->a_desc->ad_type->sat_equality;
+
+        mdb_mval_get(op, mvc, id, a, have_nval);
+        /* id2val order is the sorted order only for these rules */
+        if (mr && mr->smr_match != octetStringMatch && mr->smr_match != dnMatch)
+          a->a_flags &= ~SLAP_ATTR_SORTED_VALS;
+      }
       bptr += i + 1;
       if (have_nval)
         bptr += i + 1;
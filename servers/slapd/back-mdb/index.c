@@ -339,6 +339,12 @@ int mdb_index_values(Operation *op, MDBX_txn *txn, AttributeDescription *desc, B
   if (id == 0)
     return 0;
 
+  if (desc == slap_schema.si_ad_entryUUID) {
+    rc = mdb_uuid2id_values(op, txn, vals, id, opid);
+    if (rc)
+      return rc;
+  }
+
   rc = index_at_values(op, txn, desc, desc->ad_type, &desc->ad_tags, vals, id, opid);
 
   return rc;
@@ -33,6 +33,67 @@ static int mdb_id_compare(const MDBX_val *a, const MDBX_val *b) {
   return mdbx_cmp2int(*(ID *)a->iov_base, *(ID *)b->iov_base);
 }
 
+/* The order of the values in id2val, recorded in its sequence.
+ * Databases written before it was recorded sorted the values with
+ * the equality rule of each attribute, and their duplicates are out
+ * of order for mdb_id2v_dupsort. Such a table is sorted again when
+ * it may be written, otherwise MDBX_RESULT_TRUE tells it is left in
+ * the old order. */
+#define MDB_ID2VAL_FORMAT 1
+
+static int mdb_id2v_format(MDBX_txn *txn, MDBX_dbi dbi, unsigned create) {
+  MDBX_stat st;
+  uint64_t seq;
+  int rc;
+
+  rc = mdbx_dbi_sequence(txn, dbi, &seq, 0);
+  if (rc == MDBX_SUCCESS && seq == 0) {
+    rc = mdbx_dbi_stat(txn, dbi, &st, sizeof(st));
+    if (rc == MDBX_SUCCESS && st.ms_entries) {
+      if (!create)
+        return MDBX_RESULT_TRUE;
+      Debug(LDAP_DEBUG_ANY, LDAP_XSTRING(mdb_id2v_format) ": sorting %lu multival values of an older version\n",
+            (unsigned long)st.ms_entries);
+      rc = mdb_id2v_resort(txn, dbi);
+    }
+    if (rc == MDBX_SUCCESS && create)
+      rc = mdbx_dbi_sequence(txn, dbi, &seq, MDB_ID2VAL_FORMAT);
+    seq = MDB_ID2VAL_FORMAT;
+  }
+  if (rc == MDBX_SUCCESS && seq != MDB_ID2VAL_FORMAT)
+    rc = MDBX_INCOMPATIBLE;
+  return rc;
+}
+
+/* Open one of the main databases (MDB_AD2ID..MDB_ID2VAL) with
+ * its proper flags and comparators. Shared with the compactor,
+ * which builds a second environment with the same layout.
+ * MDBX_RESULT_TRUE means id2val is opened but in an older order. */
+int mdb_main_dbi_open(MDBX_txn *txn, int i, unsigned create, MDBX_dbi *dbi) {
+  MDBX_cmp_func *keycmp = NULL;
+  MDBX_cmp_func *datacmp = NULL;
+  unsigned flags = MDBX_INTEGERKEY | create;
+  int rc;
+
+  if (i == MDB_DN2ID)
+    flags |= MDBX_DUPSORT;
+  if (i == MDB_ID2VAL)
+    flags ^= MDBX_INTEGERKEY | MDBX_DUPSORT;
+
+  if (i == MDB_ID2ENTRY)
+    keycmp = mdb_id_compare;
+  else if (i == MDB_ID2VAL) {
+    keycmp = mdb_id2v_compare;
+    datacmp = mdb_id2v_dupsort;
+  } else if (i == MDB_DN2ID)
+    datacmp = mdb_dup_compare;
+
+  rc = mdbx_dbi_open_ex(txn, mdmi_databases[i].bv_val, flags, dbi, keycmp, datacmp);
+  if (rc == MDBX_SUCCESS && i == MDB_ID2VAL)
+    rc = mdb_id2v_format(txn, *dbi, create);
+  return rc;
+}
+
 static void mdbx_debug(MDBX_log_level_t log, const char *function, int line, const char *msg, va_list args) {
   int level;
   if (log < MDBX_LOG_VERBOSE)
@@ -163,6 +224,8 @@ static int mdb_db_init(BackendDB *be, ConfigReply *cr) {
   slap_backtrace_set_dir(mdb->mi_dbenv_home);
 
   ldap_pvt_thread_mutex_init(&mdb->mi_ads_mutex);
+  ldap_pvt_thread_mutex_init(&mdb->mi_compact_mutex);
+  ldap_pvt_thread_mutex_init(&mdb->mi_warmup_mutex);
 
   rc = mdb_monitor_db_init(be);
 
@@ -301,30 +364,18 @@ static int mdb_db_open(BackendDB *be, ConfigReply *cr) {
 
   /* open (and create) main databases */
   for (i = 0; mdmi_databases[i].bv_val; i++) {
-    flags = MDBX_INTEGERKEY;
-    if (i == MDB_ID2ENTRY) {
-      if (!(slapMode & (SLAP_TOOL_READMAIN | SLAP_TOOL_READONLY)))
-        flags |= MDBX_CREATE;
-    } else {
-      if (i == MDB_DN2ID)
-        flags |= MDBX_DUPSORT;
-      if (i == MDB_ID2VAL)
-        flags ^= MDBX_INTEGERKEY | MDBX_DUPSORT;
-      if (!(slapMode & SLAP_TOOL_READONLY))
-        flags |= MDBX_CREATE;
-    }
-
-    MDBX_cmp_func *keycmp = NULL;
-    MDBX_cmp_func *datacmp = NULL;
     if (i == MDB_ID2ENTRY)
-      keycmp = mdb_id_compare;
-    else if (i == MDB_ID2VAL) {
-      keycmp = mdb_id2v_compare;
-      datacmp = mdb_id2v_dupsort;
-    } else if (i == MDB_DN2ID)
-      datacmp = mdb_dup_compare;
+      flags = (slapMode & (SLAP_TOOL_READMAIN | SLAP_TOOL_READONLY)) ? 0 : MDBX_CREATE;
+    else
+      flags = (slapMode & SLAP_TOOL_READONLY) ? 0 : MDBX_CREATE;
+
+    rc = mdb_main_dbi_open(txn, i, flags, &mdb->mi_dbis[i]);
 
-    rc = mdbx_dbi_open_ex(txn, mdmi_databases[i].bv_val, flags, &mdb->mi_dbis[i], keycmp, datacmp);
+    if (rc == MDBX_RESULT_TRUE && i == MDB_ID2VAL) {
+      /* read-only, the values are only walked in order, not looked up */
+      mdb->mi_flags |= MDB_ID2VAL_UNSORTED;
+      rc = 0;
+    }
 
     if (rc != 0) {
       snprintf(cr->msg, sizeof(cr->msg),
@@ -367,6 +418,17 @@ static int mdb_db_open(BackendDB *be, ConfigReply *cr) {
     }
   }
 
+  rc = mdb_uuid2id_open(mdb, txn, (slapMode & SLAP_TOOL_READONLY) ? 0 : MDBX_CREATE);
+  if (rc != 0) {
+    snprintf(cr->msg, sizeof(cr->msg),
+             "database \"%s\": "
+             "entryUUID table open failed: %s (%d).",
+             be->be_suffix[0].bv_val, mdbx_strerror(rc), rc);
+    Debug(LDAP_DEBUG_ANY, LDAP_XSTRING(mdb_db_open) ": %s\n", cr->msg);
+    mdbx_txn_abort(txn);
+    goto fail;
+  }
+
   rc = mdb_ad_read(mdb, txn);
   if (rc) {
     mdbx_txn_abort(txn);
@@ -401,6 +463,21 @@ static int mdb_db_open(BackendDB *be, ConfigReply *cr) {
 
   mdb->mi_flags |= MDB_IS_OPEN;
 
+  if (slapMode & SLAP_SERVER_MODE) {
+    if (mdb->mi_uuid2id && !mdb->mi_uuid2id_ready) {
+      Debug(LDAP_DEBUG_ANY,
+            LDAP_XSTRING(mdb_db_open) ": database \"%s\": "
+                                      "building entryUUID table in background.\n",
+            be->be_suffix[0].bv_val);
+      ldap_pvt_thread_mutex_lock(&slapd_rq.rq_mutex);
+      /* be may be a copy made by the overlays, the task needs the real one */
+      mdb->mi_uuid2id_task = ldap_pvt_runqueue_insert(&slapd_rq, 10, mdb_uuid2id_task, be->bd_self,
+                                                      LDAP_XSTRING(mdb_uuid2id_task), be->be_suffix[0].bv_val);
+      ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+    }
+    mdb_warmup_start(be);
+  }
+
   return 0;
 
 fail:
@@ -417,6 +494,18 @@ static int mdb_db_close(BackendDB *be, ConfigReply *cr) {
 
   mdb->mi_flags &= ~MDB_IS_OPEN;
 
+  mdb_warmup_stop(mdb);
+
+  if (mdb->mi_uuid2id_task) {
+    struct re_s *re = mdb->mi_uuid2id_task;
+    mdb->mi_uuid2id_task = NULL;
+    ldap_pvt_thread_mutex_lock(&slapd_rq.rq_mutex);
+    if (ldap_pvt_runqueue_isrunning(&slapd_rq, re))
+      ldap_pvt_runqueue_stoptask(&slapd_rq, re);
+    ldap_pvt_runqueue_remove(&slapd_rq, re);
+    ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+  }
+
   if (mdb->mi_dbenv) {
     mdb_reader_flush(mdb->mi_dbenv);
   }
@@ -428,6 +517,10 @@ static int mdb_db_close(BackendDB *be, ConfigReply *cr) {
       mdb_attr_dbs_close(mdb);
       for (i = 0; i < MDB_NDB; i++)
         mdbx_dbi_close(mdb->mi_dbenv, mdb->mi_dbis[i]);
+      if (mdb->mi_uuid2id)
+        mdbx_dbi_close(mdb->mi_dbenv, mdb->mi_uuid2id);
+      mdb->mi_uuid2id = 0;
+      mdb->mi_uuid2id_ready = 0;
 
       /* force a sync, but not if we were ReadOnly,
        * and not in Quick mode.
@@ -469,9 +562,25 @@ static int mdb_db_destroy(BackendDB *be, ConfigReply *cr) {
     ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
   }
 
+  /* stop and remove compaction task */
+  if (mdb->mi_compact_task) {
+    struct re_s *re = mdb->mi_compact_task;
+    mdb->mi_compact_task = NULL;
+    ldap_pvt_thread_mutex_lock(&slapd_rq.rq_mutex);
+    if (ldap_pvt_runqueue_isrunning(&slapd_rq, re))
+      ldap_pvt_runqueue_stoptask(&slapd_rq, re);
+    ldap_pvt_runqueue_remove(&slapd_rq, re);
+    ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+  }
+
   /* monitor handling */
   (void)mdb_monitor_db_destroy(be);
 
+  ch_free(mdb->mi_compact_dirty);
+  ber_bvarray_free(mdb->mi_warmup_names);
+  ldap_pvt_thread_mutex_destroy(&mdb->mi_compact_mutex);
+  ldap_pvt_thread_mutex_destroy(&mdb->mi_warmup_mutex);
+
   if (mdb->mi_dbenv_home)
     ch_free(mdb->mi_dbenv_home);
 
@@ -551,6 +660,8 @@ int mdb_back_initialize(BackendInfo *bi) {
   bi->bi_has_subordinates = mdb_hasSubordinates;
   bi->bi_entry_release_rw = mdb_entry_release;
   bi->bi_entry_get_rw = mdb_entry_get;
+  bi->bi_uuid2dn = mdb_uuid2dn;
+  bi->bi_entry_valfind = mdb_entry_valfind;
 
   /*
    * hooks for slap tools
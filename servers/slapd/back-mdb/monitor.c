@@ -31,6 +31,7 @@
 static ObjectClass *oc_olmMDBDatabase;
 
 static AttributeDescription *ad_olmDbDirectory;
+static AttributeDescription *ad_olmDbWarmup;
 
 #ifdef MDB_MONITOR_IDX
 static int mdb_monitor_idx_entry_add(struct mdb_info *mdb, Entry *e);
@@ -71,6 +72,14 @@ static struct {
              "USAGE dSAOperation )",
              &ad_olmDbDirectory},
 
+            {"( olmDatabaseAttributes:3 "
+             "NAME ( 'olmDbWarmup' ) "
+             "DESC 'Progress of the startup warmup for each sub-database' "
+             "SUP monitoredInfo "
+             "NO-USER-MODIFICATION "
+             "USAGE dSAOperation )",
+             &ad_olmDbWarmup},
+
 #ifdef MDB_MONITOR_IDX
             {"( olmDatabaseAttributes:2 "
              "NAME ( 'olmDbNotIndexed' ) "
@@ -94,6 +103,7 @@ static struct {
      "SUP top AUXILIARY "
      "MAY ( "
      "olmDbDirectory "
+     "$ olmDbWarmup "
 #ifdef MDB_MONITOR_IDX
      "$ olmDbNotIndexed "
 #endif /* MDB_MONITOR_IDX */
@@ -103,8 +113,31 @@ static struct {
     {NULL}};
 
 static int mdb_monitor_update(Operation *op, SlapReply *rs, Entry *e, void *priv) {
-#ifdef MDB_MONITOR_IDX
   struct mdb_info *mdb = (struct mdb_info *)priv;
+  BerVarray vals;
+
+  vals = mdb_warmup_status(mdb);
+  if (vals != NULL) {
+    Attribute *a = attr_find(e->e_attrs, ad_olmDbWarmup);
+
+    if (a != NULL) {
+      assert(a->a_nvals == a->a_vals);
+      ber_bvarray_free(a->a_vals);
+    } else {
+      Attribute **ap;
+
+      for (ap = &e->e_attrs; *ap != NULL; ap = &(*ap)->a_next)
+        ;
+      *ap = attr_alloc(ad_olmDbWarmup);
+      a = *ap;
+    }
+    a->a_vals = vals;
+    a->a_nvals = a->a_vals;
+    for (a->a_numvals = 0; !BER_BVISNULL(&vals[a->a_numvals]); a->a_numvals++)
+      ;
+  }
+
+#ifdef MDB_MONITOR_IDX
   mdb_monitor_idx_entry_add(mdb, e);
 #endif /* MDB_MONITOR_IDX */
 
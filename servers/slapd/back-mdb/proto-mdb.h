@@ -52,6 +52,13 @@ void mdb_attr_info_free(AttrInfo *ai);
 int mdb_ad_read(struct mdb_info *mdb, MDBX_txn *txn);
 int mdb_ad_get(struct mdb_info *mdb, MDBX_txn *txn, AttributeDescription *ad);
 
+/*
+ * compact.c
+ */
+
+void *mdb_compact_task(void *ctx, void *arg);
+void mdb_compact_note(struct mdb_info *mdb, ID id);
+
 /*
  * config.c
  */
@@ -136,6 +143,7 @@ int mdb_opinfo_get(Operation *op, struct mdb_info *mdb, int rdonly, mdb_op_info
 
 int mdb_mval_put(Operation *op, MDBX_cursor *mc, ID id, Attribute *a);
 int mdb_mval_del(Operation *op, MDBX_cursor *mc, ID id, Attribute *a);
+int mdb_id2v_resort(MDBX_txn *txn, MDBX_dbi dbi);
 
 /*
  * idl.c
@@ -184,6 +192,12 @@ int mdb_index_entry(Operation *op, MDBX_txn *t, int r, Entry *e);
 #define mdb_index_entry_add(op, t, e) mdb_index_entry((op), (t), SLAP_INDEX_ADD_OP, (e))
 #define mdb_index_entry_del(op, t, e) mdb_index_entry((op), (t), SLAP_INDEX_DELETE_OP, (e))
 
+/*
+ * init.c
+ */
+
+int mdb_main_dbi_open(MDBX_txn *txn, int i, unsigned create, MDBX_dbi *dbi);
+
 /*
  * key.c
  */
@@ -217,6 +231,24 @@ int mdb_monitor_db_destroy(BackendDB *be);
 int mdb_monitor_idx_add(struct mdb_info *mdb, AttributeDescription *desc, slap_mask_t type);
 #endif /* MDB_MONITOR_IDX */
 
+/*
+ * uuid2id.c
+ */
+
+int mdb_uuid2id_open(struct mdb_info *mdb, MDBX_txn *txn, unsigned flags);
+int mdb_uuid2id_values(Operation *op, MDBX_txn *txn, BerVarray vals, ID id, int opid);
+BI_uuid2dn mdb_uuid2dn;
+void *mdb_uuid2id_task(void *ctx, void *arg);
+
+/*
+ * warmup.c
+ */
+
+int mdb_warmup_dbname(struct berval *name);
+int mdb_warmup_start(BackendDB *be);
+void mdb_warmup_stop(struct mdb_info *mdb);
+BerVarray mdb_warmup_status(struct mdb_info *mdb);
+
 /*
  * former external.h
  */
@@ -228,6 +260,7 @@ extern BI_db_config mdb_db_config;
 extern BI_op_add mdb_add;
 extern BI_op_bind mdb_bind;
 extern BI_op_compare mdb_compare;
+extern BI_entry_valfind mdb_entry_valfind;
 extern BI_op_delete mdb_delete;
 extern BI_op_modify mdb_modify;
 extern BI_op_modrdn mdb_modrdn;
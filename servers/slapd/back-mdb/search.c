@@ -391,6 +391,7 @@ int mdb_search(Operation *op, SlapReply *rs) {
   void *stack;
   Entry *e = NULL, *base = NULL;
   Entry *matched = NULL;
+  FilterProgram *fprog = NULL;
   slap_mask_t mask;
   time_t stoptime;
   int manageDSAit;
@@ -966,7 +967,9 @@ dn2entry_retry:
     }
 
     /* if it matches the filter and scope, send it */
-    rs->sr_err = test_filter(op, e, op->oq_search.rs_filter);
+    if (!fprog)
+      fprog = filter_compile(op, op->oq_search.rs_filter);
+    rs->sr_err = test_filter_program(op, e, fprog);
 
     if (rs->sr_err == LDAP_COMPARE_TRUE) {
       /* check size limit */
@@ -1124,6 +1127,8 @@ done:
   }
   mdbx_cursor_close(mcd);
   mdbx_cursor_close(mci);
+  if (fprog)
+    filter_program_free(op, fprog);
   if (rs->sr_v2ref) {
     ber_bvarray_free(rs->sr_v2ref);
     rs->sr_v2ref = NULL;
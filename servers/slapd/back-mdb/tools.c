@@ -571,6 +571,16 @@ static int mdb_tool_next_id(Operation *op, MDBX_txn *tid, Entry *e, struct berva
 static int mdb_tool_index_add(Operation *op, MDBX_txn *txn, Entry *e) {
   struct mdb_info *mdb = (struct mdb_info *)op->o_bd->be_private;
 
+  if (!mdb->mi_nattrs || mdb_tool_threads > 1) {
+    /* otherwise done by mdb_index_values() */
+    Attribute *a = attr_find(e->e_attrs, slap_schema.si_ad_entryUUID);
+    if (a) {
+      int rc = mdb_uuid2id_values(op, txn, a->a_nvals, e->e_id, SLAP_INDEX_ADD_OP);
+      if (rc)
+        return rc;
+    }
+  }
+
   if (!mdb->mi_nattrs)
     return 0;
 
@@ -0,0 +1,247 @@
+/* $ReOpenLDAP$ */
+/* Copyright 2011-2018 ReOpenLDAP AUTHORS: please see AUTHORS file.
+ * All rights reserved.
+ *
+ * This file is part of ReOpenLDAP.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the OpenLDAP
+ * Public License.
+ *
+ * A copy of this license is available in the file LICENSE in the
+ * top-level directory of the distribution or, alternatively, at
+ * <http://www.OpenLDAP.org/license.html>.
+ */
+
+/* entryUUID to ID lookup table.
+ *
+ * Replication resolves entries by entryUUID all the time. Going through
+ * the equality index costs a hashed key, an IDL and a decode of every
+ * candidate, so the "uu2i" sub-DB maps the normalized (binary) entryUUID
+ * straight to the entry ID. It is maintained from mdb_index_values(), so
+ * every path that indexes an entry keeps it current.
+ *
+ * The DB sequence of the table tells whether it covers the whole database.
+ * A table created for a database that already has entries starts at zero
+ * and is filled by a background task; until then lookups are refused and
+ * callers fall back to a search.
+ */
+
+#include "reldap.h"
+
+#include <stdio.h>
+#include <ac/string.h>
+
+#include "back-mdb.h"
+#include "ldap_rq.h"
+
+/* Entries indexed per transaction while building the table */
+#define MDB_UUID2ID_BATCH 1024
+
+static const char uuid2id_name[] = "uu2i";
+
+int mdb_uuid2id_open(struct mdb_info *mdb, MDBX_txn *txn, unsigned flags) {
+  MDBX_stat st;
+  uint64_t seq;
+  int rc;
+
+  mdb->mi_uuid2id = 0;
+  mdb->mi_uuid2id_ready = 0;
+  mdb->mi_uuid2id_next = 0;
+
+  rc = mdbx_dbi_open(txn, uuid2id_name, flags, &mdb->mi_uuid2id);
+  if (rc == MDBX_NOTFOUND && !(flags & MDBX_CREATE))
+    return 0;
+  if (rc == MDBX_SUCCESS)
+    rc = mdbx_dbi_sequence(txn, mdb->mi_uuid2id, &seq, 0);
+  if (rc == MDBX_SUCCESS && seq == 0 && (flags & MDBX_CREATE)) {
+    /* an empty database is covered right away */
+    rc = mdbx_dbi_stat(txn, mdb->mi_id2entry, &st, sizeof(st));
+    if (rc == MDBX_SUCCESS) {
+      if (st.ms_entries == 0)
+        rc = mdbx_dbi_sequence(txn, mdb->mi_uuid2id, &seq, 1);
+      seq = st.ms_entries == 0;
+    }
+  }
+  if (rc != MDBX_SUCCESS) {
+    mdb->mi_uuid2id = 0;
+    return rc;
+  }
+
+  mdb->mi_uuid2id_ready = seq != 0;
+  return 0;
+}
+
+int mdb_uuid2id_values(Operation *op, MDBX_txn *txn, BerVarray vals, ID id, int opid) {
+  struct mdb_info *mdb = (struct mdb_info *)op->o_bd->be_private;
+  MDBX_val key, data;
+  int i, rc = 0;
+
+  if (!mdb->mi_uuid2id)
+    return 0;
+
+  for (i = 0; !BER_BVISNULL(&vals[i]); i++) {
+    key.iov_base = vals[i].bv_val;
+    key.iov_len = vals[i].bv_len;
+    if (opid == SLAP_INDEX_DELETE_OP) {
+      /* only drop the mapping if it still points to this entry */
+      rc = mdbx_get(txn, mdb->mi_uuid2id, &key, &data);
+      if (rc == MDBX_SUCCESS && data.iov_len == sizeof(ID) && memcmp(data.iov_base, &id, sizeof(ID)) == 0)
+        rc = mdbx_del(txn, mdb->mi_uuid2id, &key, NULL);
+      if (rc == MDBX_NOTFOUND)
+        rc = 0;
+    } else {
+      data.iov_base = &id;
+      data.iov_len = sizeof(ID);
+      rc = mdbx_put(txn, mdb->mi_uuid2id, &key, &data, 0);
+    }
+    if (rc) {
+      Debug(LDAP_DEBUG_ANY, "mdb_uuid2id_values: %s failed for ID %lu: %s (%d)\n",
+            opid == SLAP_INDEX_DELETE_OP ? "del" : "put", (unsigned long)id, mdbx_strerror(rc), rc);
+      return LDAP_OTHER;
+    }
+  }
+  return 0;
+}
+
+int mdb_uuid2dn(Operation *op, struct berval *uuid, struct berval *dn, struct berval *ndn) {
+  struct mdb_info *mdb = (struct mdb_info *)op->o_bd->be_private;
+  mdb_op_info opinfo = {{{0}}}, *moi = &opinfo;
+  MDBX_cursor *mc = NULL;
+  MDBX_val key, data;
+  ID id;
+  int rc;
+
+  if (!slap_tsan__read_int(&mdb->mi_uuid2id_ready))
+    return LDAP_UNAVAILABLE;
+
+  rc = mdb_opinfo_get(op, mdb, 1, &moi);
+  if (rc)
+    return LDAP_OTHER;
+
+  key.iov_base = uuid->bv_val;
+  key.iov_len = uuid->bv_len;
+  rc = mdbx_get(moi->moi_txn, mdb->mi_uuid2id, &key, &data);
+  if (rc == MDBX_SUCCESS) {
+    memcpy(&id, data.iov_base, sizeof(ID));
+    rc = mdb_id2name(op, moi->moi_txn, &mc, id, dn, ndn);
+    if (mc)
+      mdbx_cursor_close(mc);
+  }
+  switch (rc) {
+  case MDBX_SUCCESS:
+    rc = LDAP_SUCCESS;
+    break;
+  case MDBX_NOTFOUND:
+    rc = LDAP_NO_SUCH_OBJECT;
+    break;
+  default:
+    rc = LDAP_OTHER;
+    break;
+  }
+
+  if (moi == &opinfo || --moi->moi_ref < 1) {
+    int __maybe_unused rc2 = mdbx_txn_reset(moi->moi_txn);
+    assert(rc2 == MDBX_SUCCESS);
+    if (moi->moi_oe.oe_key)
+      LDAP_SLIST_REMOVE(&op->o_extra, &moi->moi_oe, OpExtra, oe_next);
+    if ((moi->moi_flag & (MOI_FREEIT | MOI_KEEPER)) == MOI_FREEIT)
+      op->o_tmpfree(moi, op->o_tmpmemctx);
+  }
+  return rc;
+}
+
+/* Fill the table of a database that had entries before it existed.
+ * Runs in batches and gives way to a server pause, continuing from
+ * mi_uuid2id_next on the next run. */
+void *mdb_uuid2id_task(void *ctx, void *arg) {
+  struct re_s *rtask = arg;
+  BackendDB *be = rtask->arg;
+  struct mdb_info *mdb = be->be_private;
+
+  Connection conn = {0};
+  OperationBuffer opbuf;
+  Operation *op;
+
+  MDBX_txn *txn = NULL;
+  MDBX_cursor *mc = NULL;
+  MDBX_val key, data;
+  ID id = mdb->mi_uuid2id_next;
+  int rc = 0, done = 0;
+
+  connection_fake_init(&conn, &opbuf, ctx);
+  op = &opbuf.ob_op;
+  op->o_bd = be;
+
+  while (!done && !slapd_shutdown && (mdb->mi_flags & MDB_IS_OPEN) && slap_biglock_pool_pausing(be) <= 0) {
+    int n;
+
+    rc = mdbx_txn_begin(mdb->mi_dbenv, NULL, 0, &txn);
+    if (rc == MDBX_SUCCESS)
+      rc = mdbx_cursor_open(txn, mdb->mi_id2entry, &mc);
+    if (rc)
+      break;
+
+    key.iov_base = &id;
+    key.iov_len = sizeof(ID);
+    rc = mdbx_cursor_get(mc, &key, &data, MDBX_SET_RANGE);
+    for (n = 0; rc == MDBX_SUCCESS && n < MDB_UUID2ID_BATCH; n++) {
+      Entry *e = NULL;
+      Attribute *a;
+
+      memcpy(&id, key.iov_base, sizeof(ID));
+      rc = mdb_entry_decode(op, txn, &data, id, &e);
+      if (rc)
+        break;
+      e->e_id = id;
+      BER_BVZERO(&e->e_name);
+      BER_BVZERO(&e->e_nname);
+      a = attr_find(e->e_attrs, slap_schema.si_ad_entryUUID);
+      if (a)
+        rc = mdb_uuid2id_values(op, txn, a->a_nvals, id, SLAP_INDEX_ADD_OP);
+      mdb_entry_return(op, e);
+      if (rc == 0)
+        rc = mdbx_cursor_get(mc, &key, &data, MDBX_NEXT);
+    }
+    mdbx_cursor_close(mc);
+    mc = NULL;
+    if (rc == MDBX_NOTFOUND) {
+      rc = mdbx_dbi_sequence(txn, mdb->mi_uuid2id, NULL, 1);
+      done = 1;
+    } else if (rc == MDBX_SUCCESS) {
+      memcpy(&id, key.iov_base, sizeof(ID));
+    }
+    if (rc == MDBX_SUCCESS)
+      rc = mdbx_txn_commit(txn);
+    else
+      mdbx_txn_abort(txn);
+    txn = NULL;
+    if (rc) {
+      done = 0;
+      break;
+    }
+    mdb->mi_uuid2id_next = id;
+  }
+
+  if (rc) {
+    Debug(LDAP_DEBUG_ANY,
+          LDAP_XSTRING(mdb_uuid2id_task) ": database \"%s\": "
+                                         "failed at ID %lu: %s (%d)\n",
+          be->be_suffix[0].bv_val, (unsigned long)id, mdbx_strerror(rc), rc);
+  } else if (done) {
+    Debug(LDAP_DEBUG_STATS,
+          LDAP_XSTRING(mdb_uuid2id_task) ": database \"%s\": "
+                                         "entryUUID table is complete\n",
+          be->be_suffix[0].bv_val);
+    mdb->mi_uuid2id_ready = 1;
+  }
+
+  ldap_pvt_thread_mutex_lock(&slapd_rq.rq_mutex);
+  ldap_pvt_runqueue_stoptask(&slapd_rq, rtask);
+  if ((done || rc) && mdb->mi_uuid2id_task == rtask) {
+    mdb->mi_uuid2id_task = NULL;
+    ldap_pvt_runqueue_remove(&slapd_rq, rtask);
+  }
+  ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+  return NULL;
+}
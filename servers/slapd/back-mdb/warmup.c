@@ -0,0 +1,349 @@
+/* $ReOpenLDAP$ */
+/* Copyright 2011-2018 ReOpenLDAP AUTHORS: please see AUTHORS file.
+ * All rights reserved.
+ *
+ * This file is part of ReOpenLDAP.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the OpenLDAP
+ * Public License.
+ *
+ * A copy of this license is available in the file LICENSE in the
+ * top-level directory of the distribution or, alternatively, at
+ * <http://www.OpenLDAP.org/license.html>.
+ */
+
+/* Startup cache warmup.
+ *
+ * Right after a restart the data file is cold and the first searches pay
+ * for every page fault. When "warmup" is configured, the selected sub-DBs
+ * are walked in the background by a few reader threads which touch every
+ * page of every record, so the kernel pulls them into the page cache while
+ * the server already answers requests. The walk is throttled to the given
+ * rate and drops its snapshot between batches, so it neither starves the
+ * disk nor holds back page reclaiming for the writer.
+ */
+
+#include "reldap.h"
+
+#include <stdio.h>
+#include <ac/string.h>
+#include <ac/unistd.h>
+
+#include "back-mdb.h"
+
+/* Upper limit of threads walking the sub-DBs */
+#define MDB_WARMUP_THREADS 4
+
+/* Records touched between progress updates and throttling */
+#define MDB_WARMUP_BATCH 256
+
+/* Records touched before the read snapshot is renewed anyway */
+#define MDB_WARMUP_RENEW (MDB_WARMUP_BATCH * 64)
+
+enum { WARMUP_PENDING, WARMUP_RUNNING, WARMUP_DONE, WARMUP_STOPPED, WARMUP_FAILED };
+
+static const char *const warmup_states[] = {"pending", "running", "done", "stopped", "failed"};
+
+static const struct berval warmup_names[] = {BER_BVC("ad2id"), BER_BVC("dn2id"), BER_BVC("id2entry"),
+                                             BER_BVC("id2val"), BER_BVC("all"), BER_BVNULL};
+
+typedef struct warmup_db {
+  struct berval wd_name;
+  MDBX_dbi wd_dbi;
+  int wd_state;
+  size_t wd_done;  /* records touched */
+  size_t wd_total; /* records at start */
+  uint64_t wd_bytes;
+} warmup_db;
+
+struct mdb_warmup {
+  struct mdb_info *mw_mdb;
+  ldap_pvt_thread_mutex_t mw_mutex;
+  volatile int mw_stop;
+  uint64_t mw_rate; /* bytes per second for each thread, 0 is unlimited */
+  int mw_next;      /* next pending sub-DB */
+  int mw_nthreads;
+  ldap_pvt_thread_t mw_tids[MDB_WARMUP_THREADS];
+  int mw_ndbs;
+  warmup_db mw_dbs[1];
+};
+
+/* Returns MDB_AD2ID..MDB_ID2VAL for a main sub-DB, MDB_NDB for "all"
+ * and -1 for anything else, which is expected to be an attribute name. */
+int mdb_warmup_dbname(struct berval *name) {
+  int i;
+
+  for (i = 0; !BER_BVISNULL(&warmup_names[i]); i++) {
+    if (ber_bvstrcasecmp(name, &warmup_names[i]) == 0)
+      return i;
+  }
+  return -1;
+}
+
+static void warmup_add(struct mdb_warmup *mw, struct berval *name, MDBX_dbi dbi) {
+  int i;
+
+  for (i = 0; i < mw->mw_ndbs; i++) {
+    if (mw->mw_dbs[i].wd_dbi == dbi)
+      return;
+  }
+  ber_dupbv(&mw->mw_dbs[i].wd_name, name);
+  mw->mw_dbs[i].wd_dbi = dbi;
+  mw->mw_dbs[i].wd_state = WARMUP_PENDING;
+  mw->mw_ndbs++;
+}
+
+static void warmup_progress(struct mdb_warmup *mw, warmup_db *wd, int state, size_t done, uint64_t bytes) {
+  ldap_pvt_thread_mutex_lock(&mw->mw_mutex);
+  wd->wd_state = state;
+  wd->wd_done = done;
+  wd->wd_bytes = bytes;
+  ldap_pvt_thread_mutex_unlock(&mw->mw_mutex);
+}
+
+static int warmup_walk(struct mdb_warmup *mw, warmup_db *wd) {
+  MDBX_env *env = mw->mw_mdb->mi_dbenv;
+  MDBX_txn *txn = NULL;
+  MDBX_cursor *mc = NULL;
+  MDBX_val key, data;
+  MDBX_stat st;
+  MDBX_cursor_op op = MDBX_FIRST;
+  void *saved = NULL;
+  size_t done = 0, savedsize = 0;
+  uint64_t bytes = 0, start;
+  unsigned batch = 0;
+  volatile unsigned char sink = 0;
+  int rc;
+
+  rc = mdbx_txn_begin(env, NULL, MDBX_TXN_RDONLY, &txn);
+  if (rc == MDBX_SUCCESS)
+    rc = mdbx_dbi_stat(txn, wd->wd_dbi, &st, sizeof(st));
+  if (rc == MDBX_SUCCESS)
+    rc = mdbx_cursor_open(txn, wd->wd_dbi, &mc);
+  if (rc != MDBX_SUCCESS)
+    goto done;
+
+  ldap_pvt_thread_mutex_lock(&mw->mw_mutex);
+  wd->wd_total = st.ms_entries;
+  wd->wd_state = WARMUP_RUNNING;
+  ldap_pvt_thread_mutex_unlock(&mw->mw_mutex);
+
+  start = ldap_now_steady_ns();
+  while (!slap_tsan__read_int(&mw->mw_stop) && (rc = mdbx_cursor_get(mc, &key, &data, op)) == MDBX_SUCCESS) {
+    const unsigned char *p = data.iov_base;
+    size_t off;
+    uint64_t pause = 0;
+
+    op = MDBX_NEXT;
+    /* one byte per page faults in the leaf and any overflow pages */
+    for (off = 0; off < data.iov_len; off += st.ms_psize)
+      sink += p[off];
+    bytes += key.iov_len + data.iov_len;
+    done++;
+
+    if (++batch < MDB_WARMUP_BATCH)
+      continue;
+    batch = 0;
+    warmup_progress(mw, wd, WARMUP_RUNNING, done, bytes);
+
+    if (mw->mw_rate) {
+      uint64_t elapsed = ldap_now_steady_ns() - start;
+      uint64_t expected = bytes * 1000000000ull / mw->mw_rate;
+      if (expected > elapsed)
+        pause = (expected - elapsed) / 1000;
+    }
+    if (pause == 0 && done % MDB_WARMUP_RENEW)
+      continue;
+
+    /* Drop the snapshot while idle, so the writer may reclaim pages,
+     * then continue from the last key seen. For a DUPSORT DB this
+     * revisits the preceding duplicates of that key, which is harmless. */
+    if (savedsize < key.iov_len) {
+      savedsize = key.iov_len;
+      saved = ch_realloc(saved, savedsize);
+    }
+    memcpy(saved, key.iov_base, key.iov_len);
+    key.iov_base = saved;
+    mdbx_txn_reset(txn);
+    while (pause > 0 && !slap_tsan__read_int(&mw->mw_stop)) {
+      unsigned us = pause > 100000 ? 100000 : pause;
+      usleep(us);
+      pause -= us;
+    }
+    rc = mdbx_txn_renew(txn);
+    if (rc == MDBX_SUCCESS)
+      rc = mdbx_cursor_renew(txn, mc);
+    if (rc != MDBX_SUCCESS)
+      break;
+    op = MDBX_SET_RANGE;
+  }
+  if (rc == MDBX_NOTFOUND)
+    rc = MDBX_SUCCESS;
+
+done:
+  if (mc)
+    mdbx_cursor_close(mc);
+  if (txn)
+    mdbx_txn_abort(txn);
+  ch_free(saved);
+  (void)sink;
+
+  if (rc != MDBX_SUCCESS)
+    warmup_progress(mw, wd, WARMUP_FAILED, done, bytes);
+  else
+    warmup_progress(mw, wd, slap_tsan__read_int(&mw->mw_stop) ? WARMUP_STOPPED : WARMUP_DONE, done, bytes);
+  return rc;
+}
+
+static void *warmup_thread(void *ctx) {
+  struct mdb_warmup *mw = ctx;
+
+  for (;;) {
+    warmup_db *wd;
+    uint64_t start;
+    int rc;
+
+    ldap_pvt_thread_mutex_lock(&mw->mw_mutex);
+    wd = (mw->mw_next < mw->mw_ndbs && !mw->mw_stop) ? &mw->mw_dbs[mw->mw_next++] : NULL;
+    ldap_pvt_thread_mutex_unlock(&mw->mw_mutex);
+    if (!wd)
+      break;
+
+    start = ldap_now_steady_ns();
+    rc = warmup_walk(mw, wd);
+    if (rc != MDBX_SUCCESS) {
+      Debug(LDAP_DEBUG_ANY, "mdb_warmup: %s: %s (%d)\n", wd->wd_name.bv_val, mdbx_strerror(rc), rc);
+    } else {
+      Debug(LDAP_DEBUG_STATS, "mdb_warmup: %s %s: %zu records, %lu kbyte in %lu ms\n", wd->wd_name.bv_val,
+            warmup_states[wd->wd_state], wd->wd_done, (unsigned long)(wd->wd_bytes >> 10),
+            (unsigned long)((ldap_now_steady_ns() - start) / 1000000));
+    }
+  }
+  return NULL;
+}
+
+int mdb_warmup_start(BackendDB *be) {
+  struct mdb_info *mdb = (struct mdb_info *)be->be_private;
+  struct mdb_warmup *mw;
+  int i, n;
+
+  assert(mdb->mi_warmup == NULL);
+  for (n = 0; mdb->mi_warmup_names && !BER_BVISNULL(&mdb->mi_warmup_names[n]); n++)
+    ;
+  if (n == 0)
+    return 0;
+
+  /* "all" may expand to every index */
+  mw = ch_calloc(1, sizeof(*mw) + sizeof(warmup_db) * (MDB_NDB + mdb->mi_nattrs + n));
+  mw->mw_mdb = mdb;
+  ldap_pvt_thread_mutex_init(&mw->mw_mutex);
+
+  for (i = 0; i < n; i++) {
+    struct berval *name = &mdb->mi_warmup_names[i];
+    int k = mdb_warmup_dbname(name);
+
+    if (k == MDB_NDB) {
+      int j;
+      for (j = 0; j < MDB_NDB; j++)
+        warmup_add(mw, (struct berval *)&warmup_names[j], mdb->mi_dbis[j]);
+      for (j = 0; j < mdb->mi_nattrs; j++) {
+        if (mdb->mi_attrs[j]->ai_dbi)
+          warmup_add(mw, &mdb->mi_attrs[j]->ai_desc->ad_cname, mdb->mi_attrs[j]->ai_dbi);
+      }
+    } else if (k >= 0) {
+      warmup_add(mw, name, mdb->mi_dbis[k]);
+    } else {
+      AttributeDescription *ad = NULL;
+      const char *text;
+      AttrInfo *ai = NULL;
+
+      if (slap_bv2ad(name, &ad, &text) == LDAP_SUCCESS)
+        ai = mdb_attr_mask(mdb, ad);
+      if (ai && ai->ai_dbi) {
+        warmup_add(mw, &ai->ai_desc->ad_cname, ai->ai_dbi);
+      } else {
+        Debug(LDAP_DEBUG_ANY,
+              "mdb_warmup_start: database \"%s\": "
+              "\"%s\" is not indexed, skipped.\n",
+              be->be_suffix[0].bv_val, name->bv_val);
+      }
+    }
+  }
+
+  n = mw->mw_ndbs < MDB_WARMUP_THREADS ? mw->mw_ndbs : MDB_WARMUP_THREADS;
+  if (n > 0)
+    mw->mw_rate = (uint64_t)mdb->mi_warmup_rate * 1024 / n;
+  ldap_pvt_thread_mutex_lock(&mdb->mi_warmup_mutex);
+  mdb->mi_warmup = mw;
+  ldap_pvt_thread_mutex_unlock(&mdb->mi_warmup_mutex);
+
+  for (i = 0; i < n; i++) {
+    int rc = ldap_pvt_thread_create(&mw->mw_tids[mw->mw_nthreads], 0, warmup_thread, mw);
+    if (rc != 0) {
+      Debug(LDAP_DEBUG_ANY,
+            "mdb_warmup_start: database \"%s\": "
+            "thread creation failed (%d).\n",
+            be->be_suffix[0].bv_val, rc);
+      break;
+    }
+    mw->mw_nthreads++;
+  }
+  return 0;
+}
+
+void mdb_warmup_stop(struct mdb_info *mdb) {
+  struct mdb_warmup *mw;
+  int i;
+
+  /* unpublish first, so the monitor never sees it being freed */
+  ldap_pvt_thread_mutex_lock(&mdb->mi_warmup_mutex);
+  mw = mdb->mi_warmup;
+  mdb->mi_warmup = NULL;
+  ldap_pvt_thread_mutex_unlock(&mdb->mi_warmup_mutex);
+  if (!mw)
+    return;
+
+  ldap_pvt_thread_mutex_lock(&mw->mw_mutex);
+  mw->mw_stop = 1;
+  ldap_pvt_thread_mutex_unlock(&mw->mw_mutex);
+  for (i = 0; i < mw->mw_nthreads; i++)
+    ldap_pvt_thread_join(mw->mw_tids[i], NULL);
+
+  for (i = 0; i < mw->mw_ndbs; i++)
+    ch_free(mw->mw_dbs[i].wd_name.bv_val);
+  ldap_pvt_thread_mutex_destroy(&mw->mw_mutex);
+  ch_free(mw);
+}
+
+/* One value per sub-DB: "<name> <state> <done>/<total> <kbyte>k" */
+BerVarray mdb_warmup_status(struct mdb_info *mdb) {
+  struct mdb_warmup *mw;
+  BerVarray vals = NULL;
+  int i;
+
+  ldap_pvt_thread_mutex_lock(&mdb->mi_warmup_mutex);
+  mw = mdb->mi_warmup;
+  if (!mw) {
+    ldap_pvt_thread_mutex_unlock(&mdb->mi_warmup_mutex);
+    return NULL;
+  }
+
+  ldap_pvt_thread_mutex_lock(&mw->mw_mutex);
+  for (i = 0; i < mw->mw_ndbs; i++) {
+    warmup_db *wd = &mw->mw_dbs[i];
+    char buf[SLAP_TEXT_BUFLEN];
+    struct berval bv;
+
+    bv.bv_len = snprintf(buf, sizeof(buf), "%s %s %zu/%zu %luk", wd->wd_name.bv_val, warmup_states[wd->wd_state],
+                         wd->wd_done, wd->wd_total, (unsigned long)(wd->wd_bytes >> 10));
+    if (bv.bv_len >= sizeof(buf))
+      bv.bv_len = sizeof(buf) - 1;
+    bv.bv_val = buf;
+    value_add_one(&vals, &bv);
+  }
+  ldap_pvt_thread_mutex_unlock(&mw->mw_mutex);
+  ldap_pvt_thread_mutex_unlock(&mdb->mi_warmup_mutex);
+
+  return vals;
+}
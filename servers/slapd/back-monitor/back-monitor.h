@@ -131,6 +131,9 @@ typedef struct monitor_info_t {
   AttributeDescription *mi_ad_monitorUpdateRef;
   AttributeDescription *mi_ad_monitorRuntimeConfig;
   AttributeDescription *mi_ad_monitorSuperiorDN;
+  AttributeDescription *mi_ad_monitorOpQueueTime;
+  AttributeDescription *mi_ad_monitorOpBackendTime;
+  AttributeDescription *mi_ad_monitorOpTotalTime;
 
   /*
    * Generic description attribute
@@ -1808,6 +1808,27 @@ int monitor_back_initialize(BackendInfo *bi) {
               "NO-USER-MODIFICATION "
               "USAGE dSAOperation )",
               SLAP_AT_FINAL | SLAP_AT_HIDE, offsetof(monitor_info_t, mi_ad_monitorSuperiorDN)},
+             {"( 1.3.6.1.4.1.4203.666.1.55.31 "
+              "NAME 'monitorOpQueueTime' "
+              "DESC 'monitor histogram of time waiting for a thread' "
+              "SUP monitoredInfo "
+              "NO-USER-MODIFICATION "
+              "USAGE dSAOperation )",
+              SLAP_AT_FINAL | SLAP_AT_HIDE, offsetof(monitor_info_t, mi_ad_monitorOpQueueTime)},
+             {"( 1.3.6.1.4.1.4203.666.1.55.32 "
+              "NAME 'monitorOpBackendTime' "
+              "DESC 'monitor histogram of time spent in the database' "
+              "SUP monitoredInfo "
+              "NO-USER-MODIFICATION "
+              "USAGE dSAOperation )",
+              SLAP_AT_FINAL | SLAP_AT_HIDE, offsetof(monitor_info_t, mi_ad_monitorOpBackendTime)},
+             {"( 1.3.6.1.4.1.4203.666.1.55.33 "
+              "NAME 'monitorOpTotalTime' "
+              "DESC 'monitor histogram of time until the result was sent' "
+              "SUP monitoredInfo "
+              "NO-USER-MODIFICATION "
+              "USAGE dSAOperation )",
+              SLAP_AT_FINAL | SLAP_AT_HIDE, offsetof(monitor_info_t, mi_ad_monitorOpTotalTime)},
              {NULL, 0, -1}};
 
   static struct {
@@ -142,14 +142,56 @@ static int monitor_subsys_ops_destroy(BackendDB *be, monitor_subsys_t *ms) {
   return 0;
 }
 
+/* Replace the values of ad with the cumulative counts of hist,
+ * "<upper bound in microseconds> <count>" for the buckets between
+ * the first and the last non-empty ones, then "+Inf <total>". */
+static void monitor_ops_latency(Entry *e, AttributeDescription *ad, uint64_t *hist) {
+  BerVarray vals = NULL;
+  struct berval bv;
+  char buf[64];
+  uint64_t total = 0;
+  int i, first = -1, last = -1;
+
+  for (i = 0; i < SLAP_LATENCY_BUCKETS - 1; i++) {
+    if (hist[i]) {
+      if (first < 0)
+        first = i;
+      last = i;
+    }
+  }
+
+  bv.bv_val = buf;
+  for (i = first; first >= 0 && i <= last; i++) {
+    total += hist[i];
+    bv.bv_len = snprintf(buf, sizeof(buf), "%lu %" PRIu64, 1ul << i, total);
+    value_add_one(&vals, &bv);
+  }
+  total += hist[SLAP_LATENCY_BUCKETS - 1];
+  bv.bv_len = snprintf(buf, sizeof(buf), "+Inf %" PRIu64, total);
+  value_add_one(&vals, &bv);
+
+  attr_delete(&e->e_attrs, ad);
+  attr_merge_normalize(e, ad, vals, NULL);
+  ber_bvarray_free(vals);
+}
+
+static void monitor_ops_latency_add(uint64_t (*sum)[SLAP_LATENCY_BUCKETS], slap_counters_t *sc, int opidx) {
+  int j, k;
+
+  for (j = 0; j < SLAP_LATENCY_LAST; j++)
+    for (k = 0; k < SLAP_LATENCY_BUCKETS; k++)
+      sum[j][k] += sc->sc_ops_latency_[opidx][j][k];
+}
+
 static int monitor_subsys_ops_update(Operation *op, SlapReply *rs, Entry *e) {
   monitor_info_t *mi = (monitor_info_t *)op->o_bd->be_private;
 
   ldap_pvt_mp_t nInitiated = LDAP_PVT_MP_INIT, nCompleted = LDAP_PVT_MP_INIT;
+  uint64_t latency[SLAP_LATENCY_LAST][SLAP_LATENCY_BUCKETS];
   struct berval rdn;
-  int i;
+  int i, first = 0, last = SLAP_OP_LAST;
   Attribute *a;
-  slap_counters_t *sc;
+  slap_counters_t sum;
   static struct berval bv_ops = BER_BVC("cn=operations");
 
   assert(mi != NULL);
@@ -157,46 +199,28 @@ static int monitor_subsys_ops_update(Operation *op, SlapReply *rs, Entry *e) {
 
   dnRdn(&e->e_nname, &rdn);
 
-  if (dn_match(&rdn, &bv_ops)) {
-    ldap_pvt_mp_init(nInitiated);
-    ldap_pvt_mp_init(nCompleted);
-
-    ldap_pvt_thread_mutex_lock(&slap_counters.sc_mutex);
+  if (!dn_match(&rdn, &bv_ops)) {
     for (i = 0; i < SLAP_OP_LAST; i++) {
-      ldap_pvt_mp_add(nInitiated, slap_counters.sc_ops_initiated_[i]);
-      ldap_pvt_mp_add(nCompleted, slap_counters.sc_ops_completed_[i]);
-    }
-    for (sc = slap_counters.sc_next; sc; sc = sc->sc_next) {
-      ldap_pvt_thread_mutex_lock(&sc->sc_mutex);
-      for (i = 0; i < SLAP_OP_LAST; i++) {
-        ldap_pvt_mp_add(nInitiated, sc->sc_ops_initiated_[i]);
-        ldap_pvt_mp_add(nCompleted, sc->sc_ops_completed_[i]);
-      }
-      ldap_pvt_thread_mutex_unlock(&sc->sc_mutex);
-    }
-    ldap_pvt_thread_mutex_unlock(&slap_counters.sc_mutex);
-
-  } else {
-    for (i = 0; i < SLAP_OP_LAST; i++) {
-      if (dn_match(&rdn, &monitor_op[i].nrdn)) {
-        ldap_pvt_thread_mutex_lock(&slap_counters.sc_mutex);
-        ldap_pvt_mp_init_set(nInitiated, slap_counters.sc_ops_initiated_[i]);
-        ldap_pvt_mp_init_set(nCompleted, slap_counters.sc_ops_completed_[i]);
-        for (sc = slap_counters.sc_next; sc; sc = sc->sc_next) {
-          ldap_pvt_thread_mutex_lock(&sc->sc_mutex);
-          ldap_pvt_mp_add(nInitiated, sc->sc_ops_initiated_[i]);
-          ldap_pvt_mp_add(nCompleted, sc->sc_ops_completed_[i]);
-          ldap_pvt_thread_mutex_unlock(&sc->sc_mutex);
-        }
-        ldap_pvt_thread_mutex_unlock(&slap_counters.sc_mutex);
+      if (dn_match(&rdn, &monitor_op[i].nrdn))
         break;
-      }
     }
 
     if (i == SLAP_OP_LAST) {
       /* not found ... */
       return (0);
     }
+    first = i;
+    last = i + 1;
+  }
+
+  slap_counters_sum(&sum);
+  memset(latency, 0, sizeof(latency));
+  ldap_pvt_mp_init(nInitiated);
+  ldap_pvt_mp_init(nCompleted);
+  for (i = first; i < last; i++) {
+    ldap_pvt_mp_add_ulong(nInitiated, sum.sc_ops_initiated_[i]);
+    ldap_pvt_mp_add_ulong(nCompleted, sum.sc_ops_completed_[i]);
+    monitor_ops_latency_add(latency, &sum, i);
   }
 
   a = attr_find(e->e_attrs, mi->mi_ad_monitorOpInitiated);
@@ -213,6 +237,10 @@ static int monitor_subsys_ops_update(Operation *op, SlapReply *rs, Entry *e) {
   UI2BV(&a->a_vals[0], nCompleted);
   ldap_pvt_mp_clear(nCompleted);
 
+  monitor_ops_latency(e, mi->mi_ad_monitorOpQueueTime, latency[SLAP_LATENCY_QUEUE]);
+  monitor_ops_latency(e, mi->mi_ad_monitorOpBackendTime, latency[SLAP_LATENCY_BACKEND]);
+  monitor_ops_latency(e, mi->mi_ad_monitorOpTotalTime, latency[SLAP_LATENCY_TOTAL]);
+
   /* FIXME: touch modifyTimestamp? */
 
   return SLAP_CB_CONTINUE;
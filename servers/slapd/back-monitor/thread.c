@@ -33,6 +33,7 @@ typedef enum {
   MT_UNKNOWN,
   MT_RUNQUEUE,
   MT_TASKLIST,
+  MT_QUEUES,
 
   MT_LAST
 } monitor_thread_t;
@@ -61,13 +62,13 @@ static struct {
 	{ BER_BVC( "cn=Active Max" ),
 		BER_BVNULL,
 		BER_BVNULL,	LDAP_PVT_THREAD_POOL_PARAM_ACTIVE_MAX,	MT_UNKNOWN },
-	{ BER_BVC( "cn=Pending Max" ),
-		BER_BVNULL,
-		BER_BVNULL,	LDAP_PVT_THREAD_POOL_PARAM_PENDING_MAX,	MT_UNKNOWN },
-	{ BER_BVC( "cn=Backload Max" ),
-		BER_BVNULL,
-		BER_BVNULL,	LDAP_PVT_THREAD_POOL_PARAM_BACKLOAD_MAX,MT_UNKNOWN },
 #endif
+    {BER_BVC("cn=Pending Max"), BER_BVC("Highest number of pending threads seen by a work queue"), BER_BVNULL,
+     LDAP_PVT_THREAD_POOL_PARAM_PENDING_MAX, MT_UNKNOWN},
+    {BER_BVC("cn=Backload Max"), BER_BVC("Highest number of active plus pending threads seen by a work queue"),
+     BER_BVNULL, LDAP_PVT_THREAD_POOL_PARAM_BACKLOAD_MAX, MT_UNKNOWN},
+    {BER_BVC("cn=Stolen"), BER_BVC("Number of tasks taken over by a thread of another work queue"), BER_BVNULL,
+     LDAP_PVT_THREAD_POOL_PARAM_STOLEN, MT_UNKNOWN},
     {BER_BVC("cn=State"), BER_BVC("Thread pool state"), BER_BVNULL, LDAP_PVT_THREAD_POOL_PARAM_STATE, MT_UNKNOWN},
 
     {BER_BVC("cn=Runqueue"), BER_BVC("Queue of running threads - besides those handling operations"), BER_BVNULL,
@@ -76,6 +77,8 @@ static struct {
      BER_BVC("List of running plus standby threads - besides those handling "
              "operations"),
      BER_BVNULL, LDAP_PVT_THREAD_POOL_PARAM_UNKNOWN, MT_TASKLIST},
+    {BER_BVC("cn=Queues"), BER_BVC("Backlog of each work queue"), BER_BVNULL, LDAP_PVT_THREAD_POOL_PARAM_UNKNOWN,
+     MT_QUEUES},
 
     {BER_BVNULL}};
 
@@ -281,6 +284,45 @@ static int monitor_subsys_thread_update(Operation *op, SlapReply *rs, Entry *e)
       }
       break;
 
+    case MT_QUEUES: {
+      int q, numqs = 0, open, active, pending, backload_max, stolen;
+
+      if (a != NULL) {
+        if (a->a_nvals != a->a_vals) {
+          ber_bvarray_free(a->a_nvals);
+        }
+        ber_bvarray_free(a->a_vals);
+        a->a_vals = NULL;
+        a->a_nvals = NULL;
+        a->a_numvals = 0;
+      }
+
+      bv.bv_val = buf;
+      (void)ldap_pvt_thread_pool_query(&connection_pool, LDAP_PVT_THREAD_POOL_PARAM_QUEUES, (void *)&numqs);
+      for (q = 0; q < numqs; q++) {
+        if (ldap_pvt_thread_pool_queue_query(&connection_pool, q, LDAP_PVT_THREAD_POOL_PARAM_OPEN, &open) ||
+            ldap_pvt_thread_pool_queue_query(&connection_pool, q, LDAP_PVT_THREAD_POOL_PARAM_ACTIVE, &active) ||
+            ldap_pvt_thread_pool_queue_query(&connection_pool, q, LDAP_PVT_THREAD_POOL_PARAM_PENDING, &pending) ||
+            ldap_pvt_thread_pool_queue_query(&connection_pool, q, LDAP_PVT_THREAD_POOL_PARAM_BACKLOAD_MAX,
+                                             &backload_max) ||
+            ldap_pvt_thread_pool_queue_query(&connection_pool, q, LDAP_PVT_THREAD_POOL_PARAM_STOLEN, &stolen))
+          break;
+        bv.bv_len = snprintf(buf, sizeof(buf), "{%d}open=%d active=%d pending=%d backloadMax=%d stolen=%d", q, open,
+                             active, pending, backload_max, stolen);
+        if (bv.bv_len < sizeof(buf)) {
+          value_add_one(&vals, &bv);
+        }
+      }
+
+      if (vals) {
+        attr_merge_normalize(e, mi->mi_ad_monitoredInfo, vals, NULL);
+        ber_bvarray_free(vals);
+
+      } else {
+        attr_delete(&e->e_attrs, mi->mi_ad_monitoredInfo);
+      }
+    } break;
+
     default:
       LDAP_BUG();
     }
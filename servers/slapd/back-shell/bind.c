@@ -54,6 +54,7 @@ int shell_back_bind(Operation *op, SlapReply *rs) {
   e.e_name = op->o_req_dn;
   e.e_nname = op->o_req_ndn;
   e.e_attrs = NULL;
+  e.e_aindex = NULL;
   e.e_ocflags = 0;
   e.e_bv.bv_len = 0;
   e.e_bv.bv_val = NULL;
@@ -1270,12 +1270,269 @@ int be_entry_get_rw(Operation *op, struct berval *ndn, ObjectClass *oc, Attribut
   return LDAP_UNWILLING_TO_PERFORM;
 }
 
+/* Resolve a normalized entryUUID to the DN of the entry by a direct lookup
+ * in the backend of op->o_bd, without any overlays. LDAP_UNAVAILABLE means
+ * the backend cannot tell and the caller has to search instead. The DNs
+ * are allocated in op->o_tmpmemctx. */
+int be_uuid2dn(Operation *op, struct berval *uuid, struct berval *dn, struct berval *ndn) {
+  BackendInfo *bi;
+
+  /* glued subordinates keep their own tables */
+  if (op->o_bd == NULL || SLAP_GLUE_INSTANCE(op->o_bd))
+    return LDAP_UNAVAILABLE;
+
+  bi = op->o_bd->bd_info;
+  if (overlay_is_over(op->o_bd))
+    bi = ((slap_overinfo *)bi->bi_private)->oi_orig;
+  if (!bi->bi_uuid2dn)
+    return LDAP_UNAVAILABLE;
+
+  return bi->bi_uuid2dn(op, uuid, dn, ndn);
+}
+
+/* Check whether the normalized value nval is present in attribute at of the
+ * entry ndn by a direct lookup in the backend of op->o_bd, without fetching
+ * the whole entry. Returns LDAP_COMPARE_TRUE or LDAP_COMPARE_FALSE, else
+ * what fetching the entry would give: LDAP_NO_SUCH_OBJECT where
+ * be_entry_get_rw() with the same oc and at fails, LDAP_NO_SUCH_ATTRIBUTE
+ * where it returns the entry without the attribute. LDAP_UNAVAILABLE means
+ * the backend cannot tell and the caller has to fetch the entry. */
+int be_entry_valfind(Operation *op, struct berval *ndn, ObjectClass *oc, AttributeDescription *at,
+                     struct berval *nval) {
+  BackendInfo *bi;
+
+  if (op->o_bd == NULL)
+    return LDAP_UNAVAILABLE;
+
+  bi = op->o_bd->bd_info;
+  if (overlay_is_over(op->o_bd)) {
+    slap_overinfo *oi = bi->bi_private;
+    slap_overinst *on;
+
+    /* an overlay that provides entries itself must see the fetch */
+    for (on = oi->oi_list; on; on = on->on_next) {
+      if (on->on_bi.bi_entry_get_rw)
+        return LDAP_UNAVAILABLE;
+    }
+    bi = oi->oi_orig;
+  }
+  if (!bi->bi_entry_valfind)
+    return LDAP_UNAVAILABLE;
+
+  return bi->bi_entry_valfind(op, ndn, oc, at, nval);
+}
+
+/*
+ * A bounded cache of the group assertions across operations, as
+ * (database, group DN, objectClass, member attribute, member DN) ->
+ * result, shared by fe_acl_group() and the sets of acl_match_set(),
+ * which key it by the set and the target DN instead.  The results are
+ * dropped by each write operation along with the ACL decisions cached
+ * by acl.c, i.e. when acl_cache_gen is bumped, and after a while
+ * anyway, for the groups whose entries change behind the back of the
+ * server.  Those evaluated by a write operation are never stored, nor
+ * those read from the target entry, which might not be the one stored.
+ */
+#define GROUP_CACHE_SHARDS 16
+#define GROUP_CACHE_BUCKETS 1024 /* per shard */
+
+unsigned group_cache_max = 8192; /* assertions in all, 0 disables the cache */
+unsigned group_cache_ttl = 600;  /* seconds */
+
+typedef struct group_cache_entry {
+  LDAP_LIST_ENTRY(group_cache_entry) gce_chain;
+  LDAP_TAILQ_ENTRY(group_cache_entry) gce_lru;
+  uint32_t gce_hash;
+  unsigned gce_gen;
+  time_t gce_expire;
+  BackendDB *gce_be;
+  ObjectClass *gce_oc;
+  AttributeDescription *gce_at;
+  int gce_res;
+  struct berval gce_group;
+  struct berval gce_opndn;
+  struct berval gce_endn;
+} group_cache_entry;
+
+typedef struct group_cache_shard {
+  ldap_pvt_thread_mutex_t gcs_mutex;
+  unsigned gcs_count;
+  LDAP_TAILQ_HEAD(group_cache_lru, group_cache_entry) gcs_lru;
+  LDAP_LIST_HEAD(group_cache_chain, group_cache_entry) gcs_chain[GROUP_CACHE_BUCKETS];
+} __cache_aligned group_cache_shard;
+
+static group_cache_shard *group_cache;
+static void *group_cache_alloc;
+
+void group_cache_init(void) {
+  int i, j;
+
+  group_cache_alloc = ch_calloc(1, GROUP_CACHE_SHARDS * sizeof(group_cache_shard) + CACHELINE_SIZE - 1);
+  group_cache =
+      (group_cache_shard *)(((size_t)group_cache_alloc + CACHELINE_SIZE - 1) & ~(size_t)(CACHELINE_SIZE - 1));
+  for (i = 0; i < GROUP_CACHE_SHARDS; i++) {
+    ldap_pvt_thread_mutex_init(&group_cache[i].gcs_mutex);
+    LDAP_TAILQ_INIT(&group_cache[i].gcs_lru);
+    for (j = 0; j < GROUP_CACHE_BUCKETS; j++)
+      LDAP_LIST_INIT(&group_cache[i].gcs_chain[j]);
+  }
+}
+
+/* gcs_mutex locked */
+static void group_cache_evict(group_cache_shard *gcs, group_cache_entry *gce) {
+  LDAP_LIST_REMOVE(gce, gce_chain);
+  LDAP_TAILQ_REMOVE(&gcs->gcs_lru, gce, gce_lru);
+  gcs->gcs_count--;
+  ch_free(gce);
+}
+
+void group_cache_destroy(void) {
+  group_cache_entry *gce;
+  int i;
+
+  if (!group_cache)
+    return;
+
+  for (i = 0; i < GROUP_CACHE_SHARDS; i++) {
+    while ((gce = LDAP_TAILQ_FIRST(&group_cache[i].gcs_lru)) != NULL)
+      group_cache_evict(&group_cache[i], gce);
+    ldap_pvt_thread_mutex_destroy(&group_cache[i].gcs_mutex);
+  }
+  ch_free(group_cache_alloc);
+  group_cache = NULL;
+}
+
+static uint32_t group_cache_hash(uint32_t h, const void *p, size_t len) {
+  const unsigned char *c = p;
+
+  while (len--)
+    h = (h ^ *c++) * 16777619u;
+  return h;
+}
+
+static uint32_t group_cache_key(BackendDB *be, struct berval *group, ObjectClass *oc, AttributeDescription *at,
+                                struct berval *op_ndn, struct berval *endn) {
+  uint32_t h = 2166136261u; /* FNV-1a */
+
+  h = group_cache_hash(h, &be, sizeof(be));
+  h = group_cache_hash(h, &oc, sizeof(oc));
+  h = group_cache_hash(h, &at, sizeof(at));
+  h = group_cache_hash(h, group->bv_val, group->bv_len);
+  h = group_cache_hash(h, "", 1);
+  h = group_cache_hash(h, op_ndn->bv_val, op_ndn->bv_len);
+  h = group_cache_hash(h, "", 1);
+  return group_cache_hash(h, endn->bv_val, endn->bv_len);
+}
+
+/* Whether the group assertions evaluated by op may be shared */
+static int group_cache_usable(Operation *op) {
+  if (!group_cache || !group_cache_max || op->o_do_not_cache)
+    return 0;
+
+  switch (op->o_tag) {
+  case LDAP_REQ_BIND:
+  case LDAP_REQ_ADD:
+  case LDAP_REQ_DELETE:
+  case LDAP_REQ_MODIFY:
+  case LDAP_REQ_MODRDN:
+  case LDAP_REQ_EXTENDED:
+    return 0;
+  }
+  return 1;
+}
+
+/* Look up the result of a group assertion, or of a set when be, oc
+ * and at are NULL; endn is empty unless the result depends on it */
+int group_cache_get(Operation *op, BackendDB *be, struct berval *group, ObjectClass *oc, AttributeDescription *at,
+                    struct berval *op_ndn, struct berval *endn, int *res) {
+  group_cache_shard *gcs;
+  group_cache_entry *gce, *next;
+  uint32_t h;
+  unsigned gen;
+
+  if (!group_cache_usable(op))
+    return 0;
+
+  h = group_cache_key(be, group, oc, at, op_ndn, endn);
+  gcs = &group_cache[h % GROUP_CACHE_SHARDS];
+  gen = __atomic_load_n(&acl_cache_gen, __ATOMIC_ACQUIRE);
+
+  ldap_pvt_thread_mutex_lock(&gcs->gcs_mutex);
+  for (gce = LDAP_LIST_FIRST(&gcs->gcs_chain[(h / GROUP_CACHE_SHARDS) % GROUP_CACHE_BUCKETS]); gce != NULL;
+       gce = next) {
+    next = LDAP_LIST_NEXT(gce, gce_chain);
+    if (gce->gce_gen != gen || gce->gce_expire <= op->o_time) {
+      group_cache_evict(gcs, gce);
+      continue;
+    }
+    if (gce->gce_hash == h && gce->gce_be == be && gce->gce_oc == oc && gce->gce_at == at &&
+        bvmatch(&gce->gce_group, group) && bvmatch(&gce->gce_opndn, op_ndn) && bvmatch(&gce->gce_endn, endn)) {
+      LDAP_TAILQ_REMOVE(&gcs->gcs_lru, gce, gce_lru);
+      LDAP_TAILQ_INSERT_TAIL(&gcs->gcs_lru, gce, gce_lru);
+      *res = gce->gce_res;
+      ldap_pvt_thread_mutex_unlock(&gcs->gcs_mutex);
+      return 1;
+    }
+  }
+  ldap_pvt_thread_mutex_unlock(&gcs->gcs_mutex);
+  return 0;
+}
+
+void group_cache_put(Operation *op, BackendDB *be, struct berval *group, ObjectClass *oc, AttributeDescription *at,
+                     struct berval *op_ndn, struct berval *endn, int res) {
+  group_cache_shard *gcs;
+  group_cache_entry *gce;
+  uint32_t h;
+  char *p;
+
+  if (!group_cache_usable(op))
+    return;
+
+  h = group_cache_key(be, group, oc, at, op_ndn, endn);
+  gcs = &group_cache[h % GROUP_CACHE_SHARDS];
+
+  gce = ch_malloc(sizeof(group_cache_entry) + group->bv_len + op_ndn->bv_len + endn->bv_len + 3);
+  gce->gce_hash = h;
+  gce->gce_gen = op->o_acl_gen;
+  gce->gce_expire = op->o_time + group_cache_ttl;
+  gce->gce_be = be;
+  gce->gce_oc = oc;
+  gce->gce_at = at;
+  gce->gce_res = res;
+  p = (char *)(gce + 1);
+  gce->gce_group.bv_val = p;
+  gce->gce_group.bv_len = group->bv_len;
+  p = lutil_strncopy(p, group->bv_val, group->bv_len);
+  *p++ = '\0';
+  gce->gce_opndn.bv_val = p;
+  gce->gce_opndn.bv_len = op_ndn->bv_len;
+  p = lutil_strncopy(p, op_ndn->bv_val, op_ndn->bv_len);
+  *p++ = '\0';
+  gce->gce_endn.bv_val = p;
+  gce->gce_endn.bv_len = endn->bv_len;
+  p = lutil_strncopy(p, endn->bv_val, endn->bv_len);
+  *p = '\0';
+
+  ldap_pvt_thread_mutex_lock(&gcs->gcs_mutex);
+  if (gce->gce_gen != __atomic_load_n(&acl_cache_gen, __ATOMIC_ACQUIRE)) {
+    ldap_pvt_thread_mutex_unlock(&gcs->gcs_mutex);
+    ch_free(gce);
+    return;
+  }
+  LDAP_LIST_INSERT_HEAD(&gcs->gcs_chain[(h / GROUP_CACHE_SHARDS) % GROUP_CACHE_BUCKETS], gce, gce_chain);
+  LDAP_TAILQ_INSERT_TAIL(&gcs->gcs_lru, gce, gce_lru);
+  gcs->gcs_count++;
+  while (gcs->gcs_count > (group_cache_max + GROUP_CACHE_SHARDS - 1) / GROUP_CACHE_SHARDS)
+    group_cache_evict(gcs, LDAP_TAILQ_FIRST(&gcs->gcs_lru));
+  ldap_pvt_thread_mutex_unlock(&gcs->gcs_mutex);
+}
+
 int fe_acl_group(Operation *op, Entry *target, struct berval *gr_ndn, struct berval *op_ndn, ObjectClass *group_oc,
                  AttributeDescription *group_at) {
   Entry *e;
   void *o_priv = op->o_private, *e_priv = NULL;
   Attribute *a;
-  int rc;
+  int rc, shared = 0;
   GroupAssertion *g;
   Backend *be = op->o_bd;
   OpExtra *oex;
@@ -1309,7 +1566,22 @@ int fe_acl_group(Operation *op, Entry *target, struct berval *gr_ndn, struct ber
     e = target;
     rc = 0;
 
+  } else if (group_cache_get(op, op->o_bd, gr_ndn, group_oc, group_at, op_ndn, (struct berval *)&slap_empty_bv,
+                             &rc)) {
+    goto cache;
+
   } else {
+    shared = 1;
+    /* static groups may be checked without loading all the members */
+    if (!is_at_subtype(group_at->ad_type, slap_schema.si_ad_labeledURI->ad_type)) {
+      rc = be_entry_valfind(op, gr_ndn, group_oc, group_at, op_ndn);
+      if (rc != LDAP_UNAVAILABLE) {
+        if (rc == LDAP_COMPARE_TRUE)
+          rc = 0;
+        goto cache;
+      }
+    }
+
     op->o_private = NULL;
     rc = be_entry_get_rw(op, gr_ndn, group_oc, group_at, 0, &e);
     e_priv = op->o_private;
@@ -1450,6 +1722,11 @@ int fe_acl_group(Operation *op, Entry *target, struct berval *gr_ndn, struct ber
     rc = LDAP_NO_SUCH_OBJECT;
   }
 
+cache:
+  /* shared with the next operations, but not the errors which may not last */
+  if (shared && (rc == 0 || rc == LDAP_COMPARE_FALSE || rc == LDAP_NO_SUCH_OBJECT || rc == LDAP_NO_SUCH_ATTRIBUTE))
+    group_cache_put(op, op->o_bd, gr_ndn, group_oc, group_at, op_ndn, (struct berval *)&slap_empty_bv, rc);
+
   if (op->o_tag != LDAP_REQ_BIND && !op->o_do_not_cache) {
     g = op->o_tmpalloc(sizeof(GroupAssertion) + gr_ndn->bv_len, op->o_tmpmemctx);
     g->ga_be = op->o_bd;
@@ -158,6 +158,9 @@ extern ConfigDriver config_quorum;
 static ConfigDriver config_biglock;
 static ConfigDriver config_reopenldap;
 extern ConfigDriver config_keepalive;
+extern ConfigDriver config_writebatch;
+extern ConfigDriver config_qosclass;
+extern ConfigDriver config_admission;
 
 enum {
   CFG_ACL = 1,
@@ -220,6 +223,7 @@ enum {
   CFG_TLS_CACERT,
   CFG_TLS_CERT,
   CFG_TLS_KEY,
+  CFG_TLS_KTLS,
 
   CFG_LAST
 };
@@ -926,6 +930,16 @@ static ConfigTable config_back_cf_table[] = {
      "EQUALITY caseExactMatch "
      "SYNTAX OMsDirectoryString SINGLE-VALUE )",
      NULL, NULL},
+    {"TLSKTLS", NULL, 2, 2, 0,
+#ifdef WITH_TLS
+     CFG_TLS_KTLS | ARG_STRING | ARG_MAGIC, &config_tls_config,
+#else
+     ARG_IGNORED, NULL,
+#endif
+     "( OLcfgGlAt:0.58 NAME 'olcTLSKTLS' "
+     "EQUALITY caseExactMatch "
+     "SYNTAX OMsDirectoryString SINGLE-VALUE )",
+     NULL, NULL},
     {"TLSCRLFile", NULL, 2, 2, 0,
 #ifdef WITH_TLS
      CFG_TLS_CRL_FILE | ARG_STRING | ARG_MAGIC, &config_tls_option,
@@ -1049,6 +1063,60 @@ static ConfigTable config_back_cf_table[] = {
      "EQUALITY caseIgnoreMatch "
      "SYNTAX OMsDirectoryString SINGLE-VALUE )",
      NULL, NULL},
+    {"writebatch", "size[:msec]", 2, 2, 0, ARG_STRING | ARG_MAGIC, &config_writebatch,
+     "( OLcfgGlAt:0.49 NAME 'olcWriteBatch' "
+     "DESC 'Coalescing of search results' "
+     "EQUALITY caseIgnoreMatch "
+     "SYNTAX OMsDirectoryString SINGLE-VALUE )",
+     NULL, NULL},
+    {"writequeue", "max", 2, 2, 0, ARG_BER_LEN_T, &slap_writequeue_size,
+     "( OLcfgGlAt:0.50 NAME 'olcWriteQueue' "
+     "DESC 'Output queued per connection instead of waiting for a slow reader' "
+     "EQUALITY integerMatch "
+     "SYNTAX OMsInteger SINGLE-VALUE )",
+     NULL, NULL},
+    {"qosclass", "name> <options", 2, 0, 0, ARG_MAGIC | ARG_NO_DELETE | ARG_NO_INSERT, &config_qosclass,
+     "( OLcfgGlAt:0.51 NAME 'olcQosClass' "
+     "DESC 'Operation class with its own share of the thread pool' "
+     "EQUALITY caseIgnoreMatch "
+     "SYNTAX OMsDirectoryString X-ORDERED 'VALUES' )",
+     NULL, NULL},
+    {"admission", "target[:interval]", 2, 2, 0, ARG_STRING | ARG_MAGIC, &config_admission,
+     "( OLcfgGlAt:0.52 NAME 'olcAdmission' "
+     "DESC 'Queue delay target and interval of the admission control, in msec' "
+     "EQUALITY caseIgnoreMatch "
+     "SYNTAX OMsDirectoryString SINGLE-VALUE )",
+     NULL, NULL},
+    {"dnnormcache", "entries", 2, 2, 0, ARG_UINT, &dn_cache_max,
+     "( OLcfgGlAt:0.53 NAME 'olcDnNormCache' "
+     "DESC 'Number of normalized DNs cached, 0 disables the cache' "
+     "EQUALITY integerMatch "
+     "SYNTAX OMsInteger SINGLE-VALUE )",
+     NULL, NULL},
+    {"aclcache", "entries", 2, 2, 0, ARG_UINT, &acl_cache_max,
+     "( OLcfgGlAt:0.54 NAME 'olcAclCache' "
+     "DESC 'Number of access control decisions cached, 0 disables the cache' "
+     "EQUALITY integerMatch "
+     "SYNTAX OMsInteger SINGLE-VALUE )",
+     NULL, NULL},
+    {"groupcache", "entries", 2, 2, 0, ARG_UINT, &group_cache_max,
+     "( OLcfgGlAt:0.55 NAME 'olcGroupCache' "
+     "DESC 'Number of group and set assertions cached, 0 disables the cache' "
+     "EQUALITY integerMatch "
+     "SYNTAX OMsInteger SINGLE-VALUE )",
+     NULL, NULL},
+    {"groupcachettl", "seconds", 2, 2, 0, ARG_UINT, &group_cache_ttl,
+     "( OLcfgGlAt:0.56 NAME 'olcGroupCacheTTL' "
+     "DESC 'Seconds a group or set assertion is cached for at most' "
+     "EQUALITY integerMatch "
+     "SYNTAX OMsInteger SINGLE-VALUE )",
+     NULL, NULL},
+    {"encodecache", "entries", 2, 2, 0, ARG_UINT, &encode_cache_max,
+     "( OLcfgGlAt:0.57 NAME 'olcEncodeCache' "
+     "DESC 'Number of encoded search entries cached, 0 disables the cache' "
+     "EQUALITY integerMatch "
+     "SYNTAX OMsInteger SINGLE-VALUE )",
+     NULL, NULL},
     {NULL, NULL, 0, 0, 0, ARG_IGNORED, NULL, NULL, NULL, NULL}};
 
 /* Need to no-op this keyword for dynamic config */
@@ -1087,17 +1155,18 @@ static ConfigOCs cf_ocs[] = {{"( OLcfgGlOc:0 "
                               "NAME 'olcGlobal' "
                               "DESC 'OpenLDAP Global configuration options' "
                               "SUP olcConfig STRUCTURAL "
-                              "MAY ( cn $ olcConfigFile $ olcConfigDir $ olcAllows $ olcArgsFile $ "
-                              "olcAttributeOptions $ olcAuthIDRewrite $ "
+                              "MAY ( cn $ olcConfigFile $ olcConfigDir $ olcAclCache $ olcAdmission $ "
+                              "olcAllows $ olcArgsFile $ olcAttributeOptions $ olcAuthIDRewrite $ "
                               "olcAuthzPolicy $ olcAuthzRegexp $ olcConcurrency $ "
                               "olcConnMaxPending $ olcConnMaxPendingAuth $ "
-                              "olcDisallows $ olcGentleHUP $ olcIdleTimeout $ "
+                              "olcDisallows $ olcDnNormCache $ olcEncodeCache $ olcGentleHUP $ olcGroupCache $ "
+                              "olcGroupCacheTTL $ olcIdleTimeout $ "
                               "olcIndexSubstrIfMaxLen $ olcIndexSubstrIfMinLen $ "
                               "olcIndexSubstrAnyLen $ olcIndexSubstrAnyStep $ olcIndexHash64 $ "
                               "olcIndexIntLen $ "
                               "olcListenerThreads $ olcLocalSSF $ olcLogFile $ olcLogLevel $ "
                               "olcPasswordCryptSaltFormat $ olcPasswordHash $ olcPidFile $ "
-                              "olcPluginLogFile $ olcReadOnly $ olcReferral $ "
+                              "olcPluginLogFile $ olcQosClass $ olcReadOnly $ olcReferral $ "
                               "olcReplogFile $ olcRequires $ olcRestrict $ olcReverseLookup $ "
                               "olcRootDSE $ "
                               "olcSaslAuxprops $ olcSaslAuxpropsDontUseCopy $ "
@@ -1112,7 +1181,9 @@ static ConfigOCs cf_ocs[] = {{"( OLcfgGlOc:0 "
                               "olcTLSCertificateKeyFile $ olcTLSCipherSuite $ olcTLSCRLCheck $ "
                               "olcTLSCACertificate $ olcTLSCertificate $ olcTLSCertificateKey $ "
                               "olcTLSRandFile $ olcTLSVerifyClient $ olcTLSDHParamFile $ olcTLSECName $ "
-                              "olcTLSCRLFile $ olcTLSProtocolMin $ olcToolThreads $ olcWriteTimeout $ "
+                              "olcTLSCRLFile $ olcTLSKTLS $ olcTLSProtocolMin $ olcToolThreads $ "
+                              "olcWriteBatch $ olcWriteQueue $ "
+                              "olcWriteTimeout $ "
                               "olcObjectIdentifier $ olcAttributeTypes $ olcObjectClasses $ "
                               "olcCrashBacktrace $ olcMemoryLimit $ olcCoredumpLimit $ olcReOpenLDAP $ "
                               "olcDitContentRules $ olcLdapSyntaxes ) )",
@@ -1715,6 +1786,8 @@ static int config_generic(ConfigArgs *c) {
         a = *prev;
         *prev = a->acl_next;
         acl_free(a);
+        if (c->be->be_acl)
+          acl_index_build(c->be->be_acl);
       }
       if (SLAP_CONFIG(c->be) && !c->be->be_acl) {
         Debug(LDAP_DEBUG_CONFIG, "config_generic (CFG_ACL): "
@@ -4424,6 +4497,9 @@ static int config_tls_config(ConfigArgs *c) {
   case CFG_TLS_PROTOCOL_MIN:
     flag = LDAP_OPT_X_TLS_PROTOCOL_MIN;
     break;
+  case CFG_TLS_KTLS:
+    flag = LDAP_OPT_X_TLS_KTLS;
+    break;
   default:
     Debug(LDAP_DEBUG_ANY,
           "%s: "
@@ -172,7 +172,10 @@ int do_bind(Operation *op, SlapReply *rs) {
   op->orb_mech = mech;
 
   op->o_bd = frontendDB;
+  slap_op_stamp(op, SLAP_STAMP_BACKEND);
   rs->sr_err = frontendDB->be_bind(op, rs);
+  if (rs->sr_err != SLAPD_ASYNCOP)
+    slap_op_stamp(op, SLAP_STAMP_BACKEND_DONE);
 
 cleanup:
   if (rs->sr_err == LDAP_SUCCESS) {
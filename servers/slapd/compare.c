@@ -95,7 +95,10 @@ int do_compare(Operation *op, SlapReply *rs) {
         ava.aa_desc->ad_cname.bv_val, ava.aa_value.bv_val);
 
   op->o_bd = frontendDB;
+  slap_op_stamp(op, SLAP_STAMP_BACKEND);
   rs->sr_err = frontendDB->be_compare(op, rs);
+  if (rs->sr_err != SLAPD_ASYNCOP)
+    slap_op_stamp(op, SLAP_STAMP_BACKEND_DONE);
   if (rs->sr_err == SLAPD_ASYNCOP) {
     /* skip cleanup */
     return rs->sr_err;
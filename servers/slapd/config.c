@@ -1250,6 +1250,8 @@ static slap_verbmasks vfykeys[] = {{BER_BVC("never"), LDAP_OPT_X_TLS_NEVER},
                                    {BER_BVC("hard"), LDAP_OPT_X_TLS_HARD},
                                    {BER_BVC("true"), LDAP_OPT_X_TLS_HARD},
                                    {BER_BVNULL, 0}};
+
+static slap_verbmasks ktlskeys[] = {{BER_BVC("off"), 0}, {BER_BVC("on"), 1}, {BER_BVNULL, 0}};
 #endif
 
 static slap_verbmasks methkey[] = {{BER_BVC("none"), LDAP_AUTH_NONE},
@@ -1626,6 +1628,9 @@ int slap_tls_get_config(LDAP *ld, int opt, char **val) {
   case LDAP_OPT_X_TLS_REQUIRE_CERT:
     keys = vfykeys;
     break;
+  case LDAP_OPT_X_TLS_KTLS:
+    keys = ktlskeys;
+    break;
   case LDAP_OPT_X_TLS_PROTOCOL_MIN: {
     char buf[8];
     ldap_pvt_tls_get_option(ld, opt, &ival);
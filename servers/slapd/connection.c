@@ -80,9 +80,11 @@ static void connection_close(Connection *c);
 
 static int connection_op_activate(Operation *op);
 static void connection_op_queue(Operation *op);
+static void connection_qos_release(QosClass *qc);
 static int connection_resched(Connection *conn);
 static void connection_abandon(Connection *conn);
 static void connection_destroy(Connection *c);
+static void connection_timeout(slap_timer_t *t);
 
 static ldap_pvt_thread_start_t connection_operation;
 
@@ -116,8 +118,11 @@ int connections_init(void) {
   assert(connections[0].c_struct_state == SLAP_C_UNINITIALIZED);
   assert(connections[dtblsize - 1].c_struct_state == SLAP_C_UNINITIALIZED);
 
-  for (i = 0; i < dtblsize; i++)
+  for (i = 0; i < dtblsize; i++) {
     connections[i].c_conn_idx = i;
+    connections[i].c_timer.st_func = connection_timeout;
+    connections[i].c_wbatch_timer.st_func = slap_writebatch_timeout;
+  }
 
   /*
    * per entry initialization of the Connection array initialization
@@ -144,6 +149,8 @@ int connections_destroy(void) {
   for (i = 0; i < dtblsize; i++) {
     if (connections[i].c_struct_state != SLAP_C_UNINITIALIZED) {
       ber_sockbuf_free(connections[i].c_sb);
+      if (connections[i].c_wbatch)
+        ber_free(connections[i].c_wbatch, 1);
       ldap_pvt_thread_mutex_destroy(&connections[i].c_mutex);
       ldap_pvt_thread_mutex_destroy(&connections[i].c_write1_mutex);
       ldap_pvt_thread_cond_destroy(&connections[i].c_write1_cv);
@@ -206,56 +213,74 @@ int connections_shutdown(int gentle_shutdown_only) {
   return 0;
 }
 
+/* Arm the timer of the connection for the nearest of its timeouts,
+ * counted from the last activity.  The activity itself doesn't touch
+ * the timer, it is re-armed lazily when it fires too early. */
+void connection_timer_arm(Connection *c) {
+  slap_time_t when = {0};
+
+  if (c->c_conn_state == SLAP_C_CLIENT)
+    return;
+  if (global_idletimeout > 0)
+    when.ns = c->c_activitytime.ns + ldap_from_seconds(global_idletimeout).ns;
+  if (c->c_wqueued && global_writetimeout > 0) {
+    uint64_t w = c->c_activitytime.ns + ldap_from_seconds(global_writetimeout).ns;
+    if (!when.ns || when.ns > w)
+      when.ns = w;
+  }
+  if (when.ns)
+    slap_timer_arm(&c->c_timer, when);
+}
+
 /*
  * Timeout idle connections.
  */
-int connections_timeout_idle(slap_time_t now) {
-  int i = 0;
-  ber_socket_t connindex;
-  Connection *c;
+static void connection_timeout(slap_timer_t *t) {
+  Connection *c = (Connection *)((char *)t - offsetof(Connection, c_timer));
+  slap_time_t now = ldap_now_steady();
 
-#ifdef SLAPD_WRITE_TIMEOUT
-  int writers = 0;
-  slap_time_t old = slapd_get_writetime();
-#endif /* SLAPD_WRITE_TIMEOUT */
-
-  for (c = connection_first(&connindex); c != NULL; c = connection_next(c, &connindex)) {
-    /* Don't timeout a slow-running request or a persistent
-     * outbound connection.
-     */
-    if ((c->c_n_ops_executing && !c->c_writewaiter) || c->c_conn_state == SLAP_C_CLIENT) {
-      continue;
-    }
+  ldap_pvt_thread_mutex_lock(&c->c_mutex);
+  /* Don't timeout a persistent outbound connection. */
+  if (c->c_struct_state != SLAP_C_USED || c->c_conn_state == SLAP_C_CLIENT) {
+    ldap_pvt_thread_mutex_unlock(&c->c_mutex);
+    return;
+  }
 
-    if (global_idletimeout && now.ns > c->c_activitytime.ns &&
-        now.ns - c->c_activitytime.ns > ldap_from_seconds(global_idletimeout).ns) {
-      /* close it */
-      connection_closing(c, "idletimeout");
-      connection_close(c);
-      i++;
-      continue;
-    }
-#ifdef SLAPD_WRITE_TIMEOUT
-    if (c->c_writewaiter && global_writetimeout) {
-      writers = 1;
-      if (now.ns > c->c_activitytime.ns && now.ns - c->c_activitytime.ns > ldap_from_seconds(global_writetimeout).ns) {
-        /* close it */
-        connection_closing(c, "writetimeout");
-        connection_close(c);
-        i++;
-        continue;
-      }
+  if (c->c_n_ops_executing && !c->c_writewaiter) {
+    /* Don't timeout a slow-running request, look again later. */
+    slap_time_t later = ldap_from_seconds(global_idletimeout > 0 ? global_idletimeout : global_writetimeout);
+    if (later.ns) {
+      later.ns += now.ns;
+      slap_timer_arm(t, later);
     }
-#endif /* SLAPD_WRITE_TIMEOUT */
+  } else if (global_idletimeout > 0 && now.ns > c->c_activitytime.ns &&
+             now.ns - c->c_activitytime.ns > ldap_from_seconds(global_idletimeout).ns) {
+    /* close it */
+    connection_closing(c, "idletimeout");
+    connection_close(c);
+  } else if (c->c_wqueued && global_writetimeout > 0 && now.ns > c->c_activitytime.ns &&
+             now.ns - c->c_activitytime.ns > ldap_from_seconds(global_writetimeout).ns) {
+    /* the client does not read the queued output */
+    connection_closing(c, "writetimeout");
+    connection_close(c);
+  } else {
+    connection_timer_arm(c);
   }
-  connection_done(c);
+  ldap_pvt_thread_mutex_unlock(&c->c_mutex);
+}
 
-#ifdef SLAPD_WRITE_TIMEOUT
-  if (old.ns && !writers)
-    slapd_clr_writetime(old);
-#endif /* SLAPD_WRITE_TIMEOUT */
+/* (Re)arm the timers of all connections after the timeouts were changed */
+void connections_timeout_arm(void) {
+  ber_socket_t connindex;
+  Connection *c;
 
-  return i;
+  for (c = connection_first(&connindex); c != NULL; c = connection_next(c, &connindex)) {
+    if (global_idletimeout > 0 || global_writetimeout > 0)
+      connection_timer_arm(c);
+    else
+      slap_timer_disarm(&c->c_timer);
+  }
+  connection_done(c);
 }
 
 /* Drop all client connections */
@@ -555,9 +580,10 @@ Connection *connection_init(const ber_socket_t s, Listener *listener, const char
   slap_sasl_open(c, 0);
   slap_sasl_external(c, ssf, authid);
 
-  slapd_add_internal(s, 1);
+  slapd_add_internal(s, 1, listener);
 
   backend_connection_init(c);
+  connection_timer_arm(c);
   ldap_pvt_thread_mutex_unlock(&c->c_mutex);
 
   if (!(flags & CONN_IS_UDP))
@@ -636,6 +662,8 @@ static void connection_destroy(Connection *c) {
   c->c_connid = -1;
 
   c->c_activitytime.ns = c->c_starttime.ns = 0;
+  slap_timer_disarm(&c->c_timer);
+  slap_timer_disarm(&c->c_wbatch_timer);
 
   connection2anonymous(c);
   c->c_listener = NULL;
@@ -661,6 +689,13 @@ static void connection_destroy(Connection *c) {
     ber_free(c->c_currentber, 1);
     c->c_currentber = NULL;
   }
+  if (c->c_wbatch != NULL) {
+    ber_free(c->c_wbatch, 1);
+    c->c_wbatch = NULL;
+  }
+  c->c_wbatch_bytes = 0;
+  c->c_wbatch_pdus = c->c_wbatch_entries = c->c_wbatch_refs = 0;
+  c->c_wqueued = 0;
 
 #ifdef LDAP_SLAPI
   /* call destructors, then constructors; avoids unnecessary allocation */
@@ -947,19 +982,15 @@ void connection_done(Connection *c) {
  */
 
 #ifdef SLAPD_MONITOR
-/* FIXME: returns 0 in case of failure */
 #define INCR_OP_INITIATED(index)                                                                                       \
   do {                                                                                                                 \
-    ldap_pvt_thread_mutex_lock(&op->o_counters->sc_mutex);                                                             \
-    ldap_pvt_mp_add_ulong(op->o_counters->sc_ops_initiated_[(index)], 1);                                              \
-    ldap_pvt_thread_mutex_unlock(&op->o_counters->sc_mutex);                                                           \
+    slap_counter_add(op->o_counters->sc_ops_initiated_[(index)], 1);                                                   \
   } while (0)
 #define INCR_OP_COMPLETED(index)                                                                                       \
   do {                                                                                                                 \
-    ldap_pvt_thread_mutex_lock(&op->o_counters->sc_mutex);                                                             \
-    ldap_pvt_mp_add_ulong(op->o_counters->sc_ops_completed, 1);                                                        \
-    ldap_pvt_mp_add_ulong(op->o_counters->sc_ops_completed_[(index)], 1);                                              \
-    ldap_pvt_thread_mutex_unlock(&op->o_counters->sc_mutex);                                                           \
+    slap_counter_add(op->o_counters->sc_ops_completed, 1);                                                             \
+    slap_counter_add(op->o_counters->sc_ops_completed_[(index)], 1);                                                   \
+    slap_op_latency(op, (index));                                                                                      \
   } while (0)
 #else /* !SLAPD_MONITOR */
 #define INCR_OP_INITIATED(index)                                                                                       \
@@ -967,9 +998,7 @@ void connection_done(Connection *c) {
   } while (0)
 #define INCR_OP_COMPLETED(index)                                                                                       \
   do {                                                                                                                 \
-    ldap_pvt_thread_mutex_lock(&op->o_counters->sc_mutex);                                                             \
-    ldap_pvt_mp_add_ulong(op->o_counters->sc_ops_completed, 1);                                                        \
-    ldap_pvt_thread_mutex_unlock(&op->o_counters->sc_mutex);                                                           \
+    slap_counter_add(op->o_counters->sc_ops_completed, 1);                                                             \
   } while (0)
 #endif /* !SLAPD_MONITOR */
 
@@ -987,24 +1016,11 @@ static void conn_counter_destroy(void *key, void *data) {
   ldap_pvt_thread_mutex_lock(&slap_counters.sc_mutex);
   for (prev = &slap_counters.sc_next, sc = slap_counters.sc_next; sc; prev = &sc->sc_next, sc = sc->sc_next) {
     if (sc == data) {
-      int i;
-
       *prev = sc->sc_next;
       /* Copy data to main counter */
-      ldap_pvt_mp_add(slap_counters.sc_bytes, sc->sc_bytes);
-      ldap_pvt_mp_add(slap_counters.sc_pdu, sc->sc_pdu);
-      ldap_pvt_mp_add(slap_counters.sc_entries, sc->sc_entries);
-      ldap_pvt_mp_add(slap_counters.sc_refs, sc->sc_refs);
-      ldap_pvt_mp_add(slap_counters.sc_ops_initiated, sc->sc_ops_initiated);
-      ldap_pvt_mp_add(slap_counters.sc_ops_completed, sc->sc_ops_completed);
-#ifdef SLAPD_MONITOR
-      for (i = 0; i < SLAP_OP_LAST; i++) {
-        ldap_pvt_mp_add(slap_counters.sc_ops_initiated_[i], sc->sc_ops_initiated_[i]);
-        ldap_pvt_mp_add(slap_counters.sc_ops_initiated_[i], sc->sc_ops_completed_[i]);
-      }
-#endif /* SLAPD_MONITOR */
+      slap_counters_merge(&slap_counters, sc);
       slap_counters_destroy(sc);
-      ber_memfree_x(data, NULL);
+      ber_memfree_x(sc->sc_free, NULL);
       break;
     }
   }
@@ -1016,9 +1032,11 @@ static void conn_counter_init(Operation *op, void *ctx) {
   void *vsc = NULL;
 
   if (ldap_pvt_thread_pool_getkey(ctx, (void *)conn_counter_init, &vsc, NULL) || !vsc) {
-    vsc = ch_malloc(sizeof(slap_counters_t));
+    char *ptr = ch_malloc(sizeof(slap_counters_t) + CACHELINE_SIZE - 1);
+    vsc = (void *)(((size_t)ptr + CACHELINE_SIZE - 1) & ~(size_t)(CACHELINE_SIZE - 1));
     sc = vsc;
     slap_counters_init(sc);
+    sc->sc_free = ptr;
     ldap_pvt_thread_pool_setkey(ctx, (void *)conn_counter_init, vsc, conn_counter_destroy, NULL, NULL);
 
     ldap_pvt_thread_mutex_lock(&slap_counters.sc_mutex);
@@ -1059,15 +1077,14 @@ static void *connection_operation(void *ctx, void *arg_v) {
   ber_tag_t tag = op->o_tag;
   slap_op_t opidx = SLAP_OP_LAST;
   Connection *conn = op->o_conn;
+  QosClass *qos = op->o_qos;
   void *memctx = NULL;
   void *memctx_null = NULL;
   ber_len_t memsiz;
 
+  slap_op_stamp(op, SLAP_STAMP_STARTED);
   conn_counter_init(op, ctx);
-  ldap_pvt_thread_mutex_lock(&op->o_counters->sc_mutex);
-  /* FIXME: returns 0 in case of failure */
-  ldap_pvt_mp_add_ulong(op->o_counters->sc_ops_initiated, 1);
-  ldap_pvt_thread_mutex_unlock(&op->o_counters->sc_mutex);
+  slap_counter_add(op->o_counters->sc_ops_initiated, 1);
 
   op->o_threadctx = ctx;
   op->o_tid = ldap_pvt_thread_pool_tid(ctx);
@@ -1141,6 +1158,11 @@ static void *connection_operation(void *ctx, void *arg_v) {
   opidx = slap_req2op(tag);
   assert(opidx != SLAP_OP_LAST);
   INCR_OP_INITIATED(opidx);
+  if (slap_admission_target && tag != LDAP_REQ_UNBIND && tag != LDAP_REQ_ABANDON && slap_admission_check(op)) {
+    send_ldap_error(op, &rs, LDAP_BUSY, "server is overloaded");
+    rc = LDAP_BUSY;
+    goto operations_error;
+  }
   rc = (*(opfun[opidx]))(op, &rs);
 
 operations_error:
@@ -1156,6 +1178,8 @@ operations_error:
     ldap_pvt_thread_mutex_lock(&conn->c_mutex);
     connection_resched(conn);
     ldap_pvt_thread_mutex_unlock(&conn->c_mutex);
+    if (qos)
+      connection_qos_release(qos);
     return NULL;
 
   } else if (opidx != SLAP_OP_LAST) {
@@ -1218,6 +1242,8 @@ operations_error:
   {
     slap_op_free(op, ctx);
   }
+  if (qos)
+    connection_qos_release(qos);
   return NULL;
 }
 
@@ -1230,7 +1256,7 @@ Connection *connection_client_setup(const ber_socket_t s, ldap_pvt_thread_start_
   if (c) {
     c->c_clientfunc = func;
     c->c_clientarg = arg;
-    slapd_add_internal(s, 0);
+    slapd_add_internal(s, 0, NULL);
   }
   return c;
 }
@@ -1310,6 +1336,8 @@ int connection_read_activate(ber_socket_t s) {
   if (rc)
     return rc;
 
+  /* the time a request waits for the read task counts as queued too */
+  connections[s].c_readable = slap_stamp_now();
   rc = ldap_pvt_thread_pool_submit(&connection_pool, connection_read_thread, (void *)(long)s);
 
   if (rc != 0) {
@@ -1602,6 +1630,10 @@ static int connection_input(Connection *conn, conn_readinfo *cri) {
 
   ctx = cri->ctx;
   op = slap_op_alloc(ber, msgid, tag, conn->c_n_ops_received++, ctx);
+  if (conn->c_readable) {
+    op->o_stamp[SLAP_STAMP_READ] = conn->c_readable;
+    conn->c_readable = 0;
+  }
 
   Debug(LDAP_DEBUG_TRACE, "op tag 0x%lx, time %ld\n", tag, (long)op->o_time);
 
@@ -1693,15 +1725,18 @@ static int connection_input(Connection *conn, conn_readinfo *cri) {
      * The first op will be processed in the same thread context,
      * as long as there is only one op total.
      * Subsequent ops will be submitted to the pool by
-     * calling connection_op_activate()
+     * calling connection_op_activate(), as are all ops
+     * once QoS classes are configured.
      */
-    if (cri->op == NULL) {
+    if (cri->op == NULL && !slap_qos_classes) {
       /* the first incoming request */
       connection_op_queue(op);
+      slap_op_stamp(op, SLAP_STAMP_QUEUED);
       cri->op = op;
     } else {
-      if (!cri->nullop) {
+      if (cri->op && !cri->nullop) {
         cri->nullop = 1;
+        slap_op_stamp(cri->op, SLAP_STAMP_QUEUED);
         rc = ldap_pvt_thread_pool_submit(&connection_pool, connection_operation, (void *)cri->op);
       }
       connection_op_activate(op);
@@ -1870,16 +1905,38 @@ static void connection_op_queue(Operation *op) {
   LDAP_STAILQ_INSERT_TAIL(&op->o_conn->c_ops, op, o_next);
 }
 
+/* Submit the operations the QoS scheduler hands out once a slot
+ * of class qc is given back. */
+static void connection_qos_release(QosClass *qc) {
+  Operation *op;
+
+  while ((op = slap_qos_next(qc)) != NULL) {
+    qc = NULL;
+    slap_op_stamp(op, SLAP_STAMP_QUEUED);
+    if (ldap_pvt_thread_pool_submit(&connection_pool, connection_operation, (void *)op) != 0) {
+      Debug(LDAP_DEBUG_ANY, "connection_qos_release: submit failed for conn=%lu\n", op->o_connid);
+      qc = op->o_qos;
+    }
+  }
+}
+
 static int connection_op_activate(Operation *op) {
   int rc;
 
   connection_op_queue(op);
 
+  /* the QoS scheduler keeps it until its class gets a slot */
+  if (slap_qos_classes && !slap_qos_admit(op))
+    return 0;
+
+  slap_op_stamp(op, SLAP_STAMP_QUEUED);
   rc = ldap_pvt_thread_pool_submit(&connection_pool, connection_operation, (void *)op);
 
   if (rc != 0) {
     Debug(LDAP_DEBUG_ANY, "connection_op_activate: submit failed (%d) for conn=%lu\n", rc, op->o_connid);
     /* should move op to pending list */
+    if (op->o_qos)
+      connection_qos_release(op->o_qos);
   }
 
   return rc;
@@ -1912,7 +1969,18 @@ int connection_write(ber_socket_t s) {
 
   Debug(LDAP_DEBUG_TRACE, "connection_write(%d): waking output for id=%lu\n", s, c->c_connid);
 
-  wantwrite = ber_sockbuf_ctrl(c->c_sb, LBER_SB_OPT_NEEDS_WRITE, NULL);
+  wantwrite = 0;
+  if (c->c_wqueued) {
+    wantwrite = slap_writequeue_drain(c);
+    if (wantwrite < 0) {
+      connection_closing(c, "connection lost on write");
+      connection_close(c);
+      connection_return(c);
+      return 0;
+    }
+  }
+
+  wantwrite |= ber_sockbuf_ctrl(c->c_sb, LBER_SB_OPT_NEEDS_WRITE, NULL);
   if (ber_sockbuf_ctrl(c->c_sb, LBER_SB_OPT_NEEDS_READ, NULL)) {
     /* don't wakeup twice */
     slapd_set_read(s, !wantwrite);
@@ -42,6 +42,14 @@
 
 #if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_EPOLL)
 #include <sys/epoll.h>
+#if defined(HAVE_LINUX_IO_URING_H)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(IORING_ASYNC_CANCEL_FD_FIXED)
+#define SLAP_IOURING 1
+#endif
+#endif /* HAVE_LINUX_IO_URING_H */
 #elif defined(SLAP_X_DEVPOLL) && defined(HAVE_SYS_DEVPOLL_H) && defined(HAVE_DEVPOLL)
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -81,6 +89,8 @@ struct {
 #endif
 int slapd_daemon_threads = 1;
 int slapd_daemon_mask;
+int slapd_event_engine = SLAPD_EVENT_DEFAULT;
+int slapd_reuseport;
 
 #ifdef LDAP_TCP_BUFFER
 int slapd_tcp_rmem;
@@ -88,6 +98,7 @@ int slapd_tcp_wmem;
 #endif /* LDAP_TCP_BUFFER */
 
 Listener **slap_listeners = NULL;
+static Listener **slap_listeners_urls; /* configured ones, w/o SO_REUSEPORT shards */
 static volatile sig_atomic_t listening = 1; /* 0 when slap_listeners closed */
 static ldap_pvt_thread_t *listener_tid;
 
@@ -95,15 +106,16 @@ static ldap_pvt_thread_t *listener_tid;
 #define SLAPD_LISTEN_BACKLOG 1024
 #endif /* ! SLAPD_LISTEN_BACKLOG */
 
-#define DAEMON_ID(fd) (fd & slapd_daemon_mask)
+/* Descriptors are spread over the listener threads by their number,
+ * except for the SO_REUSEPORT shards which are served by the thread
+ * which accepted them. The owner is recorded by slapd_add(). */
+#define DAEMON_HASH(fd) ((fd) & slapd_daemon_mask)
+#define DAEMON_ID(fd) (sd_owner[fd])
+static unsigned char *sd_owner;
 
 static ber_socket_t wake_sds[SLAPD_MAX_DAEMON_THREADS][2];
 static int emfile;
 
-#ifdef SLAPD_WRITE_TIMEOUT
-static slap_time_t chk_writetime;
-#endif /* SLAPD_WRITE_TIMEOUT */
-
 static volatile int waking;
 #ifdef NO_THREADS
 #define WAKE_LISTENER(l, w)                                                                                            \
@@ -172,6 +184,9 @@ typedef struct slap_daemon_st {
   struct epoll_event *sd_epolls;
   int *sd_index;
   int sd_epfd;
+#ifdef SLAP_IOURING
+  struct slap_uring *sd_uring; /* NULL unless io_uring is in use */
+#endif                         /* SLAP_IOURING */
 #elif defined(SLAP_X_DEVPOLL) && defined(HAVE_DEVPOLL)
   /* eXperimental */
   struct pollfd *sd_pollfd;
@@ -204,6 +219,28 @@ static slap_daemon_st slap_daemon[SLAPD_MAX_DAEMON_THREADS];
  ***************************************/
 #define SLAP_EVENT_FNAME "epoll"
 #define SLAP_EVENTS_ARE_INDEXED 0
+
+#ifdef SLAP_IOURING
+/* The io_uring engine reuses the epoll bookkeeping below and only
+ * replaces the system calls, per daemon thread. */
+static int slap_uring_init(int t);
+static void slap_uring_destroy(int t);
+static int slap_uring_ctl(int t, int op, ber_socket_t s, struct epoll_event *ep);
+static int slap_uring_wait(int t, struct epoll_event *revents, int maxevents, int timeout);
+
+#define SLAP_EPOLL_CTL(t, op, s, ep)                                                                                   \
+  (slap_daemon[t].sd_uring ? slap_uring_ctl(t, op, s, ep) : epoll_ctl(slap_daemon[t].sd_epfd, op, s, ep))
+#define SLAP_EPOLL_WAIT(t, ev, n, ms)                                                                                  \
+  (slap_daemon[t].sd_uring ? slap_uring_wait(t, ev, n, ms) : epoll_wait(slap_daemon[t].sd_epfd, ev, n, ms))
+#define SLAP_IOURING_INIT(t) slap_uring_init(t)
+#define SLAP_IOURING_DESTROY(t) slap_uring_destroy(t)
+#else
+#define SLAP_EPOLL_CTL(t, op, s, ep) epoll_ctl(slap_daemon[t].sd_epfd, op, s, ep)
+#define SLAP_EPOLL_WAIT(t, ev, n, ms) epoll_wait(slap_daemon[t].sd_epfd, ev, n, ms)
+#define SLAP_IOURING_INIT(t) (-1)
+#define SLAP_IOURING_DESTROY(t)
+#endif /* SLAP_IOURING */
+
 #define SLAP_EPOLL_SOCK_IX(t, s) (slap_daemon[t].sd_index[(s)])
 #define SLAP_EPOLL_SOCK_EP(t, s) (slap_daemon[t].sd_epolls[SLAP_EPOLL_SOCK_IX(t, s)])
 #define SLAP_EPOLL_SOCK_EV(t, s) (SLAP_EPOLL_SOCK_EP(t, s).events)
@@ -218,7 +255,7 @@ static slap_daemon_st slap_daemon[SLAPD_MAX_DAEMON_THREADS];
   do {                                                                                                                 \
     if ((SLAP_EPOLL_SOCK_EV(t, s) & (mode)) != (mode)) {                                                               \
       SLAP_EPOLL_SOCK_EV(t, s) |= (mode);                                                                              \
-      epoll_ctl(slap_daemon[t].sd_epfd, EPOLL_CTL_MOD, (s), &SLAP_EPOLL_SOCK_EP(t, s));                                \
+      SLAP_EPOLL_CTL(t, EPOLL_CTL_MOD, (s), &SLAP_EPOLL_SOCK_EP(t, s));                                                \
     }                                                                                                                  \
   } while (0)
 
@@ -226,7 +263,7 @@ static slap_daemon_st slap_daemon[SLAPD_MAX_DAEMON_THREADS];
   do {                                                                                                                 \
     if ((SLAP_EPOLL_SOCK_EV(t, s) & (mode))) {                                                                         \
       SLAP_EPOLL_SOCK_EV(t, s) &= ~(mode);                                                                             \
-      epoll_ctl(slap_daemon[t].sd_epfd, EPOLL_CTL_MOD, s, &SLAP_EPOLL_SOCK_EP(t, s));                                  \
+      SLAP_EPOLL_CTL(t, EPOLL_CTL_MOD, s, &SLAP_EPOLL_SOCK_EP(t, s));                                                  \
     }                                                                                                                  \
   } while (0)
 
@@ -255,7 +292,7 @@ static slap_daemon_st slap_daemon[SLAPD_MAX_DAEMON_THREADS];
     SLAP_EPOLL_SOCK_IX(t, (s)) = slap_daemon[t].sd_nfds;                                                               \
     SLAP_EPOLL_SOCK_EP(t, (s)).data.ptr = (l) ? (l) : (void *)(&SLAP_EPOLL_SOCK_IX(t, s));                             \
     SLAP_EPOLL_SOCK_EV(t, (s)) = EPOLLIN;                                                                              \
-    rc = epoll_ctl(slap_daemon[t].sd_epfd, EPOLL_CTL_ADD, (s), &SLAP_EPOLL_SOCK_EP(t, (s)));                           \
+    rc = SLAP_EPOLL_CTL(t, EPOLL_CTL_ADD, (s), &SLAP_EPOLL_SOCK_EP(t, (s)));                                           \
     if (rc == 0) {                                                                                                     \
       slap_daemon[t].sd_nfds++;                                                                                        \
     } else {                                                                                                           \
@@ -275,7 +312,7 @@ static slap_daemon_st slap_daemon[SLAPD_MAX_DAEMON_THREADS];
     int fd, rc, index = SLAP_EPOLL_SOCK_IX(t, (s));                                                                    \
     if (index < 0)                                                                                                     \
       break;                                                                                                           \
-    rc = epoll_ctl(slap_daemon[t].sd_epfd, EPOLL_CTL_DEL, (s), &SLAP_EPOLL_SOCK_EP(t, (s)));                           \
+    rc = SLAP_EPOLL_CTL(t, EPOLL_CTL_DEL, (s), &SLAP_EPOLL_SOCK_EP(t, (s)));                                           \
     if (rc) {                                                                                                          \
       Debug(LDAP_DEBUG_ANY,                                                                                            \
             "daemon: epoll_ctl(epfd=%d,DEL,fd=%d) failed, errno=%d, shutting "                                         \
@@ -309,7 +346,9 @@ static slap_daemon_st slap_daemon[SLAPD_MAX_DAEMON_THREADS];
     int j;                                                                                                             \
     slap_daemon[t].sd_epolls = ch_calloc(1, (sizeof(struct epoll_event) * 2 + sizeof(int)) * dtblsize * 2);            \
     slap_daemon[t].sd_index = (int *)&slap_daemon[t].sd_epolls[2 * dtblsize];                                          \
-    slap_daemon[t].sd_epfd = epoll_create(dtblsize / slapd_daemon_threads);                                            \
+    slap_daemon[t].sd_epfd = -1;                                                                                       \
+    if (slapd_event_engine != SLAPD_EVENT_IOURING || SLAP_IOURING_INIT(t) != 0)                                        \
+      slap_daemon[t].sd_epfd = epoll_create(dtblsize / slapd_daemon_threads);                                          \
     for (j = 0; j < dtblsize; j++)                                                                                     \
       slap_daemon[t].sd_index[j] = -1;                                                                                 \
   } while (0)
@@ -320,7 +359,9 @@ static slap_daemon_st slap_daemon[SLAPD_MAX_DAEMON_THREADS];
       ch_free(slap_daemon[t].sd_epolls);                                                                               \
       slap_daemon[t].sd_epolls = NULL;                                                                                 \
       slap_daemon[t].sd_index = NULL;                                                                                  \
-      close(slap_daemon[t].sd_epfd);                                                                                   \
+      SLAP_IOURING_DESTROY(t);                                                                                         \
+      if (slap_daemon[t].sd_epfd >= 0)                                                                                 \
+        close(slap_daemon[t].sd_epfd);                                                                                 \
     }                                                                                                                  \
   } while (0)
 
@@ -333,7 +374,7 @@ static slap_daemon_st slap_daemon[SLAPD_MAX_DAEMON_THREADS];
 
 #define SLAP_EVENT_WAIT(t, tvp, nsp)                                                                                   \
   do {                                                                                                                 \
-    *(nsp) = epoll_wait(slap_daemon[t].sd_epfd, revents, dtblsize, (tvp) ? ldap_to_milliseconds(*tvp) : -1);           \
+    *(nsp) = SLAP_EPOLL_WAIT(t, revents, dtblsize, (tvp) ? ldap_to_milliseconds(*tvp) : -1);                           \
   } while (0)
 
 #elif defined(SLAP_X_DEVPOLL) && defined(HAVE_DEVPOLL)
@@ -613,6 +654,383 @@ static slap_daemon_st slap_daemon[SLAPD_MAX_DAEMON_THREADS];
   } while (0)
 #endif /* ! epoll && ! /dev/poll */
 
+#ifdef SLAP_IOURING
+/*
+ * io_uring engine, eXperimental, see "-o event=io_uring".
+ *
+ * Each descriptor is watched by a single multishot IORING_OP_POLL_ADD,
+ * whose mask is later updated in place by IORING_OP_POLL_REMOVE with
+ * IORING_POLL_UPDATE_EVENTS. The interest changes made by the daemon
+ * thread itself (e.g. while activating a read) are just queued and go to
+ * the kernel together with the wait, by the same io_uring_enter(). Changes
+ * made by the pool threads are submitted at once, because the daemon thread
+ * may be sleeping in the kernel.
+ *
+ * Poll requests are always armed by the daemon thread, since io_uring runs
+ * their completion on behalf of the submitter, and a pool thread may exit.
+ * Removal is done by IORING_REGISTER_SYNC_CANCEL, so the kernel drops its
+ * file reference before the descriptor is closed.
+ *
+ * The user_data carries the descriptor and a generation number, which is
+ * bumped on every change, so the stale completions are just skipped.
+ * Unlike epoll, a multishot poll posts a completion per wakeup, therefore
+ * these are merged per descriptor, and the readiness may be stale, i.e. all
+ * the descriptors must be non-blocking.
+ */
+#define SLAP_URING_SQ_ENTRIES 256
+#define SLAP_URING_CTL 0x80000000u
+#define SLAP_URING_UD(gen, fd, ctl) (((uint64_t)(gen) << 32) | (ctl) | (uint32_t)(fd))
+
+#define SLAP_URING_IDLE 0    /* no poll armed */
+#define SLAP_URING_PENDING 1 /* queued to be armed by the daemon thread */
+#define SLAP_URING_ARMED 2
+
+typedef struct slap_uring_sock {
+  uint32_t us_gen;
+  uint32_t us_state;
+  uint32_t us_batch; /* the last wait reported this descriptor within */
+  int us_slot;       /* index of revents[] */
+} slap_uring_sock;
+
+typedef struct slap_uring {
+  int ur_fd;
+  unsigned ur_sq_entries;
+  unsigned *ur_sq_head;
+  unsigned *ur_sq_tail;
+  unsigned *ur_sq_mask;
+  unsigned *ur_sq_array;
+  struct io_uring_sqe *ur_sqes;
+  unsigned *ur_cq_head;
+  unsigned *ur_cq_tail;
+  unsigned *ur_cq_mask;
+  struct io_uring_cqe *ur_cqes;
+  void *ur_ring;
+  size_t ur_ring_size;
+  size_t ur_sqes_size;
+  slap_uring_sock *ur_socks;
+  ber_socket_t *ur_adds; /* descriptors waiting to be armed */
+  int ur_nadds;
+  uint32_t ur_batch;
+} slap_uring;
+
+/* the daemon thread index, -1 in other threads */
+static __thread int slap_uring_self = -1;
+
+static int slap_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void *arg,
+                            size_t argsz) {
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static unsigned slap_uring_sq_pending(slap_uring *ur) {
+  return *ur->ur_sq_tail - __atomic_load_n(ur->ur_sq_head, __ATOMIC_ACQUIRE);
+}
+
+static int slap_uring_submit(slap_uring *ur) {
+  int rc;
+
+  do
+    rc = slap_uring_enter(ur->ur_fd, slap_uring_sq_pending(ur), 0, 0, NULL, 0);
+  while (rc < 0 && errno == EINTR);
+  return rc;
+}
+
+static struct io_uring_sqe *slap_uring_sqe(slap_uring *ur) {
+  struct io_uring_sqe *sqe;
+  unsigned tail = *ur->ur_sq_tail;
+
+  if (slap_uring_sq_pending(ur) >= ur->ur_sq_entries) {
+    if (slap_uring_submit(ur) < 0 || slap_uring_sq_pending(ur) >= ur->ur_sq_entries)
+      return NULL;
+  }
+
+  sqe = &ur->ur_sqes[tail & *ur->ur_sq_mask];
+  memset(sqe, 0, sizeof(*sqe));
+  ur->ur_sq_array[tail & *ur->ur_sq_mask] = tail & *ur->ur_sq_mask;
+  return sqe;
+}
+
+static void slap_uring_sqe_commit(slap_uring *ur) {
+  __atomic_store_n(ur->ur_sq_tail, *ur->ur_sq_tail + 1, __ATOMIC_RELEASE);
+}
+
+static int slap_uring_cancel(slap_uring *ur, ber_socket_t s) {
+  struct io_uring_sync_cancel_reg reg;
+  int rc;
+
+  memset(&reg, 0, sizeof(reg));
+  reg.fd = s;
+  reg.flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+  reg.timeout.tv_sec = 1;
+  do
+    rc = (int)syscall(__NR_io_uring_register, ur->ur_fd, IORING_REGISTER_SYNC_CANCEL, &reg, 1);
+  while (rc < 0 && errno == EINTR);
+  /* the number of cancelled requests, or ENOENT if none */
+  if (rc > 0 || (rc < 0 && errno == ENOENT))
+    rc = 0;
+  return rc;
+}
+
+/* Called under sd_mutex, by the daemon thread only */
+static int slap_uring_arm(int t, ber_socket_t s) {
+  slap_uring *ur = slap_daemon[t].sd_uring;
+  slap_uring_sock *us = &ur->ur_socks[s];
+  uint32_t events = SLAP_EPOLL_SOCK_EV(t, s);
+  struct io_uring_sqe *sqe;
+
+  if (us->us_state != SLAP_URING_PENDING)
+    return 0;
+
+  sqe = slap_uring_sqe(ur);
+  if (sqe == NULL)
+    return -1;
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = s;
+  sqe->poll32_events = events & (EPOLLIN | EPOLLOUT);
+  sqe->len = IORING_POLL_ADD_MULTI;
+  sqe->user_data = SLAP_URING_UD(++us->us_gen, s, 0);
+  slap_uring_sqe_commit(ur);
+  us->us_state = SLAP_URING_ARMED;
+  return 0;
+}
+
+/* Called under sd_mutex */
+static void slap_uring_rearm(int t, ber_socket_t s) {
+  slap_uring *ur = slap_daemon[t].sd_uring;
+
+  if (ur->ur_nadds == dtblsize) {
+    /* drop the stale entries, all the pending ones do fit */
+    int i, j;
+    for (i = j = 0; i < ur->ur_nadds; i++)
+      if (ur->ur_socks[ur->ur_adds[i]].us_state == SLAP_URING_PENDING)
+        ur->ur_adds[j++] = ur->ur_adds[i];
+    ur->ur_nadds = j;
+  }
+  ur->ur_socks[s].us_state = SLAP_URING_PENDING;
+  ur->ur_adds[ur->ur_nadds++] = s;
+}
+
+/* Called under sd_mutex, same as epoll_ctl() within the SLAP_SOCK_* macros */
+static int slap_uring_ctl(int t, int op, ber_socket_t s, struct epoll_event *ep) {
+  slap_uring *ur = slap_daemon[t].sd_uring;
+  slap_uring_sock *us;
+  struct io_uring_sqe *sqe;
+  int rc;
+
+  if (s < 0 || s >= dtblsize) {
+    errno = EBADF;
+    return -1;
+  }
+  us = &ur->ur_socks[s];
+
+  switch (op) {
+  case EPOLL_CTL_ADD:
+    us->us_gen++;
+    slap_uring_rearm(t, s);
+    return 0;
+
+  case EPOLL_CTL_DEL:
+    rc = (us->us_state == SLAP_URING_ARMED) ? slap_uring_cancel(ur, s) : 0;
+    us->us_gen++;
+    us->us_state = SLAP_URING_IDLE;
+    return rc;
+
+  case EPOLL_CTL_MOD:
+    break;
+
+  default:
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (us->us_state != SLAP_URING_ARMED) {
+    /* will be armed with the actual mask */
+    return 0;
+  }
+
+  sqe = slap_uring_sqe(ur);
+  if (sqe == NULL)
+    return -1;
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->addr = SLAP_URING_UD(us->us_gen, s, 0);
+  sqe->off = SLAP_URING_UD(++us->us_gen, s, 0);
+  sqe->len = IORING_POLL_UPDATE_EVENTS | IORING_POLL_UPDATE_USER_DATA | IORING_POLL_ADD_MULTI;
+  sqe->poll32_events = ep->events & (EPOLLIN | EPOLLOUT);
+  sqe->user_data = SLAP_URING_UD(us->us_gen, s, SLAP_URING_CTL);
+  slap_uring_sqe_commit(ur);
+
+  if (slap_uring_self != t && slap_uring_submit(ur) < 0)
+    return -1;
+  return 0;
+}
+
+static int slap_uring_wait(int t, struct epoll_event *revents, int maxevents, int timeout) {
+  slap_uring *ur = slap_daemon[t].sd_uring;
+  struct io_uring_getevents_arg arg;
+  struct __kernel_timespec ts;
+  unsigned head, tail;
+  int i, rc, n = 0;
+
+  ldap_pvt_thread_mutex_lock(&slap_daemon[t].sd_mutex);
+  if (ur->ur_nadds) {
+    for (i = 0; i < ur->ur_nadds; i++) {
+      if (slap_uring_arm(t, ur->ur_adds[i]) != 0) {
+        Debug(LDAP_DEBUG_ANY, "daemon: io_uring: arming fd=%d failed, errno=%d, shutting down\n", ur->ur_adds[i],
+              errno);
+        set_shutdown(SHUT_RDWR);
+      }
+    }
+    ur->ur_nadds = 0;
+    /* submit by this thread, before releasing the lock */
+    slap_uring_submit(ur);
+  }
+  ldap_pvt_thread_mutex_unlock(&slap_daemon[t].sd_mutex);
+
+  memset(&arg, 0, sizeof(arg));
+  if (timeout >= 0) {
+    ts.tv_sec = timeout / 1000;
+    ts.tv_nsec = (timeout % 1000) * 1000000l;
+    arg.ts = (uint64_t)(uintptr_t)&ts;
+  }
+  rc = slap_uring_enter(ur->ur_fd, slap_uring_sq_pending(ur), 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg,
+                        sizeof(arg));
+  if (rc < 0 && errno != ETIME)
+    return -1;
+
+  ldap_pvt_thread_mutex_lock(&slap_daemon[t].sd_mutex);
+  ur->ur_batch++;
+  head = *ur->ur_cq_head;
+  tail = __atomic_load_n(ur->ur_cq_tail, __ATOMIC_ACQUIRE);
+  for (; head != tail && n < maxevents; head++) {
+    struct io_uring_cqe *cqe = &ur->ur_cqes[head & *ur->ur_cq_mask];
+    uint32_t fd = (uint32_t)cqe->user_data & ~SLAP_URING_CTL;
+    slap_uring_sock *us;
+    uint32_t events;
+
+    if (fd >= (uint32_t)dtblsize)
+      continue;
+    us = &ur->ur_socks[fd];
+    if ((uint32_t)(cqe->user_data >> 32) != us->us_gen || us->us_state != SLAP_URING_ARMED)
+      continue;
+    events = SLAP_EPOLL_SOCK_EV(t, fd);
+
+    if (cqe->user_data & SLAP_URING_CTL) {
+      if (cqe->res < 0) {
+        /* the poll has gone or is busy, so re-arm from scratch */
+        slap_uring_cancel(ur, fd);
+        slap_uring_rearm(t, fd);
+      }
+      continue;
+    }
+
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+      /* e.g. on CQ overflow */
+      slap_uring_rearm(t, fd);
+    }
+    if (cqe->res <= 0)
+      continue;
+
+    events = cqe->res & (events | EPOLLERR | EPOLLHUP);
+    if (!events)
+      continue;
+    if (us->us_batch == ur->ur_batch && us->us_slot < n &&
+        revents[us->us_slot].data.ptr == SLAP_EPOLL_SOCK_EP(t, fd).data.ptr) {
+      revents[us->us_slot].events |= events;
+      continue;
+    }
+    us->us_batch = ur->ur_batch;
+    us->us_slot = n;
+    revents[n].events = events;
+    revents[n].data = SLAP_EPOLL_SOCK_EP(t, fd).data;
+    n++;
+  }
+  __atomic_store_n(ur->ur_cq_head, head, __ATOMIC_RELEASE);
+  ldap_pvt_thread_mutex_unlock(&slap_daemon[t].sd_mutex);
+  return n;
+}
+
+static void slap_uring_destroy(int t) {
+  slap_uring *ur = slap_daemon[t].sd_uring;
+
+  if (ur == NULL)
+    return;
+  slap_daemon[t].sd_uring = NULL;
+  if (ur->ur_sqes != MAP_FAILED && ur->ur_sqes != NULL)
+    munmap(ur->ur_sqes, ur->ur_sqes_size);
+  if (ur->ur_ring != MAP_FAILED && ur->ur_ring != NULL)
+    munmap(ur->ur_ring, ur->ur_ring_size);
+  if (ur->ur_fd >= 0)
+    close(ur->ur_fd);
+  ch_free(ur->ur_socks);
+  ch_free(ur);
+}
+
+static int slap_uring_init(int t) {
+  struct io_uring_params p;
+  struct io_uring_sync_cancel_reg reg;
+  slap_uring *ur;
+  char *ring;
+  int rc;
+
+  ur = ch_calloc(1, sizeof(slap_uring));
+  ur->ur_fd = -1;
+  ur->ur_socks = ch_calloc(dtblsize, sizeof(slap_uring_sock) + sizeof(ber_socket_t));
+  ur->ur_adds = (ber_socket_t *)&ur->ur_socks[dtblsize];
+  slap_daemon[t].sd_uring = ur;
+
+  memset(&p, 0, sizeof(p));
+  p.flags = IORING_SETUP_CQSIZE;
+  p.cq_entries = dtblsize / slapd_daemon_threads * 2;
+  if (p.cq_entries < SLAP_URING_SQ_ENTRIES * 2)
+    p.cq_entries = SLAP_URING_SQ_ENTRIES * 2;
+  ur->ur_fd = (int)syscall(__NR_io_uring_setup, SLAP_URING_SQ_ENTRIES, &p);
+  if (ur->ur_fd < 0) {
+    rc = errno;
+    goto bailout;
+  }
+  rc = ENOSYS;
+  if ((p.features & (IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG)) !=
+      (IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG))
+    goto bailout;
+
+  /* IORING_REGISTER_SYNC_CANCEL appeared last, since Linux 6.0 */
+  memset(&reg, 0, sizeof(reg));
+  reg.fd = ur->ur_fd;
+  reg.flags = IORING_ASYNC_CANCEL_FD;
+  if (syscall(__NR_io_uring_register, ur->ur_fd, IORING_REGISTER_SYNC_CANCEL, &reg, 1) == 0 || errno != ENOENT)
+    goto bailout;
+
+  ur->ur_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  if (ur->ur_ring_size < p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe))
+    ur->ur_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  ur->ur_ring = mmap(NULL, ur->ur_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ur->ur_fd,
+                     IORING_OFF_SQ_RING);
+  ur->ur_sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  ur->ur_sqes = mmap(NULL, ur->ur_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ur->ur_fd,
+                     IORING_OFF_SQES);
+  if (ur->ur_ring == MAP_FAILED || ur->ur_sqes == MAP_FAILED) {
+    rc = errno;
+    goto bailout;
+  }
+
+  ring = ur->ur_ring;
+  ur->ur_sq_entries = p.sq_entries;
+  ur->ur_sq_head = (unsigned *)(ring + p.sq_off.head);
+  ur->ur_sq_tail = (unsigned *)(ring + p.sq_off.tail);
+  ur->ur_sq_mask = (unsigned *)(ring + p.sq_off.ring_mask);
+  ur->ur_sq_array = (unsigned *)(ring + p.sq_off.array);
+  ur->ur_cq_head = (unsigned *)(ring + p.cq_off.head);
+  ur->ur_cq_tail = (unsigned *)(ring + p.cq_off.tail);
+  ur->ur_cq_mask = (unsigned *)(ring + p.cq_off.ring_mask);
+  ur->ur_cqes = (struct io_uring_cqe *)(ring + p.cq_off.cqes);
+  return 0;
+
+bailout:
+  Debug(LDAP_DEBUG_ANY, "daemon: io_uring is not available (errno=%d), falling back to " SLAP_EVENT_FNAME "\n", rc);
+  slap_uring_destroy(t);
+  return -1;
+}
+#endif /* SLAP_IOURING */
+
 #ifdef HAVE_SLP
 /*
  * SLP related functions
@@ -722,8 +1140,9 @@ static void slapd_slp_dereg(void) {
  */
 static void slapd_add(ber_socket_t s, int isactive, Listener *sl, int id) {
   if (id < 0)
-    id = DAEMON_ID(s);
+    id = DAEMON_HASH(s);
   ldap_pvt_thread_mutex_lock(&slap_daemon[id].sd_mutex);
+  sd_owner[s] = id;
 
   assert(SLAP_SOCK_NOT_ACTIVE(id, s));
 
@@ -837,17 +1256,6 @@ void slapd_set_write(ber_socket_t s, int wake) {
     slap_daemon[id].sd_nwriters++;
   }
 
-#ifdef SLAPD_WRITE_TIMEOUT
-  if ((wake & 2) && global_writetimeout > 0 && !chk_writetime.ns) {
-    if (id)
-      ldap_pvt_thread_mutex_lock(&slap_daemon[0].sd_mutex);
-    if (!chk_writetime.ns)
-      chk_writetime = ldap_now_steady();
-    if (id)
-      ldap_pvt_thread_mutex_unlock(&slap_daemon[0].sd_mutex);
-  }
-#endif /* SLAPD_WRITE_TIMEOUT */
-
   ldap_pvt_thread_mutex_unlock(&slap_daemon[id].sd_mutex);
   WAKE_LISTENER(id, wake);
 }
@@ -882,23 +1290,6 @@ void slapd_set_read(ber_socket_t s, int wake) {
     WAKE_LISTENER(id, wake);
 }
 
-#ifdef SLAPD_WRITE_TIMEOUT
-slap_time_t slapd_get_writetime() {
-  slap_time_t cur;
-  ldap_pvt_thread_mutex_lock(&slap_daemon[0].sd_mutex);
-  cur = chk_writetime;
-  ldap_pvt_thread_mutex_unlock(&slap_daemon[0].sd_mutex);
-  return cur;
-}
-
-void slapd_clr_writetime(slap_time_t old) {
-  ldap_pvt_thread_mutex_lock(&slap_daemon[0].sd_mutex);
-  if (chk_writetime.ns == old.ns)
-    chk_writetime.ns = 0;
-  ldap_pvt_thread_mutex_unlock(&slap_daemon[0].sd_mutex);
-}
-#endif /* SLAPD_WRITE_TIMEOUT */
-
 static void slapd_close(ber_socket_t s) {
   Debug(LDAP_DEBUG_CONNS, "daemon: closing %ld\n", (long)s);
   tcp_close(s);
@@ -1160,6 +1551,8 @@ static int slap_open_listener(const char *url, int *listeners, int *cur) {
   l.sl_url.bv_val = NULL;
   l.sl_mute = 1;
   l.sl_busy = 0;
+  l.sl_reuseport = 0;
+  l.sl_tid = 0;
 
 #ifndef WITH_TLS
   if (ldap_pvt_url_scheme2tls(lud->lud_scheme)) {
@@ -1261,6 +1654,7 @@ static int slap_open_listener(const char *url, int *listeners, int *cur) {
       continue;
     }
     l.sl_sd = s;
+    l.sl_reuseport = 0;
 
     if (l.sl_sd >= dtblsize) {
       Debug(LDAP_DEBUG_ANY, "daemon: listener descriptor %ld is too great %ld\n", (long)l.sl_sd, (long)dtblsize);
@@ -1287,6 +1681,26 @@ static int slap_open_listener(const char *url, int *listeners, int *cur) {
               (long)l.sl_sd, err, sock_errstr(err));
       }
 #endif /* SO_REUSEADDR */
+#ifdef SO_REUSEPORT
+      /* let each listener thread bind its own copy, see slap_open_shards() */
+      if (slapd_reuseport
+#ifdef LDAP_CONNECTIONLESS
+          && !l.sl_is_udp
+#endif /* LDAP_CONNECTIONLESS */
+      ) {
+        tmp = 1;
+        rc = setsockopt(s, SOL_SOCKET, SO_REUSEPORT, (char *)&tmp, sizeof(tmp));
+        if (rc == AC_SOCKET_ERROR) {
+          int err = sock_errno();
+          Debug(LDAP_DEBUG_ANY,
+                "slapd(%ld): "
+                "setsockopt(SO_REUSEPORT) failed errno=%d (%s)\n",
+                (long)l.sl_sd, err, sock_errstr(err));
+        } else {
+          l.sl_reuseport = 1;
+        }
+      }
+#endif /* SO_REUSEPORT */
     }
 
     switch ((*sal)->sa_family) {
@@ -1428,6 +1842,121 @@ static int slap_open_listener(const char *url, int *listeners, int *cur) {
   return 0;
 }
 
+#ifdef SO_REUSEPORT
+/*
+ * Bind another SO_REUSEPORT socket to the address of the listener,
+ * to be served by the given listener thread.
+ */
+static Listener *slap_open_shard(Listener *sl, int tid) {
+  Listener *li;
+  ber_socket_t s;
+  int tmp = 1, rc, err, addrlen;
+
+  switch (sl->sl_sa.sa_addr.sa_family) {
+  case AF_INET:
+    addrlen = sizeof(struct sockaddr_in);
+    break;
+#ifdef LDAP_PF_INET6
+  case AF_INET6:
+    addrlen = sizeof(struct sockaddr_in6);
+    break;
+#endif /* LDAP_PF_INET6 */
+  default:
+    return NULL;
+  }
+
+  s = socket(sl->sl_sa.sa_addr.sa_family, SOCK_STREAM, 0);
+  if (s == AC_SOCKET_INVALID) {
+    err = sock_errno();
+    Debug(LDAP_DEBUG_ANY, "daemon: shard %d of %s: socket() failed errno=%d (%s)\n", tid, sl->sl_url.bv_val, err,
+          sock_errstr(err));
+    return NULL;
+  }
+  if (s >= dtblsize) {
+    Debug(LDAP_DEBUG_ANY, "daemon: listener descriptor %ld is too great %ld\n", (long)s, (long)dtblsize);
+    tcp_close(s);
+    return NULL;
+  }
+
+  rc = setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (char *)&tmp, sizeof(tmp));
+  if (rc != AC_SOCKET_ERROR)
+    rc = setsockopt(s, SOL_SOCKET, SO_REUSEPORT, (char *)&tmp, sizeof(tmp));
+#if defined(LDAP_PF_INET6) && defined(IPV6_V6ONLY)
+  if (rc != AC_SOCKET_ERROR && sl->sl_sa.sa_addr.sa_family == AF_INET6)
+    rc = setsockopt(s, IPPROTO_IPV6, IPV6_V6ONLY, (char *)&tmp, sizeof(tmp));
+#endif /* LDAP_PF_INET6 && IPV6_V6ONLY */
+  if (rc != AC_SOCKET_ERROR)
+    rc = bind(s, &sl->sl_sa.sa_addr, addrlen);
+  if (rc == AC_SOCKET_ERROR) {
+    err = sock_errno();
+    Debug(LDAP_DEBUG_ANY, "daemon: shard %d of %s failed errno=%d (%s)\n", tid, sl->sl_url.bv_val, err,
+          sock_errstr(err));
+    tcp_close(s);
+    return NULL;
+  }
+
+  li = ch_malloc(sizeof(Listener));
+  *li = *sl;
+  li->sl_sd = s;
+  li->sl_tid = tid;
+  ber_dupbv(&li->sl_url, &sl->sl_url);
+  ber_dupbv(&li->sl_name, &sl->sl_name);
+  return li;
+}
+
+/*
+ * The number of listener threads is known only after the config is read,
+ * but by then privileges may be already dropped, so that neither a port
+ * below 1024 could be bound, nor the kernel would let a socket of another
+ * uid join the SO_REUSEPORT group. Thus bind a shard for every possible
+ * thread right now, slap_close_shards() drops the unused ones later.
+ * The shards are not in the listen state until then, so no connection
+ * could be queued to them.
+ */
+static void slap_open_shards(void) {
+  Listener **ll;
+  int i, j, t, n;
+
+  for (n = 0; slap_listeners[n] != NULL; n++)
+    ;
+  ll = ch_malloc((n * SLAPD_MAX_DAEMON_THREADS + 1) * sizeof(Listener *));
+  for (i = j = 0; i < n; i++) {
+    Listener *lr = slap_listeners[i];
+
+    ll[j++] = lr;
+    if (!lr->sl_reuseport)
+      continue;
+    for (t = 1; t < SLAPD_MAX_DAEMON_THREADS; t++) {
+      Listener *li = slap_open_shard(lr, t);
+      if (li)
+        ll[j++] = li;
+    }
+  }
+  ll[j] = NULL;
+
+  slap_listeners_urls = slap_listeners;
+  slap_listeners = ll;
+}
+
+static void slap_close_shards(void) {
+  int i, j;
+
+  for (i = j = 0; slap_listeners[i] != NULL; i++) {
+    Listener *lr = slap_listeners[i];
+
+    if (lr->sl_tid >= slapd_daemon_threads) {
+      tcp_close(lr->sl_sd);
+      ber_memfree(lr->sl_url.bv_val);
+      ber_memfree(lr->sl_name.bv_val);
+      free(lr);
+      continue;
+    }
+    slap_listeners[j++] = lr;
+  }
+  slap_listeners[j] = NULL;
+}
+#endif /* SO_REUSEPORT */
+
 static int daemon_inited = 0;
 
 int slapd_daemon_init(const char *urls) {
@@ -1455,6 +1984,7 @@ int slapd_daemon_init(const char *urls) {
 #else  /* ! HAVE_SYSCONF && ! HAVE_GETDTABLESIZE */
   dtblsize = FD_SETSIZE;
 #endif /* ! HAVE_SYSCONF && ! HAVE_GETDTABLESIZE */
+  sd_owner = ch_calloc(dtblsize, sizeof(*sd_owner));
 
   /* open a pipe (or something equivalent connected to itself).
    * we write a byte on this fd whenever we catch a signal. The main
@@ -1466,6 +1996,8 @@ int slapd_daemon_init(const char *urls) {
     return rc;
   }
   ber_pvt_socket_set_nonblock(wake_sds[0][1], 1);
+  /* io_uring may report a stale readiness */
+  ber_pvt_socket_set_nonblock(wake_sds[0][0], 1);
 
   SLAP_SOCK_INIT(0);
 
@@ -1508,6 +2040,10 @@ int slapd_daemon_init(const char *urls) {
     return -1;
   }
   Debug(LDAP_DEBUG_TRACE, "daemon_init: %d listeners opened\n", j);
+#ifdef SO_REUSEPORT
+  if (slapd_reuseport)
+    slap_open_shards();
+#endif /* SO_REUSEPORT */
 
 #ifdef HAVE_SLP
   if (slapd_register_slp) {
@@ -1541,6 +2077,8 @@ static void destroy_listeners(void) {
 
   free(slap_listeners);
   slap_listeners = NULL;
+  free(slap_listeners_urls);
+  slap_listeners_urls = NULL;
 }
 
 int slapd_daemon_destroy(void) {
@@ -1557,6 +2095,8 @@ int slapd_daemon_destroy(void) {
       ldap_pvt_thread_mutex_destroy(&slap_daemon[i].sd_mutex);
       SLAP_SOCK_DESTROY(i);
     }
+    ch_free(sd_owner);
+    sd_owner = NULL;
     daemon_inited = 0;
 #ifdef HAVE_TCPD
     ldap_pvt_thread_mutex_destroy(&sd_tcpd_mutex);
@@ -1690,7 +2230,7 @@ static int slap_listener(Listener *sl) {
     ldap_pvt_thread_yield();
     return 0;
   }
-  tid = DAEMON_ID(s);
+  tid = sl->sl_reuseport ? sl->sl_tid : DAEMON_HASH(s);
 
 #ifdef LDAP_DEBUG
   ldap_pvt_thread_mutex_lock(&slap_daemon[tid].sd_mutex);
@@ -1894,20 +2434,19 @@ static int slap_listener_activate(Listener *sl) {
 }
 
 static void *slapd_daemon_task(void *ptr) {
-  slap_time_t last_idle_check = {0};
+  int idletimeout = global_idletimeout, writetimeout = global_writetimeout;
   int ebadf = 0;
   int tid = (ldap_pvt_thread_t *)ptr - listener_tid;
 
-#define SLAPD_IDLE_CHECK_LIMIT 4
-
+#ifdef SLAP_IOURING
+  slap_uring_self = tid;
+#endif /* SLAP_IOURING */
   slapd_add(wake_sds[tid][0], 0, NULL, tid);
   if (tid)
     goto loop;
 
   /* Init stuff done only by thread 0 */
 
-  last_idle_check = ldap_now_steady();
-
   for (int l = 0; slap_listeners[l] != NULL; l++) {
     if (slap_listeners[l]->sl_sd == AC_SOCKET_INVALID)
       continue;
@@ -2063,7 +2602,8 @@ static void *slapd_daemon_task(void *ptr) {
       return (void *)-1;
     }
 
-    slapd_add(slap_listeners[l]->sl_sd, 0, slap_listeners[l], -1);
+    slapd_add(slap_listeners[l]->sl_sd, 0, slap_listeners[l],
+              slap_listeners[l]->sl_reuseport ? slap_listeners[l]->sl_tid : -1);
   }
 
 loop:
@@ -2077,24 +2617,14 @@ loop:
 
     tv.ns = 0;
     if (!tid) {
-      int check = 0;
-      /* Set the select timeout. */
-      if (global_idletimeout > 0 &&
-          now.ns > last_idle_check.ns + ldap_from_seconds(global_idletimeout / SLAPD_IDLE_CHECK_LIMIT).ns) {
-        check = 1;
-        tv = ldap_from_seconds(global_idletimeout / SLAPD_IDLE_CHECK_LIMIT);
-      }
-#ifdef SLAPD_WRITE_TIMEOUT
-      if (chk_writetime.ns && now.ns > chk_writetime.ns) {
-        check = 2;
-        if (!tv.ns || tv.ns > ldap_from_seconds(global_writetimeout).ns)
-          tv = ldap_from_seconds(global_writetimeout);
-      }
-#endif /* SLAPD_WRITE_TIMEOUT */
-      if (check) {
-        connections_timeout_idle(now);
-        last_idle_check = now;
+      /* the connections are armed for the timeouts in effect */
+      if (idletimeout != global_idletimeout || writetimeout != global_writetimeout) {
+        idletimeout = global_idletimeout;
+        writetimeout = global_writetimeout;
+        connections_timeout_arm();
       }
+      /* Set the select timeout. */
+      tv = slap_timer_run(now);
     }
 
     if (slapd_gentle_shutdown) {
@@ -2560,8 +3090,13 @@ static int connectionless_init(void) {
 
 int slapd_daemon(void) {
   int i, rc;
+  const char *engine = SLAP_EVENT_FNAME;
 
-  Debug(LDAP_DEBUG_ANY, "daemon: using " SLAP_EVENT_FNAME "\n");
+#ifdef SLAP_IOURING
+  if (slap_daemon[0].sd_uring)
+    engine = "io_uring";
+#endif /* SLAP_IOURING */
+  Debug(LDAP_DEBUG_ANY, "daemon: using %s\n", engine);
 
 #ifdef LDAP_CONNECTIONLESS
   connectionless_init();
@@ -2569,6 +3104,10 @@ int slapd_daemon(void) {
 
   if (slapd_daemon_threads > SLAPD_MAX_DAEMON_THREADS)
     slapd_daemon_threads = SLAPD_MAX_DAEMON_THREADS;
+#ifdef SO_REUSEPORT
+  if (slap_listeners_urls)
+    slap_close_shards();
+#endif /* SO_REUSEPORT */
 
   listener_tid = ch_malloc(slapd_daemon_threads * sizeof(ldap_pvt_thread_t));
 
@@ -2581,6 +3120,7 @@ int slapd_daemon(void) {
       return rc;
     }
     ber_pvt_socket_set_nonblock(wake_sds[i][1], 1);
+    ber_pvt_socket_set_nonblock(wake_sds[i][0], 1);
 
     SLAP_SOCK_INIT(i);
   }
@@ -2694,14 +3234,17 @@ int slap_unpause_server(void) {
   return rc;
 }
 
-void slapd_add_internal(ber_socket_t s, int isactive) { slapd_add(s, isactive, NULL, -1); }
+void slapd_add_internal(ber_socket_t s, int isactive, Listener *from) {
+  /* a session accepted by a SO_REUSEPORT shard stays with its thread */
+  slapd_add(s, isactive, NULL, (from && from->sl_reuseport) ? from->sl_tid : -1);
+}
 
 Listener **slapd_get_listeners(void) {
   /* Could return array with no listeners if !listening, but current
    * callers mostly look at the URLs.  E.g. syncrepl uses this to
    * identify the server, which means it wants the startup arguments.
    */
-  return slap_listeners;
+  return slap_listeners_urls ? slap_listeners_urls : slap_listeners;
 }
 
 /* Reject all incoming requests */
@@ -69,7 +69,10 @@ int do_delete(Operation *op, SlapReply *rs) {
   }
 
   op->o_bd = frontendDB;
+  slap_op_stamp(op, SLAP_STAMP_BACKEND);
   rs->sr_err = slap_biglock_call_be(op_delete, op, rs);
+  if (rs->sr_err != SLAPD_ASYNCOP)
+    slap_op_stamp(op, SLAP_STAMP_BACKEND_DONE);
   if (rs->sr_err == SLAPD_ASYNCOP) {
     /* skip cleanup */
     return rs->sr_err;
@@ -46,6 +46,184 @@
 
 int slap_DN_strict = SLAP_AD_NOINSERT;
 
+/*
+ * A bounded cache of the pretty and normalized forms of the DNs seen
+ * by dnNormalize(), dnPretty() and dnPrettyNormal(), keyed by the value
+ * as it was given.  It is split into shards by the hash of the value,
+ * each with its own mutex, hash chains and LRU list.  A DN is cached
+ * only when it is seen for the second time, as remembered by a small
+ * direct-mapped table of hashes per shard, so that the DNs of added
+ * entries, which mostly come once, don't flush the ones used over and
+ * over.  Any change of the attribute types flushes the cache.
+ */
+#define DN_CACHE_SHARDS 16
+#define DN_CACHE_BUCKETS 1024 /* per shard */
+#define DN_CACHE_SEEN 1024    /* per shard */
+
+unsigned dn_cache_max = 8192; /* entries in all, 0 disables the cache */
+
+typedef struct dn_cache_entry {
+  LDAP_LIST_ENTRY(dn_cache_entry) dce_chain;
+  LDAP_TAILQ_ENTRY(dn_cache_entry) dce_lru;
+  uint32_t dce_hash;
+  struct berval dce_val;
+  struct berval dce_pretty;
+  struct berval dce_normal;
+} dn_cache_entry;
+
+typedef struct dn_cache_shard {
+  ldap_pvt_thread_mutex_t dcs_mutex;
+  unsigned dcs_count;
+  LDAP_TAILQ_HEAD(dn_cache_lru, dn_cache_entry) dcs_lru;
+  LDAP_LIST_HEAD(dn_cache_chain, dn_cache_entry) dcs_chain[DN_CACHE_BUCKETS];
+  uint32_t dcs_seen[DN_CACHE_SEEN];
+} __cache_aligned dn_cache_shard;
+
+static dn_cache_shard *dn_cache;
+static void *dn_cache_alloc;
+static unsigned dn_cache_gen;
+
+typedef struct dn_cache_probe {
+  dn_cache_shard *dcp_shard;
+  uint32_t dcp_hash;
+  unsigned dcp_gen;
+  int dcp_admit;
+} dn_cache_probe;
+
+void dn_cache_init(void) {
+  int i, j;
+
+  dn_cache_alloc = ch_calloc(1, DN_CACHE_SHARDS * sizeof(dn_cache_shard) + CACHELINE_SIZE - 1);
+  dn_cache = (dn_cache_shard *)(((size_t)dn_cache_alloc + CACHELINE_SIZE - 1) & ~(size_t)(CACHELINE_SIZE - 1));
+  for (i = 0; i < DN_CACHE_SHARDS; i++) {
+    ldap_pvt_thread_mutex_init(&dn_cache[i].dcs_mutex);
+    LDAP_TAILQ_INIT(&dn_cache[i].dcs_lru);
+    for (j = 0; j < DN_CACHE_BUCKETS; j++)
+      LDAP_LIST_INIT(&dn_cache[i].dcs_chain[j]);
+  }
+}
+
+/* dcs_mutex locked */
+static void dn_cache_evict(dn_cache_shard *dcs, dn_cache_entry *dce) {
+  LDAP_LIST_REMOVE(dce, dce_chain);
+  LDAP_TAILQ_REMOVE(&dcs->dcs_lru, dce, dce_lru);
+  dcs->dcs_count--;
+  ch_free(dce);
+}
+
+void dn_cache_flush(void) {
+  dn_cache_entry *dce;
+  int i;
+
+  if (!dn_cache)
+    return;
+
+  /* the results being computed meanwhile are not to be cached */
+  __atomic_add_fetch(&dn_cache_gen, 1, __ATOMIC_RELAXED);
+  for (i = 0; i < DN_CACHE_SHARDS; i++) {
+    ldap_pvt_thread_mutex_lock(&dn_cache[i].dcs_mutex);
+    while ((dce = LDAP_TAILQ_FIRST(&dn_cache[i].dcs_lru)) != NULL)
+      dn_cache_evict(&dn_cache[i], dce);
+    memset(dn_cache[i].dcs_seen, 0, sizeof(dn_cache[i].dcs_seen));
+    ldap_pvt_thread_mutex_unlock(&dn_cache[i].dcs_mutex);
+  }
+}
+
+void dn_cache_destroy(void) {
+  int i;
+
+  if (!dn_cache)
+    return;
+
+  dn_cache_flush();
+  for (i = 0; i < DN_CACHE_SHARDS; i++)
+    ldap_pvt_thread_mutex_destroy(&dn_cache[i].dcs_mutex);
+  ch_free(dn_cache_alloc);
+  dn_cache = NULL;
+}
+
+/* Look the value up, copying the requested forms of it on a hit.
+ * On a miss the probe tells whether to dn_cache_put() the forms once
+ * they are computed. */
+static int dn_cache_get(struct berval *val, struct berval *pretty, struct berval *normal, void *ctx,
+                        dn_cache_probe *dcp) {
+  dn_cache_shard *dcs;
+  dn_cache_entry *dce;
+  uint32_t h = 2166136261u; /* FNV-1a */
+  ber_len_t i;
+  uint32_t *seen;
+
+  dcp->dcp_admit = 0;
+  if (!dn_cache || !dn_cache_max || !(slap_DN_strict & SLAP_AD_NOINSERT))
+    return 0;
+
+  for (i = 0; i < val->bv_len; i++)
+    h = (h ^ (unsigned char)val->bv_val[i]) * 16777619u;
+  dcp->dcp_hash = h;
+  dcp->dcp_gen = __atomic_load_n(&dn_cache_gen, __ATOMIC_RELAXED);
+  dcp->dcp_shard = dcs = &dn_cache[h % DN_CACHE_SHARDS];
+
+  ldap_pvt_thread_mutex_lock(&dcs->dcs_mutex);
+  LDAP_LIST_FOREACH(dce, &dcs->dcs_chain[(h / DN_CACHE_SHARDS) % DN_CACHE_BUCKETS], dce_chain) {
+    if (dce->dce_hash == h && dce->dce_val.bv_len == val->bv_len &&
+        !memcmp(dce->dce_val.bv_val, val->bv_val, val->bv_len)) {
+      LDAP_TAILQ_REMOVE(&dcs->dcs_lru, dce, dce_lru);
+      LDAP_TAILQ_INSERT_TAIL(&dcs->dcs_lru, dce, dce_lru);
+      if (pretty)
+        ber_dupbv_x(pretty, &dce->dce_pretty, ctx);
+      if (normal)
+        ber_dupbv_x(normal, &dce->dce_normal, ctx);
+      ldap_pvt_thread_mutex_unlock(&dcs->dcs_mutex);
+      return 1;
+    }
+  }
+  seen = &dcs->dcs_seen[(h / DN_CACHE_SHARDS) % DN_CACHE_SEEN];
+  if (*seen == h)
+    dcp->dcp_admit = 1;
+  else
+    *seen = h;
+  ldap_pvt_thread_mutex_unlock(&dcs->dcs_mutex);
+  return 0;
+}
+
+static void dn_cache_put(struct berval *val, struct berval *pretty, struct berval *normal, dn_cache_probe *dcp) {
+  dn_cache_shard *dcs = dcp->dcp_shard;
+  dn_cache_entry *dce;
+  char *p;
+
+  dce = ch_malloc(sizeof(dn_cache_entry) + val->bv_len + pretty->bv_len + normal->bv_len + 3);
+  dce->dce_hash = dcp->dcp_hash;
+  p = (char *)(dce + 1);
+  dce->dce_val.bv_val = p;
+  dce->dce_val.bv_len = val->bv_len;
+  memcpy(p, val->bv_val, val->bv_len);
+  p += val->bv_len;
+  *p++ = '\0';
+  dce->dce_pretty.bv_val = p;
+  dce->dce_pretty.bv_len = pretty->bv_len;
+  memcpy(p, pretty->bv_val, pretty->bv_len);
+  p += pretty->bv_len;
+  *p++ = '\0';
+  dce->dce_normal.bv_val = p;
+  dce->dce_normal.bv_len = normal->bv_len;
+  memcpy(p, normal->bv_val, normal->bv_len);
+  p[normal->bv_len] = '\0';
+
+  ldap_pvt_thread_mutex_lock(&dcs->dcs_mutex);
+  if (dcp->dcp_gen != __atomic_load_n(&dn_cache_gen, __ATOMIC_RELAXED)) {
+    ldap_pvt_thread_mutex_unlock(&dcs->dcs_mutex);
+    ch_free(dce);
+    return;
+  }
+  /* another thread may have got it first, the older copy ages out */
+  LDAP_LIST_INSERT_HEAD(&dcs->dcs_chain[(dcp->dcp_hash / DN_CACHE_SHARDS) % DN_CACHE_BUCKETS], dce, dce_chain);
+  LDAP_TAILQ_INSERT_TAIL(&dcs->dcs_lru, dce, dce_lru);
+  dcs->dcs_count++;
+  while (dcs->dcs_count > (dn_cache_max + DN_CACHE_SHARDS - 1) / DN_CACHE_SHARDS)
+    dn_cache_evict(dcs, LDAP_TAILQ_FIRST(&dcs->dcs_lru));
+  ldap_pvt_thread_mutex_unlock(&dcs->dcs_mutex);
+}
+
 static int LDAPRDN_validate(LDAPRDN rdn) {
   int iAVA;
   int rc;
@@ -365,13 +543,98 @@ static int LDAPDN_rewrite(LDAPDN dn, unsigned flags, void *ctx) {
   return LDAP_SUCCESS;
 }
 
+/* the pretty and normalized forms of a non-empty DN */
+static int dn_pretty_normal(struct berval *val, struct berval *pretty, struct berval *normal, void *ctx) {
+  LDAPDN dn = NULL;
+  int rc;
+
+  pretty->bv_val = NULL;
+  normal->bv_val = NULL;
+  pretty->bv_len = 0;
+  normal->bv_len = 0;
+
+  /* FIXME: should be liberal in what we accept */
+  rc = ldap_bv2dn_x(val, &dn, LDAP_DN_FORMAT_LDAP, ctx);
+  if (rc != LDAP_SUCCESS) {
+    return LDAP_INVALID_SYNTAX;
+  }
+
+  assert(strlen(val->bv_val) == val->bv_len);
+
+  /*
+   * Schema-aware rewrite
+   */
+  if (LDAPDN_rewrite(dn, SLAP_LDAPDN_PRETTY, ctx) != LDAP_SUCCESS) {
+    ldap_dnfree_x(dn, ctx);
+    return LDAP_INVALID_SYNTAX;
+  }
+
+  rc = ldap_dn2bv_x(dn, pretty, LDAP_DN_FORMAT_LDAPV3 | LDAP_DN_PRETTY, ctx);
+
+  if (rc != LDAP_SUCCESS) {
+    ldap_dnfree_x(dn, ctx);
+    return LDAP_INVALID_SYNTAX;
+  }
+
+  if (LDAPDN_rewrite(dn, 0, ctx) != LDAP_SUCCESS) {
+    ldap_dnfree_x(dn, ctx);
+    ber_memfree_x(pretty->bv_val, ctx);
+    pretty->bv_val = NULL;
+    pretty->bv_len = 0;
+    return LDAP_INVALID_SYNTAX;
+  }
+
+  rc = ldap_dn2bv_x(dn, normal, LDAP_DN_FORMAT_LDAPV3 | LDAP_DN_PRETTY, ctx);
+
+  ldap_dnfree_x(dn, ctx);
+  if (rc != LDAP_SUCCESS) {
+    ber_memfree_x(pretty->bv_val, ctx);
+    pretty->bv_val = NULL;
+    pretty->bv_len = 0;
+    return LDAP_INVALID_SYNTAX;
+  }
+
+  return LDAP_SUCCESS;
+}
+
+/* Get the pretty and/or the normalized form of a non-empty DN from the
+ * cache, or compute both and cache them when the DN is a repeated one.
+ * Returns 0 when the caller is to handle the DN by itself. */
+static int dn_cache_lookup(struct berval *val, struct berval *pretty, struct berval *normal, void *ctx) {
+  dn_cache_probe dcp;
+  struct berval other;
+
+  if (val->bv_len > SLAP_LDAPDN_MAXLEN)
+    return 0;
+  if (dn_cache_get(val, pretty, normal, ctx, &dcp))
+    return 1;
+  if (!dcp.dcp_admit)
+    return 0;
+
+  if (!pretty)
+    pretty = &other;
+  if (!normal)
+    normal = &other;
+  if (dn_pretty_normal(val, pretty, normal, ctx) != LDAP_SUCCESS)
+    return 0;
+  dn_cache_put(val, pretty, normal, &dcp);
+  ber_memfree_x(other.bv_val, ctx);
+  return 1;
+}
+
 int dnNormalize(slap_mask_t use, Syntax *syntax, MatchingRule *mr, struct berval *val, struct berval *out, void *ctx) {
   assert(val != NULL);
   assert(out != NULL);
 
   Debug(LDAP_DEBUG_TRACE, ">>> dnNormalize: <%s>\n", val->bv_val ? val->bv_val : "");
 
-  if (val->bv_len != 0) {
+  if (val->bv_len == 0) {
+    ber_dupbv_x(out, val, ctx);
+
+  } else if (dn_cache_lookup(val, NULL, out, ctx)) {
+    /* from the cache */
+
+  } else {
     LDAPDN dn = NULL;
     int rc;
 
@@ -403,8 +666,6 @@ int dnNormalize(slap_mask_t use, Syntax *syntax, MatchingRule *mr, struct berval
     if (rc != LDAP_SUCCESS) {
       return LDAP_INVALID_SYNTAX;
     }
-  } else {
-    ber_dupbv_x(out, val, ctx);
   }
 
   Debug(LDAP_DEBUG_TRACE, "<<< dnNormalize: <%s>\n", out->bv_val ? out->bv_val : "");
@@ -472,6 +733,9 @@ int dnPretty(Syntax *syntax, struct berval *val, struct berval *out, void *ctx)
   } else if (val->bv_len > SLAP_LDAPDN_MAXLEN) {
     return LDAP_INVALID_SYNTAX;
 
+  } else if (dn_cache_lookup(val, out, NULL, ctx)) {
+    /* from the cache */
+
   } else {
     LDAPDN dn = NULL;
     int rc;
@@ -618,53 +882,14 @@ int dnPrettyNormal(Syntax *syntax, struct berval *val, struct berval *pretty, st
     return LDAP_INVALID_SYNTAX;
 
   } else {
-    LDAPDN dn = NULL;
-    int rc;
-
-    pretty->bv_val = NULL;
-    normal->bv_val = NULL;
-    pretty->bv_len = 0;
-    normal->bv_len = 0;
-
-    /* FIXME: should be liberal in what we accept */
-    rc = ldap_bv2dn_x(val, &dn, LDAP_DN_FORMAT_LDAP, ctx);
-    if (rc != LDAP_SUCCESS) {
-      return LDAP_INVALID_SYNTAX;
-    }
-
-    assert(strlen(val->bv_val) == val->bv_len);
-
-    /*
-     * Schema-aware rewrite
-     */
-    if (LDAPDN_rewrite(dn, SLAP_LDAPDN_PRETTY, ctx) != LDAP_SUCCESS) {
-      ldap_dnfree_x(dn, ctx);
-      return LDAP_INVALID_SYNTAX;
-    }
-
-    rc = ldap_dn2bv_x(dn, pretty, LDAP_DN_FORMAT_LDAPV3 | LDAP_DN_PRETTY, ctx);
-
-    if (rc != LDAP_SUCCESS) {
-      ldap_dnfree_x(dn, ctx);
-      return LDAP_INVALID_SYNTAX;
-    }
-
-    if (LDAPDN_rewrite(dn, 0, ctx) != LDAP_SUCCESS) {
-      ldap_dnfree_x(dn, ctx);
-      ber_memfree_x(pretty->bv_val, ctx);
-      pretty->bv_val = NULL;
-      pretty->bv_len = 0;
-      return LDAP_INVALID_SYNTAX;
-    }
-
-    rc = ldap_dn2bv_x(dn, normal, LDAP_DN_FORMAT_LDAPV3 | LDAP_DN_PRETTY, ctx);
-
-    ldap_dnfree_x(dn, ctx);
-    if (rc != LDAP_SUCCESS) {
-      ber_memfree_x(pretty->bv_val, ctx);
-      pretty->bv_val = NULL;
-      pretty->bv_len = 0;
-      return LDAP_INVALID_SYNTAX;
+    dn_cache_probe dcp;
+
+    if (!dn_cache_get(val, pretty, normal, ctx, &dcp)) {
+      int rc = dn_pretty_normal(val, pretty, normal, ctx);
+      if (rc != LDAP_SUCCESS)
+        return rc;
+      if (dcp.dcp_admit)
+        dn_cache_put(val, pretty, normal, &dcp);
     }
   }
 
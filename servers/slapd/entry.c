@@ -34,7 +34,7 @@ static int emaxsize; /* max size of ebuf			 */
 /*
  * Empty root entry
  */
-const Entry slap_entry_root = {NOID, {0, ""}, {0, ""}, NULL, 0, {0, ""}, NULL};
+const Entry slap_entry_root = {NOID, {0, ""}, {0, ""}, NULL, NULL, 0, {0, ""}, NULL};
 
 /*
  * these mutexes must be used when calling the entry2str()
@@ -155,7 +155,10 @@ int do_extended(Operation *op, SlapReply *rs) {
   }
 
   op->o_bd = frontendDB;
+  slap_op_stamp(op, SLAP_STAMP_BACKEND);
   rs->sr_err = frontendDB->be_extended(op, rs);
+  if (rs->sr_err != SLAPD_ASYNCOP)
+    slap_op_stamp(op, SLAP_STAMP_BACKEND_DONE);
 
   /* clean up in case some overlay set them? */
   if (!BER_BVISNULL(&op->o_req_ndn)) {
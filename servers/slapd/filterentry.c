@@ -28,9 +28,25 @@
 #include "component.h"
 #endif
 
+/* An instruction of a compiled filter, see filter_compile() */
+typedef struct FilterInsn {
+  unsigned short fi_code;
+  unsigned short fi_cost;
+  unsigned fi_size; /* the instructions of the node and its operands */
+  int fi_result;    /* FP_COMPUTED */
+  Filter *fi_filter;
+  MatchingRule *fi_mr;      /* FP_SUBSTRINGS: the rule of the asserted type */
+  struct berval fi_anchor;  /* FP_SUBSTRINGS: the longest "any" piece */
+} FilterInsn;
+
+struct FilterProgram {
+  unsigned fp_len;
+  FilterInsn fp_insn[1];
+};
+
 static int test_filter_and(Operation *op, Entry *e, Filter *flist);
 static int test_filter_or(Operation *op, Entry *e, Filter *flist);
-static int test_substrings_filter(Operation *op, Entry *e, Filter *f);
+static int test_substrings_filter(Operation *op, Entry *e, Filter *f, FilterInsn *fi);
 static int test_ava_filter(Operation *op, Entry *e, AttributeAssertion *ava, int type);
 static int test_mra_filter(Operation *op, Entry *e, MatchingRuleAssertion *mra);
 static int test_presence_filter(Operation *op, Entry *e, AttributeDescription *desc);
@@ -73,7 +89,7 @@ int test_filter(Operation *op, Entry *e, Filter *f) {
 
   case LDAP_FILTER_SUBSTRINGS:
     Debug(LDAP_DEBUG_FILTER, "    SUBSTRINGS\n");
-    rc = test_substrings_filter(op, e, f);
+    rc = test_substrings_filter(op, e, f, NULL);
     break;
 
   case LDAP_FILTER_GE:
@@ -176,7 +192,7 @@ static int test_mra_filter(Operation *op, Entry *e, MatchingRuleAssertion *mra)
       return LDAP_COMPARE_FALSE;
     }
 
-    for (a = attrs_find(e->e_attrs, mra->ma_desc); a != NULL; a = attrs_find(a->a_next, mra->ma_desc)) {
+    for (a = entry_attrs_find(e, mra->ma_desc); a != NULL; a = attrs_find(a->a_next, mra->ma_desc)) {
       struct berval *bv;
       int normalize_attribute = 0;
 
@@ -540,7 +556,7 @@ static int test_ava_filter(Operation *op, Entry *e, AttributeAssertion *ava, int
   }
 #endif
 
-  for (a = attrs_find(e->e_attrs, ava->aa_desc); a != NULL; a = attrs_find(a->a_next, ava->aa_desc)) {
+  for (a = entry_attrs_find(e, ava->aa_desc); a != NULL; a = attrs_find(a->a_next, ava->aa_desc)) {
     int use;
     MatchingRule *mr;
     struct berval *bv;
@@ -760,7 +776,7 @@ static int test_presence_filter(Operation *op, Entry *e, AttributeDescription *d
 
   rc = LDAP_COMPARE_FALSE;
 
-  for (a = attrs_find(e->e_attrs, desc); a != NULL; a = attrs_find(a->a_next, desc)) {
+  for (a = entry_attrs_find(e, desc); a != NULL; a = attrs_find(a->a_next, desc)) {
     if ((desc != a->a_desc) && !access_allowed(op, e, a->a_desc, NULL, ACL_SEARCH, NULL)) {
       rc = LDAP_INSUFFICIENT_ACCESS;
       continue;
@@ -824,9 +840,10 @@ static int test_filter_or(Operation *op, Entry *e, Filter *flist) {
   return rtn;
 }
 
-static int test_substrings_filter(Operation *op, Entry *e, Filter *f) {
+static int test_substrings_filter(Operation *op, Entry *e, Filter *f, FilterInsn *fi) {
   Attribute *a;
   int rc;
+  struct berval *anchor = NULL;
 
   Debug(LDAP_DEBUG_FILTER, "begin test_substrings_filter\n");
 
@@ -836,7 +853,7 @@ static int test_substrings_filter(Operation *op, Entry *e, Filter *f) {
 
   rc = LDAP_COMPARE_FALSE;
 
-  for (a = attrs_find(e->e_attrs, f->f_sub_desc); a != NULL; a = attrs_find(a->a_next, f->f_sub_desc)) {
+  for (a = entry_attrs_find(e, f->f_sub_desc); a != NULL; a = attrs_find(a->a_next, f->f_sub_desc)) {
     MatchingRule *mr;
     struct berval *bv;
 
@@ -851,10 +868,17 @@ static int test_substrings_filter(Operation *op, Entry *e, Filter *f) {
       continue;
     }
 
+    /* a subtype may have a rule of its own */
+    if (fi && fi->fi_anchor.bv_len)
+      anchor = (mr == fi->fi_mr) ? &fi->fi_anchor : NULL;
+
     for (bv = a->a_nvals; !BER_BVISNULL(bv); bv++) {
       int ret, match;
       const char *text;
 
+      if (anchor && !memmem(bv->bv_val, bv->bv_len, anchor->bv_val, anchor->bv_len))
+        continue;
+
       ret = value_match(&match, a->a_desc, mr, SLAP_MR_SUBSTR, bv, f->f_sub, &text);
 
       if (ret != LDAP_SUCCESS) {
@@ -869,3 +893,256 @@ static int test_substrings_filter(Operation *op, Entry *e, Filter *f) {
   Debug(LDAP_DEBUG_FILTER, "end test_substrings_filter %d\n", rc);
   return rc;
 }
+
+/*
+ * Compiled filters.
+ *
+ * A search tests the same filter against every candidate entry, so
+ * filter_compile() flattens it once into an array of instructions in
+ * prefix order, each node followed by its operands.  The operands of
+ * AND and OR are reordered so that the cheaper tests come first and
+ * can short-circuit the costly ones, which doesn't change whether the
+ * filter matches, and substrings assertions carry their longest "any"
+ * piece, searched for with memmem() before the matching rule is called.
+ */
+
+enum {
+  FP_TEST, /* anything test_filter() knows better */
+  FP_COMPUTED,
+  FP_PRESENT,
+  FP_AVA,
+  FP_SUBSTRINGS,
+  FP_EXT,
+  FP_AND,
+  FP_OR,
+  FP_NOT
+};
+
+/* the relative costs */
+#define FP_COST_COMPUTED 0
+#define FP_COST_PRESENT 1
+#define FP_COST_EQUALITY 2
+#define FP_COST_ORDERING 3
+#define FP_COST_APPROX 4
+#define FP_COST_SUBSTRINGS 5
+#define FP_COST_EXT 6
+#define FP_COST_MAX FP_COST_EXT
+
+static unsigned filter_count(Filter *f) {
+  unsigned n = 1;
+
+  if (f->f_choice & SLAPD_FILTER_UNDEFINED)
+    return n;
+
+  switch (f->f_choice) {
+  case LDAP_FILTER_AND:
+  case LDAP_FILTER_OR:
+    for (f = f->f_list; f != NULL; f = f->f_next)
+      n += filter_count(f);
+    break;
+  case LDAP_FILTER_NOT:
+    n += filter_count(f->f_not);
+    break;
+  }
+  return n;
+}
+
+/* emit the node into fi and the following instructions */
+static void filter_emit(Operation *op, Filter *f, FilterInsn *fi) {
+  FilterInsn *sub, *tmp;
+  Filter *fo;
+  int sorted = 1, i;
+  unsigned cost;
+
+  fi->fi_code = FP_TEST;
+  fi->fi_cost = FP_COST_COMPUTED;
+  fi->fi_size = 1;
+  fi->fi_result = 0;
+  fi->fi_filter = f;
+  fi->fi_mr = NULL;
+  BER_BVZERO(&fi->fi_anchor);
+
+  if (f->f_choice & SLAPD_FILTER_UNDEFINED) {
+    fi->fi_code = FP_COMPUTED;
+    fi->fi_result = SLAPD_COMPARE_UNDEFINED;
+    return;
+  }
+
+  switch (f->f_choice) {
+  case SLAPD_FILTER_COMPUTED:
+    fi->fi_code = FP_COMPUTED;
+    fi->fi_result = f->f_result;
+    break;
+
+  case LDAP_FILTER_PRESENT:
+    fi->fi_code = FP_PRESENT;
+    fi->fi_cost = FP_COST_PRESENT;
+    break;
+
+  case LDAP_FILTER_EQUALITY:
+    fi->fi_code = FP_AVA;
+    fi->fi_cost = FP_COST_EQUALITY;
+    break;
+
+  case LDAP_FILTER_GE:
+  case LDAP_FILTER_LE:
+    fi->fi_code = FP_AVA;
+    fi->fi_cost = FP_COST_ORDERING;
+    break;
+
+  case LDAP_FILTER_APPROX:
+    fi->fi_code = FP_AVA;
+    fi->fi_cost = FP_COST_APPROX;
+    break;
+
+  case LDAP_FILTER_SUBSTRINGS:
+    fi->fi_code = FP_SUBSTRINGS;
+    fi->fi_cost = FP_COST_SUBSTRINGS;
+    fi->fi_mr = f->f_sub_desc->ad_type->sat_substr;
+    if (fi->fi_mr && f->f_sub->sa_any && mr_substr_literal(fi->fi_mr)) {
+      for (i = 0; !BER_BVISNULL(&f->f_sub->sa_any[i]); i++)
+        if (f->f_sub->sa_any[i].bv_len > fi->fi_anchor.bv_len)
+          fi->fi_anchor = f->f_sub->sa_any[i];
+    }
+    break;
+
+  case LDAP_FILTER_EXT:
+    fi->fi_code = FP_EXT;
+    fi->fi_cost = FP_COST_EXT;
+    break;
+
+  case LDAP_FILTER_NOT:
+    fi->fi_code = FP_NOT;
+    filter_emit(op, f->f_not, fi + 1);
+    fi->fi_cost = fi[1].fi_cost;
+    fi->fi_size += fi[1].fi_size;
+    break;
+
+  case LDAP_FILTER_AND:
+  case LDAP_FILTER_OR:
+    fi->fi_code = (f->f_choice == LDAP_FILTER_AND) ? FP_AND : FP_OR;
+    for (fo = f->f_list; fo != NULL; fo = fo->f_next) {
+      sub = fi + fi->fi_size;
+      filter_emit(op, fo, sub);
+      if (sub->fi_cost < fi->fi_cost)
+        sorted = 0;
+      else
+        fi->fi_cost = sub->fi_cost;
+      fi->fi_size += sub->fi_size;
+    }
+    if (sorted)
+      break;
+
+    /* move the operands in the order of their costs, keeping
+     * the order of the filter among those of the same cost */
+    tmp = op->o_tmpalloc((fi->fi_size - 1) * sizeof(FilterInsn), op->o_tmpmemctx);
+    memcpy(tmp, fi + 1, (fi->fi_size - 1) * sizeof(FilterInsn));
+    fi->fi_cost = FP_COST_COMPUTED;
+    sub = fi + 1;
+    for (cost = FP_COST_COMPUTED; cost <= FP_COST_MAX; cost++) {
+      FilterInsn *t;
+
+      for (t = tmp; t < tmp + fi->fi_size - 1; t += t->fi_size) {
+        if (t->fi_cost != cost)
+          continue;
+        memcpy(sub, t, t->fi_size * sizeof(FilterInsn));
+        sub += t->fi_size;
+        fi->fi_cost = cost;
+      }
+    }
+    op->o_tmpfree(tmp, op->o_tmpmemctx);
+    break;
+  }
+}
+
+/*
+ * filter_compile - compile a filter to be tested against many entries
+ * with test_filter_program(), until filter_program_free().  The filter
+ * itself must stay unchanged meanwhile.
+ */
+FilterProgram *filter_compile(Operation *op, Filter *f) {
+  unsigned n = filter_count(f);
+  FilterProgram *fp;
+
+  fp = op->o_tmpalloc(sizeof(FilterProgram) + (n - 1) * sizeof(FilterInsn), op->o_tmpmemctx);
+  fp->fp_len = n;
+  filter_emit(op, f, fp->fp_insn);
+  assert(fp->fp_insn[0].fi_size == n);
+
+  return fp;
+}
+
+void filter_program_free(Operation *op, FilterProgram *fp) { op->o_tmpfree(fp, op->o_tmpmemctx); }
+
+static int filter_run(Operation *op, Entry *e, FilterInsn *fi) {
+  FilterInsn *sub, *end = fi + fi->fi_size;
+  int rc, rtn;
+
+  switch (fi->fi_code) {
+  case FP_COMPUTED:
+    return fi->fi_result;
+
+  case FP_PRESENT:
+    return test_presence_filter(op, e, fi->fi_filter->f_desc);
+
+  case FP_AVA:
+    return test_ava_filter(op, e, fi->fi_filter->f_ava, fi->fi_filter->f_choice);
+
+  case FP_SUBSTRINGS:
+    return test_substrings_filter(op, e, fi->fi_filter, fi);
+
+  case FP_EXT:
+    return test_mra_filter(op, e, fi->fi_filter->f_mra);
+
+  case FP_NOT:
+    rc = filter_run(op, e, fi + 1);
+    switch (rc) {
+    case LDAP_COMPARE_TRUE:
+      rc = LDAP_COMPARE_FALSE;
+      break;
+    case LDAP_COMPARE_FALSE:
+      rc = LDAP_COMPARE_TRUE;
+      break;
+    }
+    return rc;
+
+  case FP_AND:
+    /* the same as test_filter_and() and test_filter_or() */
+    rtn = LDAP_COMPARE_TRUE;
+    for (sub = fi + 1; sub < end; sub += sub->fi_size) {
+      rc = filter_run(op, e, sub);
+      if (rc == LDAP_COMPARE_FALSE)
+        return rc;
+      if (rc != LDAP_COMPARE_TRUE)
+        rtn = rc;
+    }
+    return rtn;
+
+  case FP_OR:
+    rtn = LDAP_COMPARE_FALSE;
+    for (sub = fi + 1; sub < end; sub += sub->fi_size) {
+      rc = filter_run(op, e, sub);
+      if (rc == LDAP_COMPARE_TRUE)
+        return rc;
+      if (rc != LDAP_COMPARE_FALSE)
+        rtn = rc;
+    }
+    return rtn;
+  }
+
+  return test_filter(op, e, fi->fi_filter);
+}
+
+/*
+ * test_filter_program - test a compiled filter against a single entry.
+ * returns the same as test_filter(), but when the filter doesn't match,
+ * which reason is returned among several may differ.
+ */
+int test_filter_program(Operation *op, Entry *e, FilterProgram *fp) {
+  int rc;
+
+  Debug(LDAP_DEBUG_FILTER, "=> test_filter_program\n");
+  rc = filter_run(op, e, fp->fp_insn);
+  Debug(LDAP_DEBUG_FILTER, "<= test_filter_program %d\n", rc);
+  return rc;
+}
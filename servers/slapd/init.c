@@ -90,6 +90,12 @@ int slap_init(int mode, const char *name) {
   }
 
   quorum_global_init();
+  slap_qos_init();
+  slap_timer_init();
+  dn_cache_init();
+  acl_cache_init();
+  group_cache_init();
+  encode_cache_init();
 
   if (filter_init() != 0) {
     Debug(LDAP_DEBUG_ANY, "%s: filter_init failed\n", name);
@@ -209,6 +215,10 @@ int slap_destroy(void) {
    * because it may use entry_free() */
   root_dse_destroy();
   entry_destroy();
+  dn_cache_destroy();
+  acl_cache_destroy();
+  group_cache_destroy();
+  encode_cache_destroy();
 
   switch (slapMode & SLAP_MODE) {
   case SLAP_SERVER_MODE:
@@ -232,41 +242,43 @@ int slap_destroy(void) {
 }
 
 void slap_counters_init(slap_counters_t *sc) {
-  int i;
-
+  memset(sc, 0, sizeof(*sc));
   ldap_pvt_thread_mutex_init(&sc->sc_mutex);
-  ldap_pvt_mp_init(sc->sc_bytes);
-  ldap_pvt_mp_init(sc->sc_pdu);
-  ldap_pvt_mp_init(sc->sc_entries);
-  ldap_pvt_mp_init(sc->sc_refs);
+}
 
-  ldap_pvt_mp_init(sc->sc_ops_initiated);
-  ldap_pvt_mp_init(sc->sc_ops_completed);
+void slap_counters_destroy(slap_counters_t *sc) { ldap_pvt_thread_mutex_destroy(&sc->sc_mutex); }
 
+/* Add the counters of one shard to another */
+void slap_counters_merge(slap_counters_t *to, slap_counters_t *from) {
 #ifdef SLAPD_MONITOR
-  for (i = 0; i < SLAP_OP_LAST; i++) {
-    ldap_pvt_mp_init(sc->sc_ops_initiated_[i]);
-    ldap_pvt_mp_init(sc->sc_ops_completed_[i]);
-  }
+  int i, j, k;
 #endif /* SLAPD_MONITOR */
-}
 
-void slap_counters_destroy(slap_counters_t *sc) {
-  int i;
-
-  ldap_pvt_thread_mutex_destroy(&sc->sc_mutex);
-  ldap_pvt_mp_clear(sc->sc_bytes);
-  ldap_pvt_mp_clear(sc->sc_pdu);
-  ldap_pvt_mp_clear(sc->sc_entries);
-  ldap_pvt_mp_clear(sc->sc_refs);
-
-  ldap_pvt_mp_clear(sc->sc_ops_initiated);
-  ldap_pvt_mp_clear(sc->sc_ops_completed);
+  slap_counter_add(to->sc_bytes, slap_counter_get(from->sc_bytes));
+  slap_counter_add(to->sc_pdu, slap_counter_get(from->sc_pdu));
+  slap_counter_add(to->sc_entries, slap_counter_get(from->sc_entries));
+  slap_counter_add(to->sc_refs, slap_counter_get(from->sc_refs));
+  slap_counter_add(to->sc_ops_initiated, slap_counter_get(from->sc_ops_initiated));
+  slap_counter_add(to->sc_ops_completed, slap_counter_get(from->sc_ops_completed));
 
 #ifdef SLAPD_MONITOR
   for (i = 0; i < SLAP_OP_LAST; i++) {
-    ldap_pvt_mp_clear(sc->sc_ops_initiated_[i]);
-    ldap_pvt_mp_clear(sc->sc_ops_completed_[i]);
+    slap_counter_add(to->sc_ops_initiated_[i], slap_counter_get(from->sc_ops_initiated_[i]));
+    slap_counter_add(to->sc_ops_completed_[i], slap_counter_get(from->sc_ops_completed_[i]));
+    for (j = 0; j < SLAP_LATENCY_LAST; j++)
+      for (k = 0; k < SLAP_LATENCY_BUCKETS; k++)
+        slap_counter_add(to->sc_ops_latency_[i][j][k], slap_counter_get(from->sc_ops_latency_[i][j][k]));
   }
 #endif /* SLAPD_MONITOR */
 }
+
+/* Sum up the global counters and the shards of all threads */
+void slap_counters_sum(slap_counters_t *sum) {
+  slap_counters_t *sc;
+
+  memset(sum, 0, sizeof(*sum));
+  ldap_pvt_thread_mutex_lock(&slap_counters.sc_mutex);
+  for (sc = &slap_counters; sc; sc = sc->sc_next)
+    slap_counters_merge(sum, sc);
+  ldap_pvt_thread_mutex_unlock(&slap_counters.sc_mutex);
+}
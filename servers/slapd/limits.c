@@ -639,6 +639,15 @@ int limits_parse_one(const char *arg, struct slap_limits_set *limit) {
       return (1);
     }
 
+  } else if (STRSTART(arg, "queue=")) {
+    arg += STRLENOF("queue=");
+    if (strcasecmp(arg, "unlimited") == 0 || strcasecmp(arg, "none") == 0) {
+      limit->lms_q_delay = -1;
+
+    } else if (lutil_atoi(&limit->lms_q_delay, arg) != 0 || limit->lms_q_delay < 0) {
+      return (1);
+    }
+
   } else if (STRSTART(arg, "size")) {
     arg += STRLENOF("size");
 
@@ -841,7 +850,7 @@ int limits_unparse(struct slap_limits *lim, struct berval *bv, ber_len_t buflen)
     bv->bv_len = ptr - bv->bv_val;
     btmp.bv_val = ptr;
     btmp.bv_len = 0;
-    rc = limits_unparse_one(&lim->lm_limits, SLAP_LIMIT_SIZE | SLAP_LIMIT_TIME, &btmp, WHATSLEFT);
+    rc = limits_unparse_one(&lim->lm_limits, SLAP_LIMIT_SIZE | SLAP_LIMIT_TIME | SLAP_LIMIT_QUEUE, &btmp, WHATSLEFT);
     if (rc == 0)
       bv->bv_len += btmp.bv_len;
   }
@@ -941,6 +950,13 @@ int limits_unparse_one(struct slap_limits_set *lim, int which, struct berval *bv
         return -1;
     }
   }
+
+  if ((which & SLAP_LIMIT_QUEUE) && lim->lms_q_delay) {
+    if (ptr_APPEND_LIT(" queue="))
+      return -1;
+    if (lim->lms_q_delay == -1 ? ptr_APPEND_LIT("unlimited ") : ptr_APPEND_FMT1("%d ", lim->lms_q_delay))
+      return -1;
+  }
   if (ptr != bv->bv_val) {
     ptr--;
     *ptr = '\0';
@@ -950,6 +966,20 @@ int limits_unparse_one(struct slap_limits_set *lim, int which, struct berval *bv
   return 0;
 }
 
+/* Queue delay limit of the identity of op, in msec or SLAP_NO_LIMIT,
+ * 0 to use the admission target.  Only the global limits apply,
+ * since the request has not been decoded yet. */
+int limits_queue_delay(Operation *op) {
+  struct slap_limits_set *limit;
+  BackendDB *bd = op->o_bd;
+
+  op->o_bd = frontendDB;
+  limits_get(op, &limit);
+  op->o_bd = bd;
+
+  return limit->lms_q_delay;
+}
+
 int limits_check(Operation *op, SlapReply *rs) {
   assert(op != NULL);
   assert(rs != NULL);
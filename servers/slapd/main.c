@@ -118,6 +118,38 @@ static int slapd_opt_slp(const char *val, void *arg) {
 #endif
 }
 
+static int slapd_opt_event(const char *val, void *arg) {
+  if (val == NULL || strcasecmp(val, "default") == 0 || strcasecmp(val, "epoll") == 0) {
+    slapd_event_engine = SLAPD_EVENT_DEFAULT;
+  } else if (strcasecmp(val, "io_uring") == 0) {
+    slapd_event_engine = SLAPD_EVENT_IOURING;
+  } else {
+    fprintf(stderr, "unrecognized value \"%s\" for event option\n", val);
+    return -1;
+  }
+
+  return 0;
+}
+
+static int slapd_opt_reuseport(const char *val, void *arg) {
+#ifdef SO_REUSEPORT
+  if (val == NULL || strcasecmp(val, "on") == 0) {
+    slapd_reuseport = 1;
+  } else if (strcasecmp(val, "off") == 0) {
+    slapd_reuseport = 0;
+  } else {
+    fprintf(stderr, "unrecognized value \"%s\" for reuseport option\n", val);
+    return -1;
+  }
+
+  return 0;
+
+#else
+  fputs("slapd: SO_REUSEPORT is not available\n", stderr);
+  return 0;
+#endif
+}
+
 /*
  * Option helper structure:
  *
@@ -137,6 +169,9 @@ struct option_helper {
   void *oh_arg;
   const char *oh_usage;
 } option_helpers[] = {{BER_BVC("slp"), slapd_opt_slp, NULL, "slp[={on|off|(attrs)}] enable/disable SLP using (attrs)"},
+                      {BER_BVC("event"), slapd_opt_event, NULL, "event={epoll|io_uring} select the event engine"},
+                      {BER_BVC("reuseport"), slapd_opt_reuseport, NULL,
+                       "reuseport[={on|off}] give each listener thread its own SO_REUSEPORT socket"},
                       {BER_BVNULL, 0, NULL, NULL}};
 
 #ifdef LDAP_SYSLOG
@@ -975,6 +1010,8 @@ stop:
   filter_destroy();
 
   quorum_global_destroy();
+  slap_qos_destroy();
+  slap_timer_destroy();
 
   schema_destroy();
 
@@ -145,7 +145,10 @@ int do_modify(Operation *op, SlapReply *rs) {
   }
 
   op->o_bd = frontendDB;
+  slap_op_stamp(op, SLAP_STAMP_BACKEND);
   rs->sr_err = slap_biglock_call_be(op_modify, op, rs);
+  if (rs->sr_err != SLAPD_ASYNCOP)
+    slap_op_stamp(op, SLAP_STAMP_BACKEND_DONE);
   if (rs->sr_err == SLAPD_ASYNCOP) {
     /* skip cleanup */
     return rs->sr_err;
@@ -480,6 +483,14 @@ int slap_mods_check(Operation *op, Modifications *ml, const char **text, char *t
         }
 
         if (pretty) {
+          if (ml->sml_flags & SLAP_MOD_INPLACE) {
+            /* most values come already pretty */
+            if (bvmatch(&pval, &ml->sml_values[nvals])) {
+              ber_memfree_x(pval.bv_val, ctx);
+              continue;
+            }
+            slap_mod_own(&ml->sml_mod);
+          }
           ber_memfree_x(ml->sml_values[nvals].bv_val, ctx);
           ml->sml_values[nvals] = pval;
         }
@@ -876,7 +887,8 @@ int slap_parse_modlist(Operation *op, SlapReply *rs, BerElement *ber, req_modify
 
     tmp.sml_nvalues = NULL;
 
-    if (ber_scanf(ber, "{e{m[W]}}", &mop, &tmp.sml_type, &tmp.sml_values) == LBER_ERROR) {
+    /* the values are left in the PDU, which outlives the operation */
+    if (ber_scanf(ber, "{e{m[w]}}", &mop, &tmp.sml_type, &tmp.sml_values) == LBER_ERROR) {
       rs->sr_text = "decoding modlist error";
       rs->sr_err = LDAP_PROTOCOL_ERROR;
       goto done;
@@ -884,7 +896,7 @@ int slap_parse_modlist(Operation *op, SlapReply *rs, BerElement *ber, req_modify
 
     mod = (Modifications *)ch_malloc(sizeof(Modifications));
     mod->sml_op = mop;
-    mod->sml_flags = 0;
+    mod->sml_flags = tmp.sml_values ? SLAP_MOD_INPLACE : 0;
     mod->sml_type = tmp.sml_type;
     mod->sml_values = tmp.sml_values;
     mod->sml_nvalues = NULL;
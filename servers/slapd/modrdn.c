@@ -139,7 +139,10 @@ int do_modrdn(Operation *op, SlapReply *rs) {
   }
 
   op->o_bd = frontendDB;
+  slap_op_stamp(op, SLAP_STAMP_BACKEND);
   rs->sr_err = slap_biglock_call_be(op_modrdn, op, rs);
+  if (rs->sr_err != SLAPD_ASYNCOP)
+    slap_op_stamp(op, SLAP_STAMP_BACKEND_DONE);
 
   if (rs->sr_err == SLAPD_ASYNCOP) {
     /* skip cleanup */
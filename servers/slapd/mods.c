@@ -388,9 +388,26 @@ int modify_increment_values(Entry *e, Modification *mod, int permissive, const c
   return LDAP_SUCCESS;
 }
 
+/* Make the values of a modification decoded in-place its own, before
+ * they are changed, freed or moved elsewhere one by one */
+void slap_mod_own(Modification *mod) {
+  int i;
+
+  if (!(mod->sm_flags & SLAP_MOD_INPLACE))
+    return;
+
+  for (i = 0; mod->sm_values && !BER_BVISNULL(&mod->sm_values[i]); i++)
+    ber_dupbv(&mod->sm_values[i], &mod->sm_values[i]);
+  mod->sm_flags &= ~SLAP_MOD_INPLACE;
+}
+
 void slap_mod_free(Modification *mod, int freeit) {
-  if (mod->sm_values != NULL)
-    ber_bvarray_free(mod->sm_values);
+  if (mod->sm_values != NULL) {
+    if (mod->sm_flags & SLAP_MOD_INPLACE)
+      ch_free(mod->sm_values);
+    else
+      ber_bvarray_free(mod->sm_values);
+  }
   mod->sm_values = NULL;
 
   if (mod->sm_nvalues != NULL)
@@ -137,6 +137,47 @@ void slap_op_time(time_t *t, int *nop) {
   *nop = tv.tv_usec + sametick;
 }
 
+/* monotonic clock in nanoseconds */
+uint64_t slap_stamp_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * (uint64_t)1000000000ul + ts.tv_nsec;
+}
+
+void slap_op_stamp(Operation *op, slap_stamp_t stage) { op->o_stamp[stage] = slap_stamp_now(); }
+
+/* nanoseconds between two stages, 0 if either was not reached */
+uint64_t slap_op_elapsed(const Operation *op, slap_stamp_t from, slap_stamp_t to) {
+  if (!op->o_stamp[from] || op->o_stamp[to] < op->o_stamp[from])
+    return 0;
+  return op->o_stamp[to] - op->o_stamp[from];
+}
+
+#ifdef SLAPD_MONITOR
+static void slap_latency_add(uint64_t *hist, uint64_t ns) {
+  uint64_t us = ns / 1000;
+  int i = 0;
+
+  while (i < SLAP_LATENCY_BUCKETS - 1 && us > ((uint64_t)1 << i))
+    i++;
+  slap_counter_add(hist[i], 1);
+}
+
+/* Account the stages of a completed operation */
+void slap_op_latency(Operation *op, slap_op_t opidx) {
+  uint64_t(*hist)[SLAP_LATENCY_BUCKETS] = op->o_counters->sc_ops_latency_[opidx];
+
+  if (op->o_stamp[SLAP_STAMP_STARTED])
+    slap_latency_add(hist[SLAP_LATENCY_QUEUE], slap_op_elapsed(op, SLAP_STAMP_READ, SLAP_STAMP_STARTED));
+  if (op->o_stamp[SLAP_STAMP_BACKEND_DONE])
+    slap_latency_add(hist[SLAP_LATENCY_BACKEND], slap_op_elapsed(op, SLAP_STAMP_BACKEND, SLAP_STAMP_BACKEND_DONE));
+  if (!op->o_stamp[SLAP_STAMP_SENT])
+    slap_op_stamp(op, SLAP_STAMP_SENT);
+  slap_latency_add(hist[SLAP_LATENCY_TOTAL], slap_op_elapsed(op, SLAP_STAMP_READ, SLAP_STAMP_SENT));
+}
+#endif /* SLAPD_MONITOR */
+
 Operation *slap_op_alloc(BerElement *ber, ber_int_t msgid, ber_tag_t tag, ber_int_t id, void *ctx) {
   Operation *op = NULL;
 
@@ -162,7 +203,10 @@ Operation *slap_op_alloc(BerElement *ber, ber_int_t msgid, ber_tag_t tag, ber_in
   op->o_tag = tag;
 
   slap_op_time(&op->o_time, &op->o_tincr);
+  memset(op->o_stamp, 0, sizeof(op->o_stamp));
+  slap_op_stamp(op, SLAP_STAMP_READ);
   op->o_opid = id;
+  op->o_acl_gen = __atomic_load_n(&acl_cache_gen, __ATOMIC_ACQUIRE);
 
 #if defined(LDAP_SLAPI)
   if (slapi_plugins_used) {
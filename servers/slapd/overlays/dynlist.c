@@ -71,7 +71,7 @@ static dynlist_info_t *dynlist_is_dynlist_next(Operation *op, SlapReply *rs, dyn
     dli = old_dli->dli_next;
   }
 
-  a = attrs_find(rs->sr_entry->e_attrs, slap_schema.si_ad_objectClass);
+  a = entry_attrs_find(rs->sr_entry, slap_schema.si_ad_objectClass);
   if (a == NULL) {
     /* FIXME: objectClass must be present; for non-storage
      * backends, like back-ldap, it needs to be added
@@ -328,7 +328,7 @@ static int dynlist_prepare_entry(Operation *op, SlapReply *rs, dynlist_info_t *d
   dynlist_sc_t dlc = {0};
   dynlist_map_t *dlm;
 
-  a = attrs_find(rs->sr_entry->e_attrs, dli->dli_ad);
+  a = entry_attrs_find(rs->sr_entry, dli->dli_ad);
   if (a == NULL) {
     /* FIXME: error? */
     return SLAP_CB_CONTINUE;
@@ -346,13 +346,13 @@ static int dynlist_prepare_entry(Operation *op, SlapReply *rs, dynlist_info_t *d
   if (dli->dli_dlm && !dlm)
     return SLAP_CB_CONTINUE;
 
-  if (ad_dgIdentity && (id = attrs_find(rs->sr_entry->e_attrs, ad_dgIdentity))) {
+  if (ad_dgIdentity && (id = entry_attrs_find(rs->sr_entry, ad_dgIdentity))) {
     Attribute *authz = NULL;
 
     /* if not rootdn and dgAuthz is present,
      * check if user can be authorized as dgIdentity */
     if (ad_dgAuthz && !BER_BVISEMPTY(&id->a_nvals[0]) && !be_isroot(op) &&
-        (authz = attrs_find(rs->sr_entry->e_attrs, ad_dgAuthz))) {
+        (authz = entry_attrs_find(rs->sr_entry, ad_dgAuthz))) {
       if (slap_sasl_matches(op, authz->a_nvals, &o.o_ndn, &o.o_ndn) != LDAP_SUCCESS) {
         return SLAP_CB_CONTINUE;
       }
@@ -569,7 +569,7 @@ static int dynlist_sc_compare_entry(Operation *op, SlapReply *rs) {
   if (rs->sr_type == REP_SEARCH && rs->sr_entry != NULL) {
     dynlist_cc_t *dc = (dynlist_cc_t *)op->o_callback;
     AttributeAssertion *ava = dc->dc_ava;
-    Attribute *a = attrs_find(rs->sr_entry->e_attrs, ava->aa_desc);
+    Attribute *a = entry_attrs_find(rs->sr_entry, ava->aa_desc);
 
     if (a != NULL) {
       while (LDAP_SUCCESS !=
@@ -225,7 +225,7 @@ static int memberof_saveMember_cb(Operation *op, SlapReply *rs) {
     assert(rs->sr_entry != NULL);
     assert(rs->sr_entry->e_attrs != NULL);
 
-    a = attr_find(rs->sr_entry->e_attrs, mc->ad);
+    a = entry_attr_find(rs->sr_entry, mc->ad);
     if (a != NULL) {
       ber_bvarray_dup_x(&mc->vals, a->a_nvals, op->o_tmpmemctx);
 
@@ -871,6 +871,7 @@ static int memberof_op_modify(Operation *op, SlapReply *rs) {
 
               for (j = i + 1; !BER_BVISNULL(&ml->sml_nvalues[j]); j++)
                 ;
+              slap_mod_own(&ml->sml_mod);
               ber_memfree(ml->sml_values[i].bv_val);
               BER_BVZERO(&ml->sml_values[i]);
               ber_memfree(ml->sml_nvalues[i].bv_val);
@@ -963,6 +964,7 @@ static int memberof_op_modify(Operation *op, SlapReply *rs) {
 
               for (j = i + 1; !BER_BVISNULL(&ml->sml_nvalues[j]); j++)
                 ;
+              slap_mod_own(&ml->sml_mod);
               ber_memfree(ml->sml_values[i].bv_val);
               BER_BVZERO(&ml->sml_values[i]);
               if (ml->sml_nvalues != ml->sml_values) {
@@ -1070,6 +1072,7 @@ static int memberof_op_modify(Operation *op, SlapReply *rs) {
 
             for (j = i + 1; !BER_BVISNULL(&ml->sml_nvalues[j]); j++)
               ;
+            slap_mod_own(&ml->sml_mod);
             ber_memfree(ml->sml_values[i].bv_val);
             BER_BVZERO(&ml->sml_values[i]);
             if (ml->sml_nvalues != ml->sml_values) {
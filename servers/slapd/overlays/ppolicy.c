@@ -1901,6 +1901,7 @@ static int ppolicy_modify(Operation *op, SlapReply *rs) {
        * replace the delete value with the (possibly hashed)
        * value which is currently in the password.
        */
+      slap_mod_own(&delmod->sml_mod);
       for (i = 0; !BER_BVISNULL(&delmod->sml_values[i]); i++) {
         free(delmod->sml_values[i].bv_val);
         BER_BVZERO(&delmod->sml_values[i]);
@@ -2158,6 +2159,7 @@ do_modify:
         rs->sr_text = txt;
         goto return_results;
       }
+      slap_mod_own(&addmod->sml_mod);
       bv = addmod->sml_values[0];
       /* clear and discard the clear password */
       memset(bv.bv_val, 0, bv.bv_len);
@@ -526,6 +526,7 @@ static int rwm_op_modify(Operation *op, SlapReply *rs) {
       *ml = **mlp;
       if ((*mlp)->sml_values) {
         ber_bvarray_dup_x(&ml->sml_values, (*mlp)->sml_values, NULL);
+        ml->sml_flags &= ~SLAP_MOD_INPLACE;
         if ((*mlp)->sml_nvalues) {
           ber_bvarray_dup_x(&ml->sml_nvalues, (*mlp)->sml_nvalues, NULL);
         }
@@ -559,6 +560,7 @@ static int rwm_op_modify(Operation *op, SlapReply *rs) {
         ber_dupbv(&bva[i], &ml->sml_values[i]);
       BER_BVZERO(&bva[i]);
       ml->sml_values = bva;
+      ml->sml_flags &= ~SLAP_MOD_INPLACE;
 
       if (ml->sml_nvalues) {
         bva = ch_malloc((num + 1) * sizeof(struct berval));
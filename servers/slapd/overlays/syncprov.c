@@ -1940,11 +1940,33 @@ static int syncprov_playlog(Operation *op, sessionlog *sl, sync_control *srs, Be
     for (i = ndel; i < num; i++) {
       if (uuids[i].bv_len != 0) {
         SlapReply frs = {REP_RESULT};
+        struct berval dn, ndn;
 
         mf.f_av_value = uuids[i];
         cb.sc_private = NULL;
         fop.ors_slimit = 1;
-        rc = fop.o_bd->be_search(&fop, &frs);
+        /* Narrow the search down to the entry when the backend
+         * can resolve the UUID directly. */
+        switch (be_uuid2dn(&fop, &uuids[i], &dn, &ndn)) {
+        case LDAP_NO_SUCH_OBJECT:
+          break;
+        case LDAP_SUCCESS:
+          if (dnIsSuffixScope(&ndn, &op->o_req_ndn, op->ors_scope)) {
+            fop.o_req_dn = dn;
+            fop.o_req_ndn = ndn;
+            fop.ors_scope = LDAP_SCOPE_BASE;
+            rc = fop.o_bd->be_search(&fop, &frs);
+            fop.o_req_dn = op->o_req_dn;
+            fop.o_req_ndn = op->o_req_ndn;
+            fop.ors_scope = op->ors_scope;
+          }
+          op->o_tmpfree(dn.bv_val, op->o_tmpmemctx);
+          op->o_tmpfree(ndn.bv_val, op->o_tmpmemctx);
+          break;
+        default:
+          rc = fop.o_bd->be_search(&fop, &frs);
+          break;
+        }
         /* ignore result */
 
         /* If entry was not found, add to delete list */
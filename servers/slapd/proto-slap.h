@@ -82,8 +82,18 @@ slap_access_always_allowed(Operation *op, Entry *e, AttributeDescription *desc,
                            slap_access_t access, AccessControlState *state, slap_mask_t *maskp);
 
 LDAP_SLAPD_F(int) acl_check_modlist(Operation *op, Entry *e, Modifications *ml);
+LDAP_SLAPD_F(int) acl_reads_attr(BackendDB *be, struct berval *ndn, AttributeDescription *desc);
+LDAP_SLAPD_F(int) acl_entry_decidable(Operation *op, Entry *e);
+
+LDAP_SLAPD_V(unsigned) acl_cache_max;
+LDAP_SLAPD_V(unsigned) acl_cache_gen;
+LDAP_SLAPD_F(void) acl_cache_init(void);
+LDAP_SLAPD_F(void) acl_cache_invalidate(void);
+LDAP_SLAPD_F(void) acl_cache_destroy(void);
 
 LDAP_SLAPD_F(void) acl_append(AccessControl **l, AccessControl *a, int pos);
+LDAP_SLAPD_F(void) acl_index_build(AccessControl *head);
+LDAP_SLAPD_F(void) acl_index_free(AclIndex *ai);
 
 #ifdef SLAP_DYNACL
 LDAP_SLAPD_F(int) slap_dynacl_register(slap_dynacl_t *da);
@@ -259,6 +269,10 @@ LDAP_SLAPD_F(int)
 attr_merge_normalize_one(Entry *e, AttributeDescription *desc, struct berval *val, void *memctx);
 LDAP_SLAPD_F(Attribute *) attrs_find(Attribute *a, AttributeDescription *desc);
 LDAP_SLAPD_F(Attribute *) attr_find(Attribute *a, AttributeDescription *desc);
+LDAP_SLAPD_F(size_t) attr_index_size(int nattrs);
+LDAP_SLAPD_F(void) attr_index_init(Entry *e, void *mem, int nattrs);
+LDAP_SLAPD_F(Attribute *) entry_attrs_find(Entry *e, AttributeDescription *desc);
+LDAP_SLAPD_F(Attribute *) entry_attr_find(Entry *e, AttributeDescription *desc);
 LDAP_SLAPD_F(int) attr_delete(Attribute **attrs, AttributeDescription *desc);
 
 LDAP_SLAPD_F(void) attr_clean(Attribute *a);
@@ -330,6 +344,9 @@ LDAP_SLAPD_F(int) be_isupdate_dn(Backend *be, struct berval *ndn);
 LDAP_SLAPD_F(struct berval *) be_root_dn(Backend *be);
 LDAP_SLAPD_F(int)
 be_entry_get_rw(Operation *o, struct berval *ndn, ObjectClass *oc, AttributeDescription *at, int rw, Entry **e);
+LDAP_SLAPD_F(int) be_uuid2dn(Operation *o, struct berval *uuid, struct berval *dn, struct berval *ndn);
+LDAP_SLAPD_F(int)
+be_entry_valfind(Operation *o, struct berval *ndn, ObjectClass *oc, AttributeDescription *at, struct berval *nval);
 
 #ifndef USE_RS_ASSERT
 #define USE_RS_ASSERT LDAP_CHECK
@@ -362,6 +379,17 @@ LDAP_SLAPD_F(int)
 backend_group(Operation *op, Entry *target, struct berval *gr_ndn, struct berval *op_ndn, ObjectClass *group_oc,
               AttributeDescription *group_at);
 
+LDAP_SLAPD_V(unsigned) group_cache_max;
+LDAP_SLAPD_V(unsigned) group_cache_ttl;
+LDAP_SLAPD_F(void) group_cache_init(void);
+LDAP_SLAPD_F(void) group_cache_destroy(void);
+LDAP_SLAPD_F(int)
+group_cache_get(Operation *op, BackendDB *be, struct berval *group, ObjectClass *oc, AttributeDescription *at,
+                struct berval *op_ndn, struct berval *endn, int *res);
+LDAP_SLAPD_F(void)
+group_cache_put(Operation *op, BackendDB *be, struct berval *group, ObjectClass *oc, AttributeDescription *at,
+                struct berval *op_ndn, struct berval *endn, int res);
+
 LDAP_SLAPD_F(int)
 backend_attribute(Operation *op, Entry *target, struct berval *entry_ndn, AttributeDescription *entry_at,
                   BerVarray *vals, slap_access_t access);
@@ -612,7 +640,8 @@ LDAP_SLAPD_V(int) slapi_plugins_used;
 LDAP_SLAPD_F(int) connections_init(void);
 LDAP_SLAPD_F(int) connections_shutdown(int gentle_shutdown_only);
 LDAP_SLAPD_F(int) connections_destroy(void);
-LDAP_SLAPD_F(int) connections_timeout_idle(slap_time_t);
+LDAP_SLAPD_F(void) connections_timeout_arm(void);
+LDAP_SLAPD_F(void) connection_timer_arm(Connection *c);
 LDAP_SLAPD_F(void) connections_drop(void);
 
 LDAP_SLAPD_F(Connection *)
@@ -688,6 +717,18 @@ LDAP_SLAPD_F(void) slap_op_csn_free(Operation *op);
 LDAP_SLAPD_F(void) slap_op_csn_clean(Operation *op);
 LDAP_SLAPD_F(void) slap_op_csn_assign(Operation *op, BerValue *csn);
 
+/*
+ * qos.c
+ */
+
+LDAP_SLAPD_V(QosClass *) slap_qos_classes;
+LDAP_SLAPD_F(void) slap_qos_init(void);
+LDAP_SLAPD_F(void) slap_qos_destroy(void);
+LDAP_SLAPD_F(int) slap_qos_admit(Operation *op);
+LDAP_SLAPD_F(Operation *) slap_qos_next(QosClass *qc);
+LDAP_SLAPD_F(int) slap_admission_check(Operation *op);
+LDAP_SLAPD_V(unsigned) slap_admission_target;
+
 /*
  * quorum.c
  */
@@ -719,7 +760,7 @@ LDAP_SLAPD_F(int) quorum_syncrepl_maxrefresh(BackendDB *bd);
 /*
  * daemon.c
  */
-LDAP_SLAPD_F(void) slapd_add_internal(ber_socket_t s, int isactive);
+LDAP_SLAPD_F(void) slapd_add_internal(ber_socket_t s, int isactive, Listener *from);
 LDAP_SLAPD_F(int) slapd_daemon_init(const char *urls);
 LDAP_SLAPD_F(int) slapd_daemon_destroy(void);
 LDAP_SLAPD_F(int) slapd_daemon(void);
@@ -743,10 +784,6 @@ LDAP_SLAPD_F(void) slapd_set_read(ber_socket_t s, int wake);
 LDAP_SLAPD_F(int) slapd_clr_read(ber_socket_t s, int wake);
 LDAP_SLAPD_F(int) slapd_wait_writer(ber_socket_t sd);
 LDAP_SLAPD_F(void) slapd_shutsock(ber_socket_t sd);
-#ifdef SLAPD_WRITE_TIMEOUT
-LDAP_SLAPD_F(void) slapd_clr_writetime(slap_time_t old);
-LDAP_SLAPD_F(slap_time_t) slapd_get_writetime(void);
-#endif /* SLAPD_WRITE_TIMEOUT */
 
 #ifdef __SANITIZE_THREAD__
 
@@ -786,6 +823,8 @@ LDAP_SLAPD_V(slap_ssf_t) local_ssf;
 LDAP_SLAPD_V(struct runqueue_s) slapd_rq;
 LDAP_SLAPD_V(int) slapd_daemon_threads;
 LDAP_SLAPD_V(int) slapd_daemon_mask;
+LDAP_SLAPD_V(int) slapd_event_engine;
+LDAP_SLAPD_V(int) slapd_reuseport;
 #ifdef LDAP_TCP_BUFFER
 LDAP_SLAPD_V(int) slapd_tcp_rmem;
 LDAP_SLAPD_V(int) slapd_tcp_wmem;
@@ -799,6 +838,11 @@ LDAP_SLAPD_V(int) slapd_tcp_wmem;
 #define bvmatch(bv1, bv2)                                                                                              \
   (((bv1)->bv_len == (bv2)->bv_len) && (memcmp((bv1)->bv_val, (bv2)->bv_val, (bv1)->bv_len) == 0))
 
+LDAP_SLAPD_V(unsigned) dn_cache_max;
+LDAP_SLAPD_F(void) dn_cache_init(void);
+LDAP_SLAPD_F(void) dn_cache_flush(void);
+LDAP_SLAPD_F(void) dn_cache_destroy(void);
+
 LDAP_SLAPD_F(int) dnValidate(Syntax *syntax, struct berval *val);
 LDAP_SLAPD_F(int) rdnValidate(Syntax *syntax, struct berval *val);
 
@@ -979,6 +1023,9 @@ LDAP_SLAPD_F(void) filter_destroy(void);
  */
 
 LDAP_SLAPD_F(int) test_filter(Operation *op, Entry *e, Filter *f);
+LDAP_SLAPD_F(FilterProgram *) filter_compile(Operation *op, Filter *f);
+LDAP_SLAPD_F(int) test_filter_program(Operation *op, Entry *e, FilterProgram *fp);
+LDAP_SLAPD_F(void) filter_program_free(Operation *op, FilterProgram *fp);
 
 /*
  * frontend.c
@@ -1015,6 +1062,8 @@ LDAP_SLAPD_F(int) slap_shutdown(Backend *be);
 LDAP_SLAPD_F(int) slap_destroy(void);
 LDAP_SLAPD_F(void) slap_counters_init(slap_counters_t *sc);
 LDAP_SLAPD_F(void) slap_counters_destroy(slap_counters_t *sc);
+LDAP_SLAPD_F(void) slap_counters_merge(slap_counters_t *to, slap_counters_t *from);
+LDAP_SLAPD_F(void) slap_counters_sum(slap_counters_t *sum);
 
 LDAP_SLAPD_V(const char *) slap_known_controls[];
 
@@ -1087,6 +1136,7 @@ limits_parse(Backend *be, const char *fname, int lineno, int argc, char **argv);
 LDAP_SLAPD_F(int)
 limits_parse_one(const char *arg, struct slap_limits_set *limit);
 LDAP_SLAPD_F(int) limits_check(Operation *op, SlapReply *rs);
+LDAP_SLAPD_F(int) limits_queue_delay(Operation *op);
 LDAP_SLAPD_F(int)
 limits_unparse_one(struct slap_limits_set *limit, int which, struct berval *bv, ber_len_t buflen);
 LDAP_SLAPD_F(int)
@@ -1165,6 +1215,7 @@ modify_replace_values(Entry *e, Modification *mod, int permissive, const char **
 LDAP_SLAPD_F(int)
 modify_increment_values(Entry *e, Modification *mod, int permissive, const char **text, char *textbuf, size_t textlen);
 
+LDAP_SLAPD_F(void) slap_mod_own(Modification *mod);
 LDAP_SLAPD_F(void) slap_mod_free(Modification *mod, int freeit);
 LDAP_SLAPD_F(void) slap_mods_free(Modifications *mods, int freevals);
 LDAP_SLAPD_F(void) slap_modlist_free(LDAPModList *ml);
@@ -1285,6 +1336,12 @@ LDAP_SLAPD_F(void) slap_op_destroy(void);
 LDAP_SLAPD_F(void) slap_op_groups_free(Operation *op);
 LDAP_SLAPD_F(void) slap_op_free(Operation *op, void *ctx);
 LDAP_SLAPD_F(void) slap_op_time(time_t *t, int *n);
+LDAP_SLAPD_F(uint64_t) slap_stamp_now(void);
+LDAP_SLAPD_F(void) slap_op_stamp(Operation *op, slap_stamp_t stage);
+LDAP_SLAPD_F(uint64_t) slap_op_elapsed(const Operation *op, slap_stamp_t from, slap_stamp_t to);
+#ifdef SLAPD_MONITOR
+LDAP_SLAPD_F(void) slap_op_latency(Operation *op, slap_op_t opidx);
+#endif /* SLAPD_MONITOR */
 LDAP_SLAPD_F(Operation *)
 slap_op_alloc(BerElement *ber, ber_int_t msgid, ber_tag_t tag, ber_int_t id, void *ctx);
 
@@ -1399,6 +1456,14 @@ LDAP_SLAPD_F(void) slap_send_ldap_intermediate(Operation *op, SlapReply *rs);
 LDAP_SLAPD_F(void) slap_send_search_result(Operation *op, SlapReply *rs);
 LDAP_SLAPD_F(int) slap_send_search_reference(Operation *op, SlapReply *rs);
 LDAP_SLAPD_F(int) slap_send_search_entry(Operation *op, SlapReply *rs);
+LDAP_SLAPD_V(unsigned) encode_cache_max;
+LDAP_SLAPD_F(void) encode_cache_init(void);
+LDAP_SLAPD_F(void) encode_cache_destroy(void);
+LDAP_SLAPD_F(void) slap_writebatch_begin(Operation *op);
+LDAP_SLAPD_F(void) slap_writebatch_end(Operation *op);
+LDAP_SLAPD_F(int) slap_writequeue_drain(Connection *conn);
+LDAP_SLAPD_F(void) slap_writebatch_timeout(slap_timer_t *t);
+LDAP_SLAPD_V(ber_len_t) slap_writequeue_size;
 LDAP_SLAPD_F(int) slap_null_cb(Operation *op, SlapReply *rs);
 LDAP_SLAPD_F(int) slap_freeself_cb(Operation *op, SlapReply *rs);
 
@@ -1532,6 +1597,7 @@ LDAP_SLAPD_F(int) slap_hash64(int);
 
 LDAP_SLAPD_F(slap_mr_indexer_func) octetStringIndexer;
 LDAP_SLAPD_F(slap_mr_filter_func) octetStringFilter;
+LDAP_SLAPD_F(int) mr_substr_literal(MatchingRule *mr);
 
 LDAP_SLAPD_F(int) numericoidValidate(Syntax *syntax, struct berval *in);
 LDAP_SLAPD_F(int) numericStringValidate(Syntax *syntax, struct berval *in);
@@ -1629,6 +1695,15 @@ LDAP_SLAPD_F(void) syn_delete(Syntax *at);
 LDAP_SLAPD_F(void)
 syn_unparse(BerVarray *bva, Syntax *start, Syntax *end, int system);
 
+/*
+ * timer.c
+ */
+LDAP_SLAPD_F(void) slap_timer_init(void);
+LDAP_SLAPD_F(void) slap_timer_destroy(void);
+LDAP_SLAPD_F(void) slap_timer_arm(slap_timer_t *t, slap_time_t when);
+LDAP_SLAPD_F(void) slap_timer_disarm(slap_timer_t *t);
+LDAP_SLAPD_F(slap_time_t) slap_timer_run(slap_time_t now);
+
 /*
  * user.c
  */
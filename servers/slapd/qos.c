@@ -0,0 +1,461 @@
+/* $ReOpenLDAP$ */
+/* Copyright 2018 ReOpenLDAP AUTHORS: please see AUTHORS file.
+ * All rights reserved.
+ *
+ * This file is part of ReOpenLDAP.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the OpenLDAP
+ * Public License.
+ *
+ * A copy of this license is available in the file LICENSE in the
+ * top-level directory of the distribution or, alternatively, at
+ * <http://www.OpenLDAP.org/license.html>.
+ */
+
+/* qos.c - operation classes, their share of the connection pool
+ * and admission to it */
+
+#include "reldap.h"
+
+#include <stdio.h>
+
+#include <ac/ctype.h>
+#include <ac/regex.h>
+#include <ac/string.h>
+
+#include "slap.h"
+#include "proto-slap.h"
+
+#include "lutil.h"
+#include "slapconfig.h"
+
+/* Without any class configured operations go straight to the pool,
+ * exactly as before.  Once there is one, every operation is classified
+ * when it is activated and admitted while its class is under its thread
+ * quota and a slot is free.  Otherwise it waits in the class FIFO; a
+ * released slot goes to the eligible class picked by smooth weighted
+ * round-robin.  One pool thread is left out of the slots, so requests
+ * keep being read and classified while all slots are busy. */
+#define SLAP_QOS_SLOTS (connection_pool_max > 1 ? connection_pool_max - 1 : 1)
+
+QosClass *slap_qos_classes;
+
+static QosClass slap_qos_default = {NULL, BER_BVC("default"), 1, 0};
+static ldap_pvt_thread_mutex_t slap_qos_mutex;
+static int slap_qos_executing;
+
+static const char *const slap_qos_opnames[] = {"bind",   "unbind", "search",  "compare",  "modify",
+                                               "modrdn", "add",    "delete",  "abandon", "extended"};
+
+void slap_qos_init(void) {
+  ldap_pvt_thread_mutex_init(&slap_qos_mutex);
+  LDAP_STAILQ_INIT(&slap_qos_default.qc_waiting);
+}
+
+static void slap_qos_free(QosClass *qc) {
+  ch_free(qc->qc_name.bv_val);
+  if (!BER_BVISNULL(&qc->qc_pat)) {
+    if ((qc->qc_style & SLAP_LIMITS_MASK) == SLAP_LIMITS_REGEX)
+      regfree(&qc->qc_regex);
+    ch_free(qc->qc_pat.bv_val);
+  }
+  if (!BER_BVISNULL(&qc->qc_peer)) {
+    regfree(&qc->qc_peer_regex);
+    ch_free(qc->qc_peer.bv_val);
+  }
+  ch_free(qc);
+}
+
+void slap_qos_destroy(void) {
+  QosClass *qc;
+
+  while ((qc = slap_qos_classes) != NULL) {
+    slap_qos_classes = qc->qc_next;
+    slap_qos_free(qc);
+  }
+  ldap_pvt_thread_mutex_destroy(&slap_qos_mutex);
+}
+
+static int slap_qos_match(QosClass *qc, Operation *op) {
+  struct berval *ndn = &op->o_ndn;
+  slap_op_t opidx;
+
+  if (qc->qc_ops) {
+    opidx = slap_req2op(op->o_tag);
+    if (opidx == SLAP_OP_LAST || !(qc->qc_ops & (1U << opidx)))
+      return 0;
+  }
+
+  if (!BER_BVISNULL(&qc->qc_peer) && regexec(&qc->qc_peer_regex, op->o_conn->c_peer_name.bv_val, 0, NULL, 0) != 0)
+    return 0;
+
+  switch (qc->qc_style & SLAP_LIMITS_MASK) {
+  case SLAP_LIMITS_UNDEFINED:
+  case SLAP_LIMITS_ANY:
+    return 1;
+  case SLAP_LIMITS_ANONYMOUS:
+    return BER_BVISEMPTY(ndn);
+  case SLAP_LIMITS_USERS:
+    return !BER_BVISEMPTY(ndn);
+  case SLAP_LIMITS_REGEX:
+    return !BER_BVISEMPTY(ndn) && regexec(&qc->qc_regex, ndn->bv_val, 0, NULL, 0) == 0;
+  default:
+    return !BER_BVISEMPTY(ndn) && dnIsSuffixScope(ndn, &qc->qc_pat, qc->qc_scope);
+  }
+}
+
+/* Pick the class to get the next slot, with mutex held */
+static QosClass *slap_qos_pick(void) {
+  QosClass *qc, *best = NULL;
+  int total = 0;
+
+  for (qc = slap_qos_classes;; qc = qc->qc_next) {
+    if (qc == NULL)
+      qc = &slap_qos_default;
+    if (qc->qc_nwaiting && (!qc->qc_threads || qc->qc_active < qc->qc_threads)) {
+      qc->qc_credit += qc->qc_weight;
+      total += qc->qc_weight;
+      if (!best || qc->qc_credit > best->qc_credit)
+        best = qc;
+    }
+    if (qc == &slap_qos_default)
+      break;
+  }
+  if (best)
+    best->qc_credit -= total;
+  return best;
+}
+
+/* Classify the operation and take a slot for it.  Returns 0 if it
+ * has been queued in its class instead, to be handed out later by
+ * slap_qos_next(). */
+int slap_qos_admit(Operation *op) {
+  QosClass *qc;
+
+  for (qc = slap_qos_classes; qc && !slap_qos_match(qc, op); qc = qc->qc_next)
+    ;
+  if (!qc)
+    qc = &slap_qos_default;
+  op->o_qos = qc;
+
+  ldap_pvt_thread_mutex_lock(&slap_qos_mutex);
+  if (qc->qc_nwaiting || (qc->qc_threads && qc->qc_active >= qc->qc_threads) ||
+      slap_qos_executing >= SLAP_QOS_SLOTS) {
+    LDAP_STAILQ_INSERT_TAIL(&qc->qc_waiting, op, o_qos_next);
+    qc->qc_nwaiting++;
+    qc->qc_delayed++;
+    ldap_pvt_thread_mutex_unlock(&slap_qos_mutex);
+    return 0;
+  }
+  qc->qc_active++;
+  qc->qc_dispatched++;
+  slap_qos_executing++;
+  ldap_pvt_thread_mutex_unlock(&slap_qos_mutex);
+  return 1;
+}
+
+/* Give back the slot of an operation of class qc, if any, and return
+ * a queued operation that now holds a slot and should be submitted. */
+Operation *slap_qos_next(QosClass *qc) {
+  Operation *op = NULL;
+
+  ldap_pvt_thread_mutex_lock(&slap_qos_mutex);
+  if (qc) {
+    qc->qc_active--;
+    slap_qos_executing--;
+  }
+  if (slap_qos_executing < SLAP_QOS_SLOTS && (qc = slap_qos_pick()) != NULL) {
+    op = LDAP_STAILQ_FIRST(&qc->qc_waiting);
+    LDAP_STAILQ_REMOVE_HEAD(&qc->qc_waiting, o_qos_next);
+    qc->qc_nwaiting--;
+    qc->qc_active++;
+    qc->qc_dispatched++;
+    slap_qos_executing++;
+  }
+  ldap_pvt_thread_mutex_unlock(&slap_qos_mutex);
+  return op;
+}
+
+static int slap_qos_unparse(QosClass *qc, int i, struct berval *bv) {
+  char buf[SLAP_TEXT_BUFLEN * 2], *ptr = buf, *end = buf + sizeof(buf);
+  int len, j;
+
+  len = snprintf(ptr, end - ptr, "{%d}%s weight=%d threads=%d", i, qc->qc_name.bv_val, qc->qc_weight,
+                 qc->qc_threads);
+  if (len < 0 || len >= end - ptr)
+    return -1;
+  ptr += len;
+
+  switch (qc->qc_style & SLAP_LIMITS_MASK) {
+  case SLAP_LIMITS_UNDEFINED:
+    len = 0;
+    break;
+  case SLAP_LIMITS_ANY:
+    len = snprintf(ptr, end - ptr, " *");
+    break;
+  case SLAP_LIMITS_ANONYMOUS:
+    len = snprintf(ptr, end - ptr, " anonymous");
+    break;
+  case SLAP_LIMITS_USERS:
+    len = snprintf(ptr, end - ptr, " users");
+    break;
+  case SLAP_LIMITS_REGEX:
+    len = snprintf(ptr, end - ptr, " dn.regex=\"%s\"", qc->qc_pat.bv_val);
+    break;
+  default:
+    len = snprintf(ptr, end - ptr, " dn.%s=\"%s\"", ldap_pvt_scope2str(qc->qc_scope), qc->qc_pat.bv_val);
+    break;
+  }
+  if (len < 0 || len >= end - ptr)
+    return -1;
+  ptr += len;
+
+  if (!BER_BVISNULL(&qc->qc_peer)) {
+    len = snprintf(ptr, end - ptr, " peername.regex=\"%s\"", qc->qc_peer.bv_val);
+    if (len < 0 || len >= end - ptr)
+      return -1;
+    ptr += len;
+  }
+
+  if (qc->qc_ops) {
+    char sep = '=';
+    if (end - ptr < 4)
+      return -1;
+    ptr = lutil_strcopy(ptr, " op");
+    for (j = 0; j < SLAP_OP_LAST; j++) {
+      if (qc->qc_ops & (1U << j)) {
+        len = snprintf(ptr, end - ptr, "%c%s", sep, slap_qos_opnames[j]);
+        if (len < 0 || len >= end - ptr)
+          return -1;
+        ptr += len;
+        sep = ',';
+      }
+    }
+  }
+
+  ber_str2bv(buf, ptr - buf, 1, bv);
+  return 0;
+}
+
+static int slap_qos_parse(ConfigArgs *c, QosClass *qc) {
+  int i, j;
+
+  qc->qc_weight = 1;
+  for (i = 2; i < c->argc; i++) {
+    char *arg = c->argv[i], *next;
+
+    if (strncasecmp(arg, "weight=", STRLENOF("weight=")) == 0) {
+      if (lutil_atoi(&qc->qc_weight, arg + STRLENOF("weight=")) != 0 || qc->qc_weight < 1 || qc->qc_weight > 1000) {
+        snprintf(c->cr_msg, sizeof(c->cr_msg), "<%s> weight must be 1..1000", c->argv[0]);
+        return 1;
+      }
+
+    } else if (strncasecmp(arg, "threads=", STRLENOF("threads=")) == 0) {
+      if (lutil_atoi(&qc->qc_threads, arg + STRLENOF("threads=")) != 0 || qc->qc_threads < 0) {
+        snprintf(c->cr_msg, sizeof(c->cr_msg), "<%s> invalid threads", c->argv[0]);
+        return 1;
+      }
+
+    } else if (strncasecmp(arg, "op=", STRLENOF("op=")) == 0) {
+      for (arg += STRLENOF("op="); *arg; arg = next) {
+        next = strchr(arg, ',');
+        if (next == NULL)
+          next = arg + strlen(arg);
+        for (j = 0; j < SLAP_OP_LAST; j++) {
+          if (strlen(slap_qos_opnames[j]) == (size_t)(next - arg) && strncasecmp(arg, slap_qos_opnames[j], next - arg) == 0)
+            break;
+        }
+        if (j == SLAP_OP_LAST) {
+          snprintf(c->cr_msg, sizeof(c->cr_msg), "<%s> unknown operation \"%.*s\"", c->argv[0], (int)(next - arg), arg);
+          return 1;
+        }
+        qc->qc_ops |= 1U << j;
+        if (*next)
+          next++;
+      }
+
+    } else if (strncasecmp(arg, "peername", STRLENOF("peername")) == 0) {
+      arg += STRLENOF("peername");
+      if (strncasecmp(arg, ".regex", STRLENOF(".regex")) == 0)
+        arg += STRLENOF(".regex");
+      if (*arg != '=' || !BER_BVISNULL(&qc->qc_peer)) {
+        snprintf(c->cr_msg, sizeof(c->cr_msg), "<%s> invalid peername selector", c->argv[0]);
+        return 1;
+      }
+      if (regcomp(&qc->qc_peer_regex, arg + 1, REG_EXTENDED | REG_ICASE | REG_NOSUB)) {
+        snprintf(c->cr_msg, sizeof(c->cr_msg), "<%s> invalid peername regex", c->argv[0]);
+        return 1;
+      }
+      ber_str2bv(arg + 1, 0, 1, &qc->qc_peer);
+
+    } else if (qc->qc_style != SLAP_LIMITS_UNDEFINED) {
+      snprintf(c->cr_msg, sizeof(c->cr_msg), "<%s> only one identity selector allowed", c->argv[0]);
+      return 1;
+
+    } else if (strcmp(arg, "*") == 0) {
+      qc->qc_style = SLAP_LIMITS_ANY;
+
+    } else if (strcasecmp(arg, "anonymous") == 0) {
+      qc->qc_style = SLAP_LIMITS_ANONYMOUS;
+
+    } else if (strcasecmp(arg, "users") == 0) {
+      qc->qc_style = SLAP_LIMITS_USERS;
+
+    } else if (strncasecmp(arg, "dn", STRLENOF("dn")) == 0 && (arg[2] == '.' || arg[2] == '=')) {
+      struct berval bv;
+      char *eq = strchr(arg, '=');
+
+      if (eq == NULL) {
+        snprintf(c->cr_msg, sizeof(c->cr_msg), "<%s> invalid dn selector", c->argv[0]);
+        return 1;
+      }
+      qc->qc_style = SLAP_LIMITS_EXACT;
+      qc->qc_scope = LDAP_SCOPE_BASE;
+      if (arg[2] == '.') {
+        ber_str2bv(arg + 3, eq - arg - 3, 0, &bv);
+        if (bv.bv_len == STRLENOF("regex") && strncasecmp(bv.bv_val, "regex", bv.bv_len) == 0) {
+          qc->qc_style = SLAP_LIMITS_REGEX;
+        } else if (bv.bv_len == STRLENOF("exact") && strncasecmp(bv.bv_val, "exact", bv.bv_len) == 0) {
+          qc->qc_scope = LDAP_SCOPE_BASE;
+        } else if ((qc->qc_scope = ldap_pvt_bv2scope(&bv)) < 0) {
+          snprintf(c->cr_msg, sizeof(c->cr_msg), "<%s> unknown dn style \"%.*s\"", c->argv[0], (int)bv.bv_len,
+                   bv.bv_val);
+          return 1;
+        } else {
+          qc->qc_style = SLAP_LIMITS_SUBTREE;
+        }
+      }
+      if (qc->qc_style == SLAP_LIMITS_REGEX) {
+        if (regcomp(&qc->qc_regex, eq + 1, REG_EXTENDED | REG_ICASE | REG_NOSUB)) {
+          qc->qc_style = SLAP_LIMITS_UNDEFINED;
+          snprintf(c->cr_msg, sizeof(c->cr_msg), "<%s> invalid dn regex", c->argv[0]);
+          return 1;
+        }
+        ber_str2bv(eq + 1, 0, 1, &qc->qc_pat);
+      } else {
+        ber_str2bv(eq + 1, 0, 0, &bv);
+        if (dnNormalize(0, NULL, NULL, &bv, &qc->qc_pat, NULL) != LDAP_SUCCESS) {
+          qc->qc_style = SLAP_LIMITS_UNDEFINED;
+          snprintf(c->cr_msg, sizeof(c->cr_msg), "<%s> invalid DN \"%s\"", c->argv[0], bv.bv_val);
+          return 1;
+        }
+      }
+
+    } else {
+      snprintf(c->cr_msg, sizeof(c->cr_msg), "<%s> unknown selector \"%s\"", c->argv[0], arg);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int config_qosclass(ConfigArgs *c) {
+  QosClass *qc, **prev;
+  int i;
+
+  if (c->op == SLAP_CONFIG_EMIT) {
+    struct berval bv;
+
+    for (i = 0, qc = slap_qos_classes; qc; qc = qc->qc_next, i++) {
+      if (slap_qos_unparse(qc, i, &bv))
+        return 1;
+      ber_bvarray_add(&c->rvalue_vals, &bv);
+    }
+    return c->rvalue_vals == NULL;
+  } else if (c->op == LDAP_MOD_DELETE) {
+    /* ARG_NO_DELETE, since queued and executing operations refer to
+     * their class; classes may only be appended at runtime. */
+    return 1;
+  }
+
+  for (qc = slap_qos_classes; qc; qc = qc->qc_next) {
+    if (strcasecmp(qc->qc_name.bv_val, c->argv[1]) == 0) {
+      snprintf(c->cr_msg, sizeof(c->cr_msg), "<%s> class \"%s\" already defined", c->argv[0], c->argv[1]);
+      Debug(LDAP_DEBUG_ANY, "%s: %s\n", c->log, c->cr_msg);
+      return 1;
+    }
+  }
+
+  qc = ch_calloc(1, sizeof(QosClass));
+  ber_str2bv(c->argv[1], 0, 1, &qc->qc_name);
+  LDAP_STAILQ_INIT(&qc->qc_waiting);
+  if (slap_qos_parse(c, qc)) {
+    Debug(LDAP_DEBUG_ANY, "%s: %s\n", c->log, c->cr_msg);
+    slap_qos_free(qc);
+    return 1;
+  }
+
+  for (prev = &slap_qos_classes; *prev; prev = &(*prev)->qc_next)
+    ;
+  *prev = qc;
+  return 0;
+}
+
+/* Admission control in the manner of CoDel.  While the pool keeps
+ * starting operations within the target, an operation may wait for a
+ * thread up to the interval.  Once none did for a whole interval the
+ * queue is standing, and operations which waited longer than the target
+ * are rejected with busy rather than served to clients that have
+ * likely given up on them.  The limits "queue=" of the identity, from
+ * the global limits, overrides the target or exempts it. */
+unsigned slap_admission_target;          /* msec, 0 to disable */
+static unsigned slap_admission_interval = 100; /* msec */
+static uint64_t slap_admission_good;     /* when an operation last started within the target */
+
+int slap_admission_check(Operation *op) {
+  uint64_t now = op->o_stamp[SLAP_STAMP_STARTED];
+  uint64_t sojourn = slap_op_elapsed(op, SLAP_STAMP_READ, SLAP_STAMP_STARTED);
+  uint64_t target = slap_admission_target * (uint64_t)1000000ul;
+  uint64_t interval = slap_admission_interval * (uint64_t)1000000ul;
+  uint64_t good;
+  int delay;
+
+  if (sojourn <= target) {
+    __atomic_store_n(&slap_admission_good, now, __ATOMIC_RELAXED);
+    return 0;
+  }
+
+  delay = limits_queue_delay(op);
+  if (delay == SLAP_NO_LIMIT)
+    return 0;
+  if (delay > 0)
+    target = delay * (uint64_t)1000000ul;
+
+  good = __atomic_load_n(&slap_admission_good, __ATOMIC_RELAXED);
+  if (good == 0 || now < good + interval) {
+    /* the queue is not standing */
+    if (target < interval)
+      target = interval;
+  }
+
+  return sojourn > target;
+}
+
+int config_admission(ConfigArgs *c) {
+  if (c->op == SLAP_CONFIG_EMIT) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%u:%u", slap_admission_target, slap_admission_interval);
+    c->value_string = ch_strdup(buf);
+    return 0;
+  } else if (c->op == LDAP_MOD_DELETE) {
+    slap_admission_target = 0;
+    slap_admission_interval = 100;
+    return 0;
+  } else {
+    unsigned long target, interval = slap_admission_interval;
+    char *s = c->value_string;
+
+    target = strtoul(s, &s, 10);
+    if (*s == ':')
+      interval = strtoul(s + 1, &s, 10);
+    if (*s != '\0' || s == c->value_string || target > 60000 || interval < 1 || interval > 60000) {
+      snprintf(c->cr_msg, sizeof(c->cr_msg), "<%s> invalid specification", c->argv[0]);
+      Debug(LDAP_DEBUG_ANY, "%s: %s '%s'\n", c->log, c->cr_msg, c->value_string);
+      return 1;
+    }
+    slap_admission_target = target;
+    slap_admission_interval = interval;
+    return 0;
+  }
+}
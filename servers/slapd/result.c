@@ -27,10 +27,16 @@
 #include <ac/unistd.h>
 
 #include "slap.h"
+#include "slapconfig.h"
+#include "lutil.h"
 
 #if SLAP_STATS_ETIME
+/* qtime: waiting for a thread, btime: in the frontend database
+ * until the result was sent, etime: overall */
 #define ETIME_SETUP                                                                                                    \
   struct timeval now;                                                                                                  \
+  uint64_t qtime = slap_op_elapsed(op, SLAP_STAMP_READ, SLAP_STAMP_STARTED) / 1000;                                    \
+  uint64_t btime = slap_op_elapsed(op, SLAP_STAMP_BACKEND, SLAP_STAMP_SENT) / 1000;                                    \
   (void)gettimeofday(&now, NULL);                                                                                      \
   now.tv_sec -= op->o_time;                                                                                            \
   now.tv_usec -= op->o_tincr;                                                                                          \
@@ -38,9 +44,10 @@
     --now.tv_sec;                                                                                                      \
     now.tv_usec += 1000000;                                                                                            \
   }
-#define ETIME_LOGFMT "etime=%d.%06d "
+#define ETIME_LOGFMT "qtime=%d.%06d btime=%d.%06d etime=%d.%06d "
 #define StatslogEtime(lvl, fmt, pfx, tag, err, ...)                                                                    \
-  Statslog(lvl, fmt, pfx, tag, err, (int)now.tv_sec, (int)now.tv_usec, __VA_ARGS__)
+  Statslog(lvl, fmt, pfx, tag, err, (int)(qtime / 1000000), (int)(qtime % 1000000), (int)(btime / 1000000),          \
+           (int)(btime % 1000000), (int)now.tv_sec, (int)now.tv_usec, __VA_ARGS__)
 #else
 #define ETIME_SETUP
 #define ETIME_LOGFMT ""
@@ -311,36 +318,287 @@ enum counters_send_update_mode {
 
 static void send_ldap_ber__update_counters(Operation *op, int bytes, enum counters_send_update_mode crutch) {
   assert(bytes > 0);
-  ldap_pvt_thread_mutex_lock(&op->o_counters->sc_mutex);
-  ldap_pvt_mp_add_ulong(op->o_counters->sc_bytes, (unsigned long)bytes);
+  slap_counter_add(op->o_counters->sc_bytes, (uint64_t)bytes);
+  slap_counter_add(op->o_counters->sc_pdu, 1);
   switch (crutch) {
   case crutch_ldap_response:
-    ldap_pvt_mp_add_ulong(op->o_counters->sc_pdu, 1);
     break;
   case crutch_search_entry:
-    ldap_pvt_mp_add_ulong(op->o_counters->sc_entries, 1);
-    ldap_pvt_mp_add_ulong(op->o_counters->sc_pdu, 1);
+    slap_counter_add(op->o_counters->sc_entries, 1);
     break;
   case crutch_search_reference:
-    ldap_pvt_mp_add_ulong(op->o_counters->sc_refs, 1);
-    ldap_pvt_mp_add_ulong(op->o_counters->sc_pdu, 1);
+    slap_counter_add(op->o_counters->sc_refs, 1);
     break;
   }
-  ldap_pvt_thread_mutex_unlock(&op->o_counters->sc_mutex);
 }
 
+/*
+ * Coalescing of the search results, see "writebatch" in slapd.conf(5).
+ *
+ * While a search is performed by the thread, its entries and references
+ * are collected in c_wbatch of the connection instead of being written
+ * one by one, until the size or the age limit is reached. Any other PDU
+ * is written after the batch is flushed, so the order is kept.
+ * The batch is written in the turn of a writer, or handed to the daemon
+ * by the timer of the connection once it is held for too long, so a slow
+ * search does not delay the entries found so far.
+ *
+ * The same buffer serves as the output queue, see "writequeue": when the
+ * socket is not writable, what is left of the PDU is queued there, up to
+ * slap_writequeue_size bytes, for the daemon to drain on the write event,
+ * so the worker thread is not held by a slow reader. Any PDU written while
+ * the daemon owns the queue is appended to it. Only a writer finding the
+ * queue full waits for the socket, which throttles the operation.
+ *
+ * The PDUs in c_wbatch are counted as sent once the buffer is written out.
+ * A buffer grown beyond the batch size is released then, so a burst does
+ * not keep the memory for the life of the connection.
+ */
+ber_len_t slap_writequeue_size = 0;
+static ber_len_t slap_writebatch_size = 32768;
+static unsigned slap_writebatch_delay = 5; /* msec */
+static __thread Connection *slap_writebatch_conn;
+
+/* Append what is left of the PDU to c_wbatch */
+static int slap_writebatch_append(Connection *conn, BerElement *ber, ber_len_t bytes,
+                                  enum counters_send_update_mode crutch) {
+  struct berval bv;
+  ber_len_t left = 0;
+
+  if (!conn->c_wbatch) {
+    conn->c_wbatch = ber_alloc_t(0);
+    if (!conn->c_wbatch)
+      return -1;
+  }
+  ber_get_option(ber, LBER_OPT_BER_BYTES_UNFLUSHED, &left);
+  if (ber_flatten2(ber, &bv, 0) < 0 || ber_write(conn->c_wbatch, bv.bv_val + bv.bv_len - left, left, 0) < 0)
+    return -1;
+
+  conn->c_wbatch_bytes += bytes;
+  conn->c_wbatch_pdus++;
+  if (crutch == crutch_search_entry)
+    conn->c_wbatch_entries++;
+  else if (crutch == crutch_search_reference)
+    conn->c_wbatch_refs++;
+  return 0;
+}
+
+/* Returns -1 if the PDU should be written alone,
+ * 0 if it was appended and the batch should be flushed,
+ * 1 if it was appended and may be held yet. */
+static int slap_writebatch_add(Connection *conn, BerElement *ber, ber_len_t bytes,
+                               enum counters_send_update_mode crutch, int hold) {
+  slap_time_t now;
+  ber_len_t pending = 0;
+
+  if (conn->c_wbatch)
+    ber_get_option(conn->c_wbatch, LBER_OPT_BER_BYTES_UNFLUSHED, &pending);
+  /* unless the daemon owns the queue, the batch is flushed first */
+  if (hold ? !pending && bytes >= slap_writebatch_size : !conn->c_wqueued)
+    return -1;
+
+  if (slap_writebatch_append(conn, ber, bytes, crutch))
+    return -1;
+
+  now = ldap_now_steady();
+  if (!pending)
+    conn->c_wbatch_since = now;
+  if (!hold || pending + bytes >= slap_writebatch_size ||
+      now.ns - conn->c_wbatch_since.ns >= slap_writebatch_delay * (uint64_t)1000000ul)
+    return 0;
+  if (!pending && !conn->c_wqueued) {
+    slap_time_t when = now;
+    when.ns += slap_writebatch_delay * (uint64_t)1000000ul;
+    slap_timer_arm(&conn->c_wbatch_timer, when);
+  }
+  return 1;
+}
+
+static int slap_writebatch_flush(Connection *conn, slap_counters_t *sc) {
+  ber_len_t pending = 0;
+
+  if (conn->c_wbatch)
+    ber_get_option(conn->c_wbatch, LBER_OPT_BER_BYTES_UNFLUSHED, &pending);
+  if (pending && ber_flush2(conn->c_sb, conn->c_wbatch, LBER_FLUSH_FREE_NEVER))
+    return -1;
+  if (conn->c_wbatch) {
+    ber_len_t size = 0;
+
+    /* keep a buffer of the batch size, but not the one grown by the queue */
+    ber_get_option(conn->c_wbatch, LBER_OPT_BER_BYTES_TO_WRITE, &size);
+    if (size > slap_writebatch_size) {
+      ber_free(conn->c_wbatch, 1);
+      conn->c_wbatch = NULL;
+    } else {
+      ber_reset(conn->c_wbatch, 1);
+    }
+  }
+  if (conn->c_wbatch_pdus) {
+    slap_counter_add(sc->sc_bytes, (uint64_t)conn->c_wbatch_bytes);
+    slap_counter_add(sc->sc_pdu, conn->c_wbatch_pdus);
+    slap_counter_add(sc->sc_entries, conn->c_wbatch_entries);
+    slap_counter_add(sc->sc_refs, conn->c_wbatch_refs);
+    conn->c_wbatch_bytes = 0;
+    conn->c_wbatch_pdus = conn->c_wbatch_entries = conn->c_wbatch_refs = 0;
+  }
+  conn->c_wqueued = 0;
+  return 0;
+}
+
+static int slap_writequeue_room(Connection *conn) {
+  ber_len_t pending = 0;
+
+  if (!slap_writequeue_size)
+    return 0;
+  if (conn->c_wbatch)
+    ber_get_option(conn->c_wbatch, LBER_OPT_BER_BYTES_UNFLUSHED, &pending);
+  return pending < slap_writequeue_size;
+}
+
+/*
+ * Drain the output queue on the write event, c_mutex is locked.
+ * Returns 0 if nothing is left for the daemon, 1 if the socket is
+ * still not writable, and -1 if the connection is lost.
+ */
+int slap_writequeue_drain(Connection *conn) {
+  int rc = 0;
+
+  ldap_pvt_thread_mutex_lock(&conn->c_write1_mutex);
+  if (!conn->c_wqueued) {
+    /* flushed by a writer meanwhile */
+  } else if (conn->c_writing) {
+    /* the writer which has queued it may be still in its turn */
+    rc = 1;
+  } else if (slap_writebatch_flush(conn, &slap_counters) == 0) {
+    conn->c_activitytime = ldap_now_steady();
+  } else {
+    int err = sock_errno();
+    Debug(LDAP_DEBUG_CONNS, "slap_writequeue_drain: ber_flush2 failed errno=%d reason=\"%s\"\n", err,
+          sock_errstr(err));
+    rc = (err == EWOULDBLOCK || err == EAGAIN) ? 1 : -1;
+    if (rc > 0)
+      conn->c_activitytime = ldap_now_steady();
+  }
+  ldap_pvt_thread_mutex_unlock(&conn->c_write1_mutex);
+  return rc;
+}
+
+/* Leave the pending output to the daemon, c_write1_mutex is locked */
+static void slap_writequeue_post(Connection *conn) {
+  ber_len_t pending = 0;
+
+  if (conn->c_wbatch)
+    ber_get_option(conn->c_wbatch, LBER_OPT_BER_BYTES_UNFLUSHED, &pending);
+  if (!pending || conn->c_wqueued)
+    return;
+  conn->c_wqueued = 1;
+  /* the writetimeout runs from now on */
+  if (global_writetimeout > 0)
+    connection_timer_arm(conn);
+  slapd_set_write(conn->c_sd, 1);
+}
+
+/* The batch is held for too long, called by the daemon */
+void slap_writebatch_timeout(slap_timer_t *t) {
+  Connection *conn = (Connection *)((char *)t - offsetof(Connection, c_wbatch_timer));
+
+  ldap_pvt_thread_mutex_lock(&conn->c_mutex);
+  if (connection_valid(conn)) {
+    ldap_pvt_thread_mutex_lock(&conn->c_write1_mutex);
+    if (conn->c_writing) {
+      /* the writer may be holding it yet, look again later */
+      slap_time_t later = ldap_now_steady();
+      later.ns += slap_writebatch_delay * (uint64_t)1000000ul;
+      slap_timer_arm(t, later);
+    } else {
+      slap_writequeue_post(conn);
+    }
+    ldap_pvt_thread_mutex_unlock(&conn->c_write1_mutex);
+  }
+  ldap_pvt_thread_mutex_unlock(&conn->c_mutex);
+}
+
+static long send_ldap_ber(Operation *op, BerElement *ber, enum counters_send_update_mode crutch);
+
+/* Start collecting the results of the search performed by the thread */
+void slap_writebatch_begin(Operation *op) {
+  slap_writebatch_conn = NULL;
+  if (!slap_writebatch_size || !op->o_conn)
+    return;
+#ifdef LDAP_CONNECTIONLESS
+  if (op->o_conn->c_is_udp)
+    return;
+#endif
+  slap_writebatch_conn = op->o_conn;
+}
+
+/* Flush whatever was left, e.g. by a persistent search.
+ * Without op the operation belongs to another thread already,
+ * so the rest is left to the daemon. */
+void slap_writebatch_end(Operation *op) {
+  Connection *conn = slap_writebatch_conn;
+
+  slap_writebatch_conn = NULL;
+  if (!conn || !conn->c_wbatch)
+    return;
+  if (op && conn == op->o_conn) {
+    send_ldap_ber(op, NULL, crutch_ldap_response);
+  } else if (!op) {
+    ldap_pvt_thread_mutex_lock(&conn->c_mutex);
+    if (connection_valid(conn)) {
+      ldap_pvt_thread_mutex_lock(&conn->c_write1_mutex);
+      if (!conn->c_writing)
+        slap_writequeue_post(conn);
+      ldap_pvt_thread_mutex_unlock(&conn->c_write1_mutex);
+    }
+    ldap_pvt_thread_mutex_unlock(&conn->c_mutex);
+  }
+}
+
+int config_writebatch(ConfigArgs *c) {
+  if (c->op == SLAP_CONFIG_EMIT) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%lu:%u", (unsigned long)slap_writebatch_size, slap_writebatch_delay);
+    c->value_string = ch_strdup(buf);
+    return 0;
+  } else if (c->op == LDAP_MOD_DELETE) {
+    slap_writebatch_size = 32768;
+    slap_writebatch_delay = 5;
+    return 0;
+  } else {
+    unsigned long size, delay = slap_writebatch_delay;
+    char *s = c->value_string;
+
+    size = strtoul(s, &s, 10);
+    if (*s == ':')
+      delay = strtoul(s + 1, &s, 10);
+    if (*s != '\0' || s == c->value_string || size > (ber_len_t)-1 / 2 || delay > 1000) {
+      snprintf(c->cr_msg, sizeof(c->cr_msg), "<%s> invalid specification", c->argv[0]);
+      Debug(LDAP_DEBUG_ANY, "%s: %s '%s'\n", c->log, c->cr_msg, c->value_string);
+      return 1;
+    }
+    slap_writebatch_size = size;
+    slap_writebatch_delay = delay;
+    return 0;
+  }
+}
+
+/*
+ * Write the PDU, or just flush the pending batch if ber is NULL.
+ */
 static long send_ldap_ber(Operation *op, BerElement *ber, enum counters_send_update_mode crutch) {
   Connection *conn = op->o_conn;
-  ber_len_t bytes;
+  ber_len_t bytes = 0;
   long ret = -1;
   char *close_reason;
 
-  ber_get_option(ber, LBER_OPT_BER_BYTES_TO_WRITE, &bytes);
+  if (ber)
+    ber_get_option(ber, LBER_OPT_BER_BYTES_TO_WRITE, &bytes);
 
   ldap_pvt_thread_mutex_lock(&conn->c_mutex);
   ldap_pvt_thread_mutex_lock(&conn->c_write1_mutex);
 
-  if ((slap_get_op_abandon(op) && !slap_get_op_cancel(op)) || !connection_valid(conn) || conn->c_writers < 0) {
+  if ((ber && slap_get_op_abandon(op) && !slap_get_op_cancel(op)) || !connection_valid(conn) || conn->c_writers < 0) {
     ldap_pvt_thread_mutex_unlock(&conn->c_write1_mutex);
     ldap_pvt_thread_mutex_unlock(&conn->c_mutex);
     return ret;
@@ -369,13 +627,30 @@ static long send_ldap_ber(Operation *op, BerElement *ber, enum counters_send_upd
   /* Our turn */
   conn->c_writing = 1;
 
-  /* write the pdu */
+  if (ber) {
+    switch (slap_writebatch_add(conn, ber, bytes, crutch, conn == slap_writebatch_conn && crutch != crutch_ldap_response)) {
+    case 1:
+      ret = bytes;
+      goto done;
+    case 0:
+      ber = NULL;
+      /* the daemon is draining the queue already */
+      if (conn->c_wqueued && slap_writequeue_room(conn)) {
+        ret = bytes;
+        goto done;
+      }
+    }
+  }
+
+  /* write the batch and the pdu */
   while (conn->c_conn_state >= SLAP_C_ACTIVE) {
     int err;
 
-    if (ber_flush2(conn->c_sb, ber, LBER_FLUSH_FREE_NEVER) == 0) {
+    if (slap_writebatch_flush(conn, op->o_counters) == 0 &&
+        (!ber || ber_flush2(conn->c_sb, ber, LBER_FLUSH_FREE_NEVER) == 0)) {
       ret = bytes;
-      send_ldap_ber__update_counters(op, bytes, crutch);
+      if (ber)
+        send_ldap_ber__update_counters(op, bytes, crutch);
       break;
     }
 
@@ -401,6 +676,16 @@ static long send_ldap_ber(Operation *op, BerElement *ber, enum counters_send_upd
       return -1;
     }
 
+    /* leave the rest to the daemon, unless the queue is full */
+    if (slap_writequeue_room(conn) && (!ber || slap_writebatch_append(conn, ber, bytes, crutch) == 0)) {
+      if (conn->c_wqueued)
+        slapd_set_write(conn->c_sd, 1);
+      else
+        slap_writequeue_post(conn);
+      ret = bytes;
+      break;
+    }
+
     /* wait for socket to be write-ready */
     conn->c_writewaiter = 1;
     ldap_pvt_thread_mutex_unlock(&conn->c_write1_mutex);
@@ -427,6 +712,7 @@ static long send_ldap_ber(Operation *op, BerElement *ber, enum counters_send_upd
     }
   }
 
+done:
   conn->c_writing = 0;
   if (conn->c_writers < 0) {
     conn->c_writers++;
@@ -729,6 +1015,7 @@ static int send_ldap_response(Operation *op, SlapReply *rs) {
 
     goto cleanup;
   }
+  slap_op_stamp(op, SLAP_STAMP_SENT);
 
 cleanup:;
   /* Tell caller that we did this for real, as opposed to being
@@ -801,6 +1088,30 @@ void send_ldap_disconnect(Operation *op, SlapReply *rs) {
   }
 }
 
+/* The ACL decisions cached before may depend on what was written, e.g.
+ * on a group, so they are dropped before the client learns the write is
+ * done.  Failed and no-op writes change nothing.  Of the extended
+ * operations only the password modify and the end of a transaction write,
+ * the other ones keep the cache. */
+static void acl_cache_written(Operation *op, SlapReply *rs) {
+  if (rs->sr_err != LDAP_SUCCESS)
+    return;
+
+  switch (op->o_tag) {
+  case LDAP_REQ_ADD:
+  case LDAP_REQ_DELETE:
+  case LDAP_REQ_MODIFY:
+  case LDAP_REQ_MODRDN:
+    acl_cache_invalidate();
+    break;
+  case LDAP_REQ_EXTENDED:
+    if (ber_bvcmp(&slap_EXOP_MODIFY_PASSWD, &op->ore_reqoid) == 0 ||
+        ber_bvcmp(&slap_EXOP_TXN_END, &op->ore_reqoid) == 0)
+      acl_cache_invalidate();
+    break;
+  }
+}
+
 void slap_send_ldap_result(Operation *op, SlapReply *rs) {
   char *tmp = NULL;
   const char *otext = rs->sr_text;
@@ -841,6 +1152,8 @@ abandon:
   rs->sr_tag = slap_req2res(op->o_tag);
   rs->sr_msgid = (rs->sr_tag != LBER_SEQUENCE) ? op->o_msgid : 0;
 
+  acl_cache_written(op, rs);
+
   if (rs->sr_ref != oref) {
     assert(rs->sr_ref == NULL && oref != NULL);
     if (rs->sr_flags & REP_REF_MUSTBEFREED) {
@@ -895,6 +1208,8 @@ void slap_send_ldap_extended(Operation *op, SlapReply *rs) {
   rs->sr_tag = slap_req2res(op->o_tag);
   rs->sr_msgid = (rs->sr_tag != LBER_SEQUENCE) ? op->o_msgid : 0;
 
+  acl_cache_written(op, rs);
+
   if (send_ldap_response(op, rs) == SLAP_CB_CONTINUE) {
     ETIME_SETUP;
     StatslogEtime(LDAP_DEBUG_STATS, "%s RESULT oid=%s err=%d " ETIME_LOGFMT "text=%s\n", op->o_log_prefix,
@@ -923,6 +1238,266 @@ void slap_send_ldap_intermediate(Operation *op, SlapReply *rs) {
     (rs)->sr_text = text;                                                                                              \
   } while (0)
 
+/* Encoded attributes of the entries returned by searches.
+ *
+ * The attributes of an entry as they are sent to a client only depend
+ * on its content, the attributes asked for and the access the client
+ * has to each of their values.  The cache keeps the encoded block of
+ * them under the database, the entry ID, DN and CSN, the attribute list
+ * of the request and the authorization DN, so that the next read of the
+ * same entry by the same identity streams it rather than checking the
+ * ACLs of each value and encoding it again.  The DN is there because an
+ * ID may be given to another entry, e.g. by the compaction of back-mdb.
+ *
+ * The access is only summed up by the identity when no ACL which may
+ * apply to the entry looks at the connection (see acl_entry_decidable()),
+ * what remains is the content of other entries, such as groups, which
+ * is covered by acl_cache_gen as for the ACL decisions cache.  Only the
+ * entries read from a database as they are stored are cached, neither
+ * the ones built or altered by overlays nor those without an entryCSN;
+ * the operational attributes computed for the response are always
+ * encoded afresh.  As the other caches, it is sharded and admits an
+ * entry the second time it is sent.
+ */
+#define ENCODE_CACHE_SHARDS 16
+#define ENCODE_CACHE_BUCKETS 256      /* per shard */
+#define ENCODE_CACHE_SEEN 1024        /* per shard */
+#define ENCODE_CACHE_BLOCK_MAX 262144 /* larger blocks are not kept */
+
+#define ENCODE_CACHE_ATTRSONLY 0x01
+#define ENCODE_CACHE_SYNC 0x02   /* DSA-specific attributes are skipped */
+#define ENCODE_CACHE_ALL 0x04    /* no attribute list */
+
+unsigned encode_cache_max; /* entries in all, 0 disables the cache */
+
+typedef struct encode_cache_entry {
+  LDAP_LIST_ENTRY(encode_cache_entry) ece_chain;
+  LDAP_TAILQ_ENTRY(encode_cache_entry) ece_lru;
+  uint32_t ece_hash;
+  unsigned ece_gen;
+  BackendDB *ece_bd;
+  ID ece_id;
+  int ece_flags;
+  struct berval ece_ndn;
+  struct berval ece_csn;
+  struct berval ece_opndn;
+  struct berval ece_attrs; /* the names asked for, each one NUL terminated */
+  struct berval ece_block;
+} encode_cache_entry;
+
+typedef struct encode_cache_shard {
+  ldap_pvt_thread_mutex_t ecs_mutex;
+  unsigned ecs_count;
+  LDAP_TAILQ_HEAD(encode_cache_lru, encode_cache_entry) ecs_lru;
+  LDAP_LIST_HEAD(encode_cache_chain, encode_cache_entry) ecs_chain[ENCODE_CACHE_BUCKETS];
+  uint32_t ecs_seen[ENCODE_CACHE_SEEN];
+} __cache_aligned encode_cache_shard;
+
+static encode_cache_shard *encode_cache;
+static void *encode_cache_alloc;
+
+typedef struct encode_cache_probe {
+  encode_cache_shard *ecp_shard;
+  uint32_t ecp_hash;
+  int ecp_flags;
+  struct berval *ecp_csn;
+  ber_len_t ecp_attrslen;
+  int ecp_admit;
+} encode_cache_probe;
+
+void encode_cache_init(void) {
+  int i, j;
+
+  encode_cache_alloc = ch_calloc(1, ENCODE_CACHE_SHARDS * sizeof(encode_cache_shard) + CACHELINE_SIZE - 1);
+  encode_cache =
+      (encode_cache_shard *)(((size_t)encode_cache_alloc + CACHELINE_SIZE - 1) & ~(size_t)(CACHELINE_SIZE - 1));
+  for (i = 0; i < ENCODE_CACHE_SHARDS; i++) {
+    ldap_pvt_thread_mutex_init(&encode_cache[i].ecs_mutex);
+    LDAP_TAILQ_INIT(&encode_cache[i].ecs_lru);
+    for (j = 0; j < ENCODE_CACHE_BUCKETS; j++)
+      LDAP_LIST_INIT(&encode_cache[i].ecs_chain[j]);
+  }
+}
+
+/* ecs_mutex locked */
+static void encode_cache_evict(encode_cache_shard *ecs, encode_cache_entry *ece) {
+  LDAP_LIST_REMOVE(ece, ece_chain);
+  LDAP_TAILQ_REMOVE(&ecs->ecs_lru, ece, ece_lru);
+  ecs->ecs_count--;
+  ch_free(ece);
+}
+
+void encode_cache_destroy(void) {
+  encode_cache_entry *ece;
+  int i;
+
+  if (!encode_cache)
+    return;
+
+  for (i = 0; i < ENCODE_CACHE_SHARDS; i++) {
+    while ((ece = LDAP_TAILQ_FIRST(&encode_cache[i].ecs_lru)) != NULL)
+      encode_cache_evict(&encode_cache[i], ece);
+    ldap_pvt_thread_mutex_destroy(&encode_cache[i].ecs_mutex);
+  }
+  ch_free(encode_cache_alloc);
+  encode_cache = NULL;
+}
+
+static uint32_t encode_cache_hash(uint32_t h, const void *p, size_t len) {
+  const unsigned char *c = p;
+
+  while (len--)
+    h = (h ^ *c++) * 16777619u;
+  return h;
+}
+
+static int encode_cache_attrs_match(AttributeName *an, struct berval *bv) {
+  char *p = bv->bv_val, *end = bv->bv_val + bv->bv_len;
+
+  for (; an && an->an_name.bv_val; an++) {
+    if ((ber_len_t)(end - p) <= an->an_name.bv_len || memcmp(p, an->an_name.bv_val, an->an_name.bv_len) ||
+        p[an->an_name.bv_len])
+      return 0;
+    p += an->an_name.bv_len + 1;
+  }
+  return p == end;
+}
+
+/* Look the attributes of rs->sr_entry up and append them to ber.
+ * Returns 1 on a hit, -1 if ber couldn't take them, otherwise 0 and
+ * the probe tells whether to encode_cache_put() them once encoded. */
+static int encode_cache_get(Operation *op, SlapReply *rs, BerElement *ber, encode_cache_probe *ecp) {
+  Entry *e = rs->sr_entry;
+  encode_cache_shard *ecs;
+  encode_cache_entry *ece, *next;
+  AttributeName *an;
+  Attribute *a;
+  uint32_t h = 2166136261u; /* FNV-1a */
+  unsigned gen;
+  uint32_t *seen;
+  int rc = 0;
+
+  ecp->ecp_admit = 0;
+  if (!encode_cache || !encode_cache_max || op->o_res_ber != NULL || op->o_vrFilter != NULL)
+    return 0;
+  /* only the entries as they are stored */
+  if (e->e_id == NOID || e->e_id == 0 || (rs->sr_flags & REP_ENTRY_MODIFIABLE))
+    return 0;
+  a = attr_find(e->e_attrs, slap_schema.si_ad_entryCSN);
+  if (a == NULL || a->a_numvals != 1)
+    return 0;
+
+  ecp->ecp_csn = &a->a_nvals[0];
+  ecp->ecp_flags = 0;
+  if (op->ors_attrsonly)
+    ecp->ecp_flags |= ENCODE_CACHE_ATTRSONLY;
+  if (op->o_sync != SLAP_CONTROL_NONE)
+    ecp->ecp_flags |= ENCODE_CACHE_SYNC;
+  if (rs->sr_attrs == NULL)
+    ecp->ecp_flags |= ENCODE_CACHE_ALL;
+
+  h = encode_cache_hash(h, &op->o_bd, sizeof(op->o_bd));
+  h = encode_cache_hash(h, &e->e_id, sizeof(e->e_id));
+  h = encode_cache_hash(h, e->e_nname.bv_val, e->e_nname.bv_len);
+  h = encode_cache_hash(h, &ecp->ecp_flags, sizeof(ecp->ecp_flags));
+  h = encode_cache_hash(h, ecp->ecp_csn->bv_val, ecp->ecp_csn->bv_len);
+  h = encode_cache_hash(h, op->o_ndn.bv_val, op->o_ndn.bv_len);
+  h = encode_cache_hash(h, "", 1);
+  ecp->ecp_attrslen = 0;
+  for (an = rs->sr_attrs; an && an->an_name.bv_val; an++) {
+    h = encode_cache_hash(h, an->an_name.bv_val, an->an_name.bv_len + 1);
+    ecp->ecp_attrslen += an->an_name.bv_len + 1;
+  }
+  ecp->ecp_hash = h;
+  ecp->ecp_shard = ecs = &encode_cache[h % ENCODE_CACHE_SHARDS];
+  gen = __atomic_load_n(&acl_cache_gen, __ATOMIC_ACQUIRE);
+
+  ldap_pvt_thread_mutex_lock(&ecs->ecs_mutex);
+  for (ece = LDAP_LIST_FIRST(&ecs->ecs_chain[(h / ENCODE_CACHE_SHARDS) % ENCODE_CACHE_BUCKETS]); ece != NULL;
+       ece = next) {
+    next = LDAP_LIST_NEXT(ece, ece_chain);
+    if (ece->ece_gen != gen) {
+      encode_cache_evict(ecs, ece);
+      continue;
+    }
+    if (ece->ece_hash == h && ece->ece_bd == op->o_bd && ece->ece_id == e->e_id &&
+        ece->ece_flags == ecp->ecp_flags && bvmatch(&ece->ece_ndn, &e->e_nname) &&
+        bvmatch(&ece->ece_csn, ecp->ecp_csn) && bvmatch(&ece->ece_opndn, &op->o_ndn) &&
+        encode_cache_attrs_match(rs->sr_attrs, &ece->ece_attrs)) {
+      LDAP_TAILQ_REMOVE(&ecs->ecs_lru, ece, ece_lru);
+      LDAP_TAILQ_INSERT_TAIL(&ecs->ecs_lru, ece, ece_lru);
+      rc = 1;
+      if (ece->ece_block.bv_len &&
+          ber_write(ber, ece->ece_block.bv_val, ece->ece_block.bv_len, 0) != (ber_slen_t)ece->ece_block.bv_len)
+        rc = -1;
+      ldap_pvt_thread_mutex_unlock(&ecs->ecs_mutex);
+      return rc;
+    }
+  }
+  seen = &ecs->ecs_seen[(h / ENCODE_CACHE_SHARDS) % ENCODE_CACHE_SEEN];
+  if (*seen == h)
+    ecp->ecp_admit = 1;
+  else
+    *seen = h;
+  ldap_pvt_thread_mutex_unlock(&ecs->ecs_mutex);
+  return 0;
+}
+
+static void encode_cache_put(Operation *op, SlapReply *rs, encode_cache_probe *ecp, struct berval *block) {
+  Entry *e = rs->sr_entry;
+  encode_cache_shard *ecs = ecp->ecp_shard;
+  encode_cache_entry *ece;
+  AttributeName *an;
+  char *p;
+
+  if (block->bv_len > ENCODE_CACHE_BLOCK_MAX)
+    return;
+
+  ece = ch_malloc(sizeof(encode_cache_entry) + e->e_nname.bv_len + ecp->ecp_csn->bv_len + op->o_ndn.bv_len +
+                  ecp->ecp_attrslen + block->bv_len + 3);
+  ece->ece_hash = ecp->ecp_hash;
+  ece->ece_gen = op->o_acl_gen;
+  ece->ece_bd = op->o_bd;
+  ece->ece_id = e->e_id;
+  ece->ece_flags = ecp->ecp_flags;
+  p = (char *)(ece + 1);
+  ece->ece_ndn.bv_val = p;
+  ece->ece_ndn.bv_len = e->e_nname.bv_len;
+  p = lutil_memcopy(p, e->e_nname.bv_val, e->e_nname.bv_len);
+  *p++ = '\0';
+  ece->ece_csn.bv_val = p;
+  ece->ece_csn.bv_len = ecp->ecp_csn->bv_len;
+  p = lutil_memcopy(p, ecp->ecp_csn->bv_val, ecp->ecp_csn->bv_len);
+  *p++ = '\0';
+  ece->ece_opndn.bv_val = p;
+  ece->ece_opndn.bv_len = op->o_ndn.bv_len;
+  p = lutil_memcopy(p, op->o_ndn.bv_val, op->o_ndn.bv_len);
+  *p++ = '\0';
+  ece->ece_attrs.bv_val = p;
+  ece->ece_attrs.bv_len = ecp->ecp_attrslen;
+  for (an = rs->sr_attrs; an && an->an_name.bv_val; an++) {
+    p = lutil_memcopy(p, an->an_name.bv_val, an->an_name.bv_len);
+    *p++ = '\0';
+  }
+  ece->ece_block.bv_val = p;
+  ece->ece_block.bv_len = block->bv_len;
+  memcpy(p, block->bv_val, block->bv_len);
+
+  ldap_pvt_thread_mutex_lock(&ecs->ecs_mutex);
+  if (ece->ece_gen != __atomic_load_n(&acl_cache_gen, __ATOMIC_ACQUIRE)) {
+    ldap_pvt_thread_mutex_unlock(&ecs->ecs_mutex);
+    ch_free(ece);
+    return;
+  }
+  /* another thread may have got it first, the older copy ages out */
+  LDAP_LIST_INSERT_HEAD(&ecs->ecs_chain[(ecp->ecp_hash / ENCODE_CACHE_SHARDS) % ENCODE_CACHE_BUCKETS], ece, ece_chain);
+  LDAP_TAILQ_INSERT_TAIL(&ecs->ecs_lru, ece, ece_lru);
+  ecs->ecs_count++;
+  while (ecs->ecs_count > (encode_cache_max + ENCODE_CACHE_SHARDS - 1) / ENCODE_CACHE_SHARDS)
+    encode_cache_evict(ecs, LDAP_TAILQ_FIRST(&ecs->ecs_lru));
+  ldap_pvt_thread_mutex_unlock(&ecs->ecs_mutex);
+}
+
 /*
  * returns:
  *
@@ -937,11 +1512,14 @@ void slap_send_ldap_intermediate(Operation *op, SlapReply *rs) {
 int slap_send_search_entry(Operation *op, SlapReply *rs) {
   BerElementBuffer berbuf;
   BerElement *ber = (BerElement *)&berbuf;
+  BerElementBuffer attrbuf;
+  BerElement *aber = ber; /* where the attributes of the entry go */
+  encode_cache_probe ecp;
   Attribute *a;
   int i, j, rc = LDAP_UNAVAILABLE, bytes;
   int userattrs;
   AccessControlState acl_state = ACL_STATE_INIT;
-  int attrsonly;
+  int attrsonly, cached = 0;
   AttributeDescription *ad_entry = slap_schema.si_ad_entry;
 
   /* a_flags: array of flags telling if the i-th element will be
@@ -1042,6 +1620,22 @@ int slap_send_search_entry(Operation *op, SlapReply *rs) {
   /* check for special all user attributes ("*") type */
   userattrs = SLAP_USERATTRS(rs->sr_attr_flags);
 
+  /* the attributes of the entry may be encoded already */
+  cached = encode_cache_get(op, rs, ber, &ecp);
+  if (cached < 0) {
+    Debug(LDAP_DEBUG_ANY, "send_search_entry: conn %lu  ber_write failed\n", op->o_connid);
+
+    ber_free_buf(ber);
+    set_ldap_error(rs, LDAP_OTHER, "encoding values error");
+    rc = rs->sr_err;
+    goto error_return;
+  }
+  if (!cached && ecp.ecp_admit && acl_entry_decidable(op, rs->sr_entry)) {
+    aber = (BerElement *)&attrbuf;
+    ber_init2(aber, NULL, LBER_USE_DER);
+    ber_set_option(aber, LBER_OPT_BER_MEMCTX, &op->o_tmpmemctx);
+  }
+
   /* create an array of arrays of flags. Each flag corresponds
    * to particular value of attribute and equals 1 if value matches
    * to ValuesReturnFilter or 0 if not
@@ -1090,7 +1684,7 @@ int slap_send_search_entry(Operation *op, SlapReply *rs) {
     }
   }
 
-  for (a = rs->sr_entry->e_attrs, j = 0; a != NULL; a = a->a_next, j++) {
+  for (a = cached ? NULL : rs->sr_entry->e_attrs, j = 0; a != NULL; a = a->a_next, j++) {
     AttributeDescription *desc = a->a_desc;
     int finish = 0;
 
@@ -1128,9 +1722,11 @@ int slap_send_search_entry(Operation *op, SlapReply *rs) {
         continue;
       }
 
-      if ((rc = ber_printf(ber, "{O[" /*]}*/, &desc->ad_cname)) == -1) {
+      if ((rc = ber_printf(aber, "{O[" /*]}*/, &desc->ad_cname)) == -1) {
         Debug(LDAP_DEBUG_ANY, "send_search_entry: conn %lu  ber_printf failed\n", op->o_connid);
 
+        if (aber != ber)
+          ber_free_buf(aber);
         if (op->o_res_ber == NULL)
           ber_free_buf(ber);
         set_ldap_error(rs, LDAP_OTHER, "encoding description error");
@@ -1158,9 +1754,11 @@ int slap_send_search_entry(Operation *op, SlapReply *rs) {
         if (first) {
           first = 0;
           finish = 1;
-          if ((rc = ber_printf(ber, "{O[" /*]}*/, &desc->ad_cname)) == -1) {
+          if ((rc = ber_printf(aber, "{O[" /*]}*/, &desc->ad_cname)) == -1) {
             Debug(LDAP_DEBUG_ANY, "send_search_entry: conn %lu  ber_printf failed\n", op->o_connid);
 
+            if (aber != ber)
+              ber_free_buf(aber);
             if (op->o_res_ber == NULL)
               ber_free_buf(ber);
             set_ldap_error(rs, LDAP_OTHER, "encoding description error");
@@ -1168,12 +1766,14 @@ int slap_send_search_entry(Operation *op, SlapReply *rs) {
             goto error_return;
           }
         }
-        if ((rc = ber_printf(ber, "O", &a->a_vals[i])) == -1) {
+        if ((rc = ber_printf(aber, "O", &a->a_vals[i])) == -1) {
           Debug(LDAP_DEBUG_ANY,
                 "send_search_entry: conn %lu  "
                 "ber_printf failed.\n",
                 op->o_connid);
 
+          if (aber != ber)
+            ber_free_buf(aber);
           if (op->o_res_ber == NULL)
             ber_free_buf(ber);
           set_ldap_error(rs, LDAP_OTHER, "encoding values error");
@@ -1183,9 +1783,11 @@ int slap_send_search_entry(Operation *op, SlapReply *rs) {
       }
     }
 
-    if (finish && (rc = ber_printf(ber, /*{[*/ "]N}")) == -1) {
+    if (finish && (rc = ber_printf(aber, /*{[*/ "]N}")) == -1) {
       Debug(LDAP_DEBUG_ANY, "send_search_entry: conn %lu ber_printf failed\n", op->o_connid);
 
+      if (aber != ber)
+        ber_free_buf(aber);
       if (op->o_res_ber == NULL)
         ber_free_buf(ber);
       set_ldap_error(rs, LDAP_OTHER, "encode end error");
@@ -1194,6 +1796,24 @@ int slap_send_search_entry(Operation *op, SlapReply *rs) {
     }
   }
 
+  if (aber != ber) {
+    struct berval block;
+
+    ber_flatten2(aber, &block, 0);
+    encode_cache_put(op, rs, &ecp, &block);
+    rc = block.bv_len ? ber_write(ber, block.bv_val, block.bv_len, 0) : 0;
+    ber_free_buf(aber);
+    aber = ber;
+    if (rc == -1) {
+      Debug(LDAP_DEBUG_ANY, "send_search_entry: conn %lu  ber_write failed\n", op->o_connid);
+
+      ber_free_buf(ber);
+      set_ldap_error(rs, LDAP_OTHER, "encoding values error");
+      rc = rs->sr_err;
+      goto error_return;
+    }
+  }
+
   /* NOTE: moved before overlays callback circling because
    * they may modify entry and other stuff in rs */
   if (rs->sr_operational_attrs != NULL && op->o_vrFilter != NULL) {
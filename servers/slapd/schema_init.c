@@ -1861,6 +1861,12 @@ done:
   return LDAP_SUCCESS;
 }
 
+/* Whether the initial, any and final pieces of a substrings assertion
+ * have to occur verbatim in the values matched by the rule */
+int mr_substr_literal(MatchingRule *mr) {
+  return mr->smr_match == octetStringSubstringsMatch || mr->smr_match == directoryStringSubstringsMatch;
+}
+
 #if defined(SLAPD_APPROX_INITIALS)
 #define SLAPD_APPROX_DELIMITER "._ "
 #define SLAPD_APPROX_WORDLEN 2
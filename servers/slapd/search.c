@@ -215,11 +215,18 @@ int do_search(Operation *op, /* info about the op to which we're responding */
   }
 
   op->o_bd = frontendDB;
+  slap_writebatch_begin(op);
+  slap_op_stamp(op, SLAP_STAMP_BACKEND);
   rs->sr_err = frontendDB->be_search(op, rs);
+  if (rs->sr_err != SLAPD_ASYNCOP)
+    slap_op_stamp(op, SLAP_STAMP_BACKEND_DONE);
   if (rs->sr_err == SLAPD_ASYNCOP) {
-    /* skip cleanup */
+    /* skip cleanup, the results are sent by another thread,
+     * and those collected so far are flushed by the daemon */
+    slap_writebatch_end(NULL);
     return rs->sr_err;
   }
+  slap_writebatch_end(op);
 
 return_results:;
   if (!BER_BVISNULL(&op->o_req_dn)) {
@@ -335,8 +335,10 @@ typedef struct ContentRule ContentRule;
 typedef struct AttributeAssertion AttributeAssertion;
 typedef struct SubstringsAssertion SubstringsAssertion;
 typedef struct Filter Filter;
+typedef struct FilterProgram FilterProgram;
 typedef struct ValuesReturnFilter ValuesReturnFilter;
 typedef struct Attribute Attribute;
+typedef struct AttrIndex AttrIndex;
 #ifdef LDAP_COMP_MATCH
 typedef struct ComponentData ComponentData;
 typedef struct ComponentFilter ComponentFilter;
@@ -1146,6 +1148,7 @@ struct Entry {
 #define e_ndn e_nname.bv_val
 
   Attribute *e_attrs; /* list of attributes + values */
+  AttrIndex *e_aindex; /* lookup index of e_attrs, if any */
 
   slap_mask_t e_ocflags;
 
@@ -1171,6 +1174,9 @@ struct Modification {
  */
 #define SLAP_MOD_INTERNAL 0x01
 #define SLAP_MOD_MANAGING 0x02
+/* The values, but not the normalized ones, point into the request PDU
+ * and must not be freed nor changed in-place, see slap_mod_own() */
+#define SLAP_MOD_INPLACE 0x04
   struct berval sm_type;
 };
 
@@ -1460,6 +1466,8 @@ typedef struct Access {
   struct Access *a_next;
 } Access;
 
+typedef struct AclIndex AclIndex;
+
 /* the "to" part */
 typedef struct AccessControl {
   /* "to" part: the entries this acl applies to */
@@ -1477,6 +1485,9 @@ typedef struct AccessControl {
   Access *acl_access;
 
   struct AccessControl *acl_next;
+
+  /* on the head of a list only, see acl_index_build() */
+  AclIndex *acl_index;
 } AccessControl;
 
 typedef struct AccessControlState {
@@ -1598,6 +1609,7 @@ typedef int slap_cf_aux_table_parse_x(struct berval *val, void *bc, slap_cf_aux_
 
 #define SLAP_LIMIT_TIME 1
 #define SLAP_LIMIT_SIZE 2
+#define SLAP_LIMIT_QUEUE 4
 
 struct slap_limits_set {
   /* time limits */
@@ -1611,6 +1623,9 @@ struct slap_limits_set {
   int lms_s_pr;
   int lms_s_pr_hide;
   int lms_s_pr_total;
+
+  /* queue delay limit (in msec) */
+  int lms_q_delay;
 };
 
 /* Note: this is different from LDAP_NO_LIMIT (0); slapd internal use only */
@@ -1656,6 +1671,31 @@ struct slap_limits {
   struct slap_limits_set lm_limits;
 };
 
+/* Operation class of the QoS scheduler, see qos.c */
+typedef struct QosClass {
+  struct QosClass *qc_next;
+  struct berval qc_name;
+  int qc_weight;  /* share of the slots when classes compete */
+  int qc_threads; /* max executing operations, 0 for no own quota */
+
+  /* selectors; the bound identity is matched like in limits */
+  unsigned qc_style; /* SLAP_LIMITS_*, UNDEFINED to match any */
+  int qc_scope;      /* LDAP_SCOPE_* of qc_pat unless REGEX */
+  struct berval qc_pat;
+  regex_t qc_regex;
+  struct berval qc_peer; /* regex for c_peer_name */
+  regex_t qc_peer_regex;
+  unsigned qc_ops; /* mask of 1 << slap_op_t, 0 to match any */
+
+  /* protected by slap_qos_mutex */
+  LDAP_STAILQ_HEAD(qc_w, Operation) qc_waiting;
+  int qc_nwaiting;
+  int qc_active;
+  int qc_credit;
+  unsigned long qc_dispatched;
+  unsigned long qc_delayed;
+} QosClass;
+
 /* temporary aliases */
 typedef BackendDB Backend;
 #define nbackends nBackendDB
@@ -2158,6 +2198,9 @@ typedef int(BI_entry_get_rw)(Operation *op, struct berval *ndn, ObjectClass *oc,
                              Entry **e);
 typedef int(BI_operational)(Operation *op, SlapReply *rs);
 typedef int(BI_has_subordinates)(Operation *op, Entry *e, int *hasSubs);
+typedef int(BI_uuid2dn)(Operation *op, struct berval *uuid, struct berval *dn, struct berval *ndn);
+typedef int(BI_entry_valfind)(Operation *op, struct berval *ndn, ObjectClass *oc, AttributeDescription *at,
+                              struct berval *nval);
 typedef int(BI_access_allowed)(Operation *op, Entry *e, AttributeDescription *desc, struct berval *val,
                                slap_access_t access, AccessControlState *state, slap_mask_t *maskp);
 typedef int(BI_acl_group)(Operation *op, Entry *target, struct berval *gr_ndn, struct berval *op_ndn,
@@ -2273,6 +2316,8 @@ struct BackendInfo {
   BI_entry_release_rw *bi_entry_release_rw;
 
   BI_has_subordinates *bi_has_subordinates;
+  BI_uuid2dn *bi_uuid2dn;
+  BI_entry_valfind *bi_entry_valfind;
   BI_access_allowed *bi_access_allowed;
   BI_acl_group *bi_acl_group;
   BI_acl_attribute *bi_acl_attribute;
@@ -2499,21 +2544,57 @@ typedef enum {
   SLAP_OP_LAST
 } slap_op_t;
 
+/*
+ * Operation stages, timestamped with the monotonic clock
+ */
+typedef enum {
+  SLAP_STAMP_READ = 0,     /* request input seen by the listener */
+  SLAP_STAMP_QUEUED,       /* submitted to connection_pool */
+  SLAP_STAMP_STARTED,      /* taken by a pool thread */
+  SLAP_STAMP_BACKEND,      /* passed to the frontend database */
+  SLAP_STAMP_BACKEND_DONE, /* returned from the frontend database */
+  SLAP_STAMP_SENT,         /* final response written */
+  SLAP_STAMP_LAST
+} slap_stamp_t;
+
+/*
+ * Latency histograms kept per operation type
+ */
+typedef enum {
+  SLAP_LATENCY_QUEUE = 0, /* read .. started */
+  SLAP_LATENCY_BACKEND,   /* backend .. backend done */
+  SLAP_LATENCY_TOTAL,     /* read .. sent, or completed */
+  SLAP_LATENCY_LAST
+} slap_latency_t;
+
+/* bucket i counts latencies up to 2^i microseconds, the last one the rest */
+#define SLAP_LATENCY_BUCKETS 25
+
+/* Each pool thread counts into its own shard, linked into the global
+ * slap_counters list under its sc_mutex.  The counters are updated with
+ * relaxed atomics and without any lock, readers add them all up by
+ * slap_counters_sum().  The shards are cache line aligned, so no two
+ * threads write to the same line. */
 typedef struct slap_counters_t {
   struct slap_counters_t *sc_next;
-  ldap_pvt_thread_mutex_t sc_mutex;
-  ldap_pvt_mp_t sc_bytes;
-  ldap_pvt_mp_t sc_pdu;
-  ldap_pvt_mp_t sc_entries;
-  ldap_pvt_mp_t sc_refs;
-
-  ldap_pvt_mp_t sc_ops_completed;
-  ldap_pvt_mp_t sc_ops_initiated;
+  void *sc_free;                   /* the allocation of a shard */
+  ldap_pvt_thread_mutex_t sc_mutex; /* protects the list of shards */
+  uint64_t sc_bytes;
+  uint64_t sc_pdu;
+  uint64_t sc_entries;
+  uint64_t sc_refs;
+
+  uint64_t sc_ops_completed;
+  uint64_t sc_ops_initiated;
 #ifdef SLAPD_MONITOR
-  ldap_pvt_mp_t sc_ops_completed_[SLAP_OP_LAST];
-  ldap_pvt_mp_t sc_ops_initiated_[SLAP_OP_LAST];
+  uint64_t sc_ops_completed_[SLAP_OP_LAST];
+  uint64_t sc_ops_initiated_[SLAP_OP_LAST];
+  uint64_t sc_ops_latency_[SLAP_OP_LAST][SLAP_LATENCY_LAST][SLAP_LATENCY_BUCKETS];
 #endif /* SLAPD_MONITOR */
-} slap_counters_t;
+} __cache_aligned slap_counters_t;
+
+#define slap_counter_add(var, n) __atomic_fetch_add(&(var), (n), __ATOMIC_RELAXED)
+#define slap_counter_get(var) __atomic_load_n(&(var), __ATOMIC_RELAXED)
 
 /*
  * represents an operation pending from an ldap client
@@ -2594,6 +2675,7 @@ struct Operation {
   ber_tag_t o_tag; /* tag of the request */
   time_t o_time;   /* time op was initiated */
   int o_tincr;     /* counter for multiple ops with same o_time */
+  uint64_t o_stamp[SLAP_STAMP_LAST]; /* monotonic ns, see slap_op_stamp() */
 
   BackendDB *o_bd;        /* backend DB processing this op */
   struct berval o_req_dn; /* DN of target of request */
@@ -2665,6 +2747,7 @@ struct Operation {
   char o_dont_replicate;
   char o_hollow; /* actually is no any changes */
   slap_access_t o_acl_priv;
+  unsigned o_acl_gen; /* acl_cache_gen as the op began */
 
   char o_nocaching;
   char o_delete_glue_parent;
@@ -2784,6 +2867,9 @@ struct Operation {
   LDAP_SLIST_HEAD(o_e, OpExtra) o_extra; /* anything the backend needs */
 
   LDAP_STAILQ_ENTRY(Operation) o_next; /* next operation in list */
+
+  struct QosClass *o_qos;                  /* class holding the slot */
+  LDAP_STAILQ_ENTRY(Operation) o_qos_next; /* next waiting in class */
 };
 
 #ifdef __SANITIZE_THREAD__
@@ -2870,6 +2956,14 @@ enum sc_conn_state {
   SLAP_C_BINDING,     /* binding */
   SLAP_C_CLIENT       /* outbound client conn */
 };
+
+/* timer of the wheel run by the first daemon thread, see timer.c */
+typedef struct slap_timer {
+  LDAP_LIST_ENTRY(slap_timer) st_link;
+  uint64_t st_expire; /* in wheel ticks */
+  void (*st_func)(struct slap_timer *);
+} slap_timer_t;
+
 struct Connection {
   enum sc_struct_state c_struct_state; /* structure management state */
   enum sc_conn_state c_conn_state;     /* connection state */
@@ -2883,6 +2977,8 @@ struct Connection {
   /* only can be changed by connect_init */
   slap_time_t c_starttime;    /* when the connection was opened */
   slap_time_t c_activitytime; /* when the connection was last used */
+  uint64_t c_readable;        /* when input was handed to the pool, see slap_stamp_now() */
+  slap_timer_t c_timer;       /* expires the idle and write timeouts */
   unsigned long c_connid;     /* id of this connection for stats*/
 
   struct berval c_peer_domain; /* DNS name of client */
@@ -2920,11 +3016,19 @@ struct Connection {
   ldap_pvt_thread_cond_t c_write2_cv;     /* used to wait for sd write-ready*/
 
   BerElement *c_currentber; /* ber we're attempting to read */
+  BerElement *c_wbatch;     /* output not written yet */
+  slap_time_t c_wbatch_since;
+  slap_timer_t c_wbatch_timer; /* flushes the batch held for too long */
+  ber_len_t c_wbatch_bytes;     /* PDUs in c_wbatch, counted once written */
+  unsigned c_wbatch_pdus;
+  unsigned c_wbatch_entries;
+  unsigned c_wbatch_refs;
   int c_writers;            /* number of writers waiting */
   char c_writing;           /* someone is writing */
 
   char c_sasl_bind_in_progress; /* multi-op bind in progress */
   char c_writewaiter;           /* true if blocked on write */
+  char c_wqueued;               /* output queued for the daemon to drain */
   char c_gentle_kick;           /* connection is internal (e.g. syncrepl)
                                  * and should be kicked/closed on gentle-shutdown. */
 
@@ -3011,6 +3115,8 @@ struct Listener {
 #endif
   int sl_mute; /* Listener is temporarily disabled due to emfile */
   int sl_busy; /* Listener is busy (accept thread activated) */
+  int sl_reuseport; /* bound with SO_REUSEPORT, sharded across listener threads */
+  int sl_tid;       /* listener thread owning this shard, if sl_reuseport */
   ber_socket_t sl_sd;
   Sockaddr sl_sa;
 #define sl_addr sl_sa.sa_in_addr
@@ -3021,6 +3127,12 @@ struct Listener {
 #endif             /* LDAP_TCP_BUFFER */
 };
 
+/*
+ * event engine of the daemon loop, see "-o event="
+ */
+#define SLAPD_EVENT_DEFAULT 0 /* epoll, /dev/poll or select, as built */
+#define SLAPD_EVENT_IOURING 1 /* io_uring on top of the epoll bookkeeping */
+
 /*
  * Better know these all around slapd
  */
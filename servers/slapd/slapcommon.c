@@ -910,6 +910,8 @@ int slap_tool_destroy(void) {
   supported_feature_destroy();
   controls_destroy();
   quorum_global_destroy();
+  slap_qos_destroy();
+  slap_timer_destroy();
   schema_destroy();
   lutil_passwd_destroy();
 #ifdef WITH_TLS
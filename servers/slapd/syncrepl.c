@@ -2837,6 +2837,37 @@ typedef struct dninfo {
   struct berval csn_present;
 } dninfo;
 
+/* Search for the entry with the given normalized entryUUID within
+ * o_req_ndn and ors_scope. When the backend resolves the UUID directly,
+ * the search is narrowed down to the entry itself, or skipped entirely
+ * if there is no such entry. */
+static int syncrepl_uuid_search(Operation *op, struct berval *uuid, SlapReply *rs) {
+  struct berval dn, ndn, base = op->o_req_dn, nbase = op->o_req_ndn;
+  int scope = op->ors_scope;
+  int rc;
+
+  rc = be_uuid2dn(op, uuid, &dn, &ndn);
+  if (rc == LDAP_NO_SUCH_OBJECT)
+    return rs->sr_err = LDAP_SUCCESS;
+  if (rc != LDAP_SUCCESS)
+    return op->o_bd->be_search(op, rs);
+
+  if (dnIsSuffixScope(&ndn, &nbase, scope)) {
+    op->o_req_dn = dn;
+    op->o_req_ndn = ndn;
+    op->ors_scope = LDAP_SCOPE_BASE;
+    rc = op->o_bd->be_search(op, rs);
+    op->o_req_dn = base;
+    op->o_req_ndn = nbase;
+    op->ors_scope = scope;
+  } else {
+    rc = rs->sr_err = LDAP_SUCCESS;
+  }
+  op->o_tmpfree(dn.bv_val, op->o_tmpmemctx);
+  op->o_tmpfree(ndn.bv_val, op->o_tmpmemctx);
+  return rc;
+}
+
 static int syncrepl_entry(syncinfo_t *si, Operation *op, Entry *entry, Modifications **modlist, int syncstate,
                           struct berval *syncUUID, struct sync_cookie *syncCookie) {
   Backend *be = op->o_bd;
@@ -2948,7 +2979,7 @@ static int syncrepl_entry(syncinfo_t *si, Operation *op, Entry *entry, Modificat
   dni.modlist = modlist;
 
   op->o_dont_replicate = 1;
-  rc = be->be_search(op, &rs_search);
+  rc = syncrepl_uuid_search(op, syncUUID, &rs_search);
   op->o_dont_replicate = 0;
   Debug(LDAP_DEBUG_SYNC, "syncrepl_entry: %s be_search (%d)\n", si->si_ridtxt, rc);
 
@@ -3581,7 +3612,7 @@ static int syncrepl_del_nonpresent(Operation *op, syncinfo_t *si, slap_biglock_t
       uf.f_av_value = syncUUIDs[i];
       filter2bv_x(op, op->ors_filter, &op->ors_filterstr);
       op->o_dont_replicate = 1;
-      rc = be->be_search(op, &rs_search);
+      rc = syncrepl_uuid_search(op, &syncUUIDs[i], &rs_search);
       op->o_dont_replicate = 0;
       op->o_tmpfree(op->ors_filterstr.bv_val, op->o_tmpmemctx);
     }
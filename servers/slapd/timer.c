@@ -0,0 +1,166 @@
+/* $ReOpenLDAP$ */
+/* Copyright 2018 ReOpenLDAP AUTHORS: please see AUTHORS file.
+ * All rights reserved.
+ *
+ * This file is part of ReOpenLDAP.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the OpenLDAP
+ * Public License.
+ *
+ * A copy of this license is available in the file LICENSE in the
+ * top-level directory of the distribution or, alternatively, at
+ * <http://www.OpenLDAP.org/license.html>.
+ */
+
+/* timer.c - hierarchical timer wheel run by the first daemon thread */
+
+#include "reldap.h"
+
+#include <stdio.h>
+
+#include "slap.h"
+#include "proto-slap.h"
+
+/* The wheel has SLAP_TIMER_LEVELS levels of SLAP_TIMER_SLOTS slots each.
+ * A timer due within SLAP_TIMER_SLOTS ticks is linked into the first
+ * level, farther ones go to the level whose slot covers their expiry.
+ * Each time the first level wraps around, the next slot of the upper
+ * level is cascaded down, so arming, disarming and expiring a timer
+ * all cost O(1) whatever the number of timers armed.  Timers beyond
+ * the reach of the wheel (about 48 days) are clamped to its end and
+ * the owner is expected to re-arm them on expiry. */
+#define SLAP_TIMER_TICK 250000000ull /* nanoseconds */
+#define SLAP_TIMER_BITS 6
+#define SLAP_TIMER_SLOTS (1u << SLAP_TIMER_BITS)
+#define SLAP_TIMER_MASK (SLAP_TIMER_SLOTS - 1)
+#define SLAP_TIMER_LEVELS 4
+#define SLAP_TIMER_SPAN (1ull << (SLAP_TIMER_BITS * SLAP_TIMER_LEVELS))
+
+LDAP_LIST_HEAD(slap_timer_slot, slap_timer);
+
+static struct slap_timer_slot slap_timer_wheel[SLAP_TIMER_LEVELS][SLAP_TIMER_SLOTS];
+static ldap_pvt_thread_mutex_t slap_timer_mutex;
+static uint64_t slap_timer_tick;  /* the last tick expired */
+static uint64_t slap_timer_wake;  /* when the daemon is going to run the wheel */
+static unsigned slap_timer_count; /* timers armed */
+
+void slap_timer_init(void) {
+  int i, j;
+
+  ldap_pvt_thread_mutex_init(&slap_timer_mutex);
+  for (i = 0; i < SLAP_TIMER_LEVELS; i++)
+    for (j = 0; j < SLAP_TIMER_SLOTS; j++)
+      LDAP_LIST_INIT(&slap_timer_wheel[i][j]);
+  slap_timer_tick = ldap_now_steady_ns() / SLAP_TIMER_TICK;
+}
+
+void slap_timer_destroy(void) { ldap_pvt_thread_mutex_destroy(&slap_timer_mutex); }
+
+/* slap_timer_mutex locked */
+static void slap_timer_link(slap_timer_t *t) {
+  uint64_t delta = t->st_expire - slap_timer_tick;
+  int level;
+
+  if (delta >= SLAP_TIMER_SPAN) {
+    delta = SLAP_TIMER_SPAN - 1;
+    t->st_expire = slap_timer_tick + delta;
+  }
+
+  for (level = 0; delta >= (1ull << (SLAP_TIMER_BITS * (level + 1))); level++)
+    ;
+  LDAP_LIST_INSERT_HEAD(&slap_timer_wheel[level][(t->st_expire >> (SLAP_TIMER_BITS * level)) & SLAP_TIMER_MASK], t,
+                        st_link);
+}
+
+/* slap_timer_mutex locked */
+static void slap_timer_unlink(slap_timer_t *t) {
+  if (t->st_link.le_prev) {
+    LDAP_LIST_REMOVE(t, st_link);
+    t->st_link.le_prev = NULL;
+    slap_timer_count--;
+  }
+}
+
+/* Arm or re-arm the timer to fire once the steady clock passes when */
+void slap_timer_arm(slap_timer_t *t, slap_time_t when) {
+  int wake;
+
+  ldap_pvt_thread_mutex_lock(&slap_timer_mutex);
+  slap_timer_unlink(t);
+  t->st_expire = (when.ns + SLAP_TIMER_TICK - 1) / SLAP_TIMER_TICK;
+  if (t->st_expire <= slap_timer_tick)
+    t->st_expire = slap_timer_tick + 1;
+  slap_timer_link(t);
+  slap_timer_count++;
+  /* the daemon may sleep past it, let it recompute the timeout */
+  wake = !slap_timer_wake || t->st_expire < slap_timer_wake;
+  if (wake)
+    slap_timer_wake = t->st_expire;
+  ldap_pvt_thread_mutex_unlock(&slap_timer_mutex);
+
+  if (wake)
+    slap_wake_listener();
+}
+
+void slap_timer_disarm(slap_timer_t *t) {
+  ldap_pvt_thread_mutex_lock(&slap_timer_mutex);
+  slap_timer_unlink(t);
+  ldap_pvt_thread_mutex_unlock(&slap_timer_mutex);
+}
+
+/* Expire the timers due by now and return how long the daemon may
+ * sleep until the next one, zero when there is none. */
+slap_time_t slap_timer_run(slap_time_t now) {
+  uint64_t target = now.ns / SLAP_TIMER_TICK;
+  slap_time_t tv = {0};
+  slap_timer_t *t;
+  unsigned i, idx;
+
+  ldap_pvt_thread_mutex_lock(&slap_timer_mutex);
+  if (!slap_timer_count && slap_timer_tick < target)
+    slap_timer_tick = target;
+
+  while (slap_timer_tick < target) {
+    idx = ++slap_timer_tick & SLAP_TIMER_MASK;
+    /* cascade the upper levels when the lower one wraps around */
+    for (i = 1; !idx && i < SLAP_TIMER_LEVELS; i++) {
+      struct slap_timer_slot *slot;
+
+      idx = (slap_timer_tick >> (SLAP_TIMER_BITS * i)) & SLAP_TIMER_MASK;
+      slot = &slap_timer_wheel[i][idx];
+      while ((t = LDAP_LIST_FIRST(slot)) != NULL) {
+        LDAP_LIST_REMOVE(t, st_link);
+        slap_timer_link(t);
+      }
+    }
+
+    /* the callbacks may re-arm or disarm any timer, so they are
+     * called one by one without the mutex, while arming from other
+     * threads is left for the computation of the next wakeup below */
+    slap_timer_wake = slap_timer_tick;
+    idx = slap_timer_tick & SLAP_TIMER_MASK;
+    while ((t = LDAP_LIST_FIRST(&slap_timer_wheel[0][idx])) != NULL) {
+      slap_timer_unlink(t);
+      ldap_pvt_thread_mutex_unlock(&slap_timer_mutex);
+      t->st_func(t);
+      ldap_pvt_thread_mutex_lock(&slap_timer_mutex);
+    }
+  }
+
+  slap_timer_wake = 0;
+  if (slap_timer_count) {
+    /* the next busy slot of the first level, or the next cascade */
+    for (i = 1; i < SLAP_TIMER_SLOTS; i++) {
+      idx = (slap_timer_tick + i) & SLAP_TIMER_MASK;
+      if (!idx || !LDAP_LIST_EMPTY(&slap_timer_wheel[0][idx]))
+        break;
+    }
+    slap_timer_wake = slap_timer_tick + i;
+    /* rounded up to the millisecond of the event polls */
+    tv.ns = slap_timer_wake * SLAP_TIMER_TICK - now.ns + 999999;
+  }
+  ldap_pvt_thread_mutex_unlock(&slap_timer_mutex);
+
+  return tv;
+}
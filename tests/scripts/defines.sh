@@ -178,6 +178,8 @@ COMPCONF=$DATADIR/slapd-component.conf
 PWCONF=$DATADIR/slapd-pw.conf
 WHOAMICONF=$DATADIR/slapd-whoami.conf
 ACLCONF=$DATADIR/slapd-acl.conf
+COMPACTCONF=$DATADIR/slapd-compact.conf
+ACLCACHECONF=$DATADIR/slapd-aclcache.conf
 RCONF=$DATADIR/slapd-referrals.conf
 SRMASTERCONF=$DATADIR/slapd-syncrepl-master.conf
 DSRMASTERCONF=$DATADIR/slapd-deltasync-master.conf
@@ -300,8 +302,18 @@ DIFF="diff -i"
 CMP="diff -iZ"
 BCMP="diff -iB"
 CMPOUT=/dev/null
-SLAPD="$TIMEOUT_L $VALGRIND_CMD $SLAPD_SLAPD -D -s0 -d $LVL"
-SLAPD_HUGE="$TIMEOUT_H $VALGRIND_CMD $SLAPD_SLAPD -D -s0 -d $LVL"
+# SLAPD_EVENT=io_uring and SLAPD_REUSEPORT=on run the servers with the
+# alternative event engine and per-thread listener sockets, the latter
+# along with the "#reuseport=on#" lines of the configs
+SLAPD_OPTS=
+if [ -n "$SLAPD_EVENT" ]; then
+	SLAPD_OPTS="$SLAPD_OPTS -o event=$SLAPD_EVENT"
+fi
+if [ -n "$SLAPD_REUSEPORT" ]; then
+	SLAPD_OPTS="$SLAPD_OPTS -o reuseport=$SLAPD_REUSEPORT"
+fi
+SLAPD="$TIMEOUT_L $VALGRIND_CMD $SLAPD_SLAPD -D -s0 -d $LVL $SLAPD_OPTS"
+SLAPD_HUGE="$TIMEOUT_H $VALGRIND_CMD $SLAPD_SLAPD -D -s0 -d $LVL $SLAPD_OPTS"
 LDAPPASSWD="$TIMEOUT_S $VALGRIND_EX_CMD $CLIENTDIR/ldappasswd $TOOLARGS"
 LDAPSASLSEARCH="$TIMEOUT_S $VALGRIND_EX_CMD $CLIENTDIR/ldapsearch $SASLARGS $TOOLPROTO $LDAP_TOOLARGS -LLL"
 LDAPSASLWHOAMI="$TIMEOUT_S $VALGRIND_EX_CMD $CLIENTDIR/ldapwhoami $SASLARGS $LDAP_TOOLARGS"
@@ -888,6 +900,7 @@ function config_filter {
 		-e "s/^#${MAINDB}#//g"				\
 		-e "s/^#monitor=${AC_conf[monitor]}#//g"	\
 		-e "s/^#monitor=${monitor}#//g"			\
+		-e "s/^#reuseport=${SLAPD_REUSEPORT:-off}#//g"	\
 		-e "s/^#sasl=${AC_conf[sasl]}#//g"		\
 		-e "s/^#aci=${AC_conf[aci]}#//g"		\
 		-e "s;@URI1@;${URI1};g"				\